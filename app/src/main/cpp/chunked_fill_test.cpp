@@ -0,0 +1,34 @@
+//
+// Created on 10/18/26.
+//
+
+#include "chunked_fill_test.hpp"
+
+#include "gpu_types.hpp"
+#include "kernel_tests/fill_kernel.hpp"
+#include "test_result_logging.hpp"
+#include "test_utils.hpp"
+
+namespace chunked_fill_test {
+
+    void runAllTests(const sample_info& info, clspv_utils::device& device)
+    {
+        // 100 rows of 64 pixels: float4 rows are 1 KiB, so each buffer holds 32 rows in two
+        // chunks, and the last buffer holds the 4 rows left over. Each chunk's 4x1 workgroups
+        // are dispatched as two tiles.
+        test_utils::KernelTest kernelTest;
+        kernelTest.mEntryName = "FillWithColorKernel";
+        kernelTest.mWorkgroupSize = vk::Extent3D(16, 16, 1);
+        kernelTest.mArguments = { "-w", "64", "-h", "100", "-maxbuffer", "32768", "-maxchunk", "16384", "-maxtile", "2" };
+        kernelTest.mInvocationTests = {
+                fill_kernel::getChunkedTestVariant<gpu_types::float4>(),
+                fill_kernel::getChunkedTestVariant<gpu_types::half4>()
+        };
+
+        test_utils::ModuleTest moduleTest;
+        moduleTest.mName = "shaders_cl/Fills";
+        moduleTest.mKernelTests.push_back(kernelTest);
+
+        test_result_logging::logResults(info, test_utils::test_module(device, moduleTest));
+    }
+}
@@ -0,0 +1,20 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVTEST_CHUNKED_FILL_TEST_HPP
+#define CLSPVTEST_CHUNKED_FILL_TEST_HPP
+
+#include "clspv_utils/device.hpp"
+
+struct sample_info;
+
+namespace chunked_fill_test {
+
+    // Run the chunked fill tests at a small extent, with buffer, chunk and dispatch tile limits
+    // small enough that the destination spans several buffers, each of several chunks, and each
+    // chunk is dispatched in several tiles. Log the results as for the test manifest.
+    void runAllTests(const sample_info& info, clspv_utils::device& device);
+}
+
+#endif //CLSPVTEST_CHUNKED_FILL_TEST_HPP
@@ -17,10 +17,16 @@
  * limitations under the License.
  */
 
+#include "chunked_fill_test.hpp"
+#include "host_import_test.hpp"
+#include "invocation_batch_test.hpp"
 #include "memmove_test.hpp"
+#include "task_graph_test.hpp"
 #include "test_manifest.hpp"
 #include "test_result_logging.hpp"
 #include "test_utils.hpp"
+#include "transfer_overlap_test.hpp"
+#include "uniform_ring_test.hpp"
 #include "util_init.hpp"
 #include "vulkan_utils/vulkan_utils.hpp"
 
@@ -28,6 +34,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -97,7 +104,8 @@ void init_validation_layers(struct sample_info& info) {
 }
 
 void init_compute_queue_family_index(struct sample_info &info) {
-    /* This routine simply finds a compute queue for a later vkCreateDevice.
+    /* This routine finds a compute queue for a later vkCreateDevice, and the families of any
+     * async compute and transfer queues to create alongside it.
      */
 
     auto queue_props = info.gpu.getQueueFamilyProperties();
@@ -109,12 +117,35 @@ void init_compute_queue_family_index(struct sample_info &info) {
 
     info.graphics_queue_family_index = std::distance(queue_props.begin(), found);
     info.graphics_queue_family_properties = queue_props[info.graphics_queue_family_index];
+
+    /* Prefer a family dedicated to compute for async compute, falling back to a second queue in
+     * the compute family.
+     */
+    found = std::find_if(queue_props.begin(), queue_props.end(), [](vk::QueueFamilyProperties p) {
+        return (p.queueFlags & vk::QueueFlagBits::eCompute) && !(p.queueFlags & vk::QueueFlagBits::eGraphics);
+    });
+    if (found != queue_props.end() && std::distance(queue_props.begin(), found) != info.graphics_queue_family_index) {
+        info.async_compute_queue_family_index = std::distance(queue_props.begin(), found);
+    }
+    else if (info.graphics_queue_family_properties.queueCount > 1) {
+        info.async_compute_queue_family_index = info.graphics_queue_family_index;
+    }
+
+    /* Only a family dedicated to transfers is worth a separate transfer queue */
+    found = std::find_if(queue_props.begin(), queue_props.end(), [](vk::QueueFamilyProperties p) {
+        return (p.queueFlags & vk::QueueFlagBits::eTransfer)
+               && !(p.queueFlags & (vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eGraphics));
+    });
+    if (found != queue_props.end()) {
+        info.transfer_queue_family_index = std::distance(queue_props.begin(), found);
+    }
 }
 
 void my_init_descriptor_pool(struct sample_info &info) {
     const vk::DescriptorPoolSize type_count[] = {
         { vk::DescriptorType::eStorageBuffer,   16 },
         { vk::DescriptorType::eUniformBuffer,   16 },
+        { vk::DescriptorType::eUniformBufferDynamic, 16 },
         { vk::DescriptorType::eSampler,         16 },
         { vk::DescriptorType::eCombinedImageSampler, 16 },
         { vk::DescriptorType::eSampledImage,    16 },
@@ -204,6 +235,39 @@ int sample_main(int argc, char *argv[]) {
     // The clspv solution we're using requires two Vulkan extensions to be enabled.
     info.device_extension_names.push_back("VK_KHR_storage_buffer_storage_class");
     info.device_extension_names.push_back("VK_KHR_variable_pointers");
+
+    // Descriptor update templates, and push descriptors, are used for kernel arguments if the
+    // device offers them.
+    const auto availableExtensions = info.gpu.enumerateDeviceExtensionProperties();
+    auto isExtensionAvailable = [&availableExtensions](const char* name) {
+        return std::any_of(availableExtensions.begin(), availableExtensions.end(), [name](const vk::ExtensionProperties& p) {
+            return 0 == std::strcmp(p.extensionName, name);
+        });
+    };
+    if (isExtensionAvailable(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)) {
+        info.device_extension_names.push_back(VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME);
+        if (isExtensionAvailable(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)) {
+            info.device_extension_names.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+        }
+    }
+
+    // The memory budget is reported with the test results if the device can report it
+    if (isExtensionAvailable(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+        info.device_extension_names.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    // Host memory is imported into buffers, rather than copied, if the device can import it.
+    // VK_KHR_external_memory also requires its capabilities extension on the instance.
+    const bool canImportHostMemory = std::any_of(info.instance_extension_names.begin(), info.instance_extension_names.end(), [](const char* name) {
+                                         return 0 == std::strcmp(name, VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME);
+                                     })
+                                     && isExtensionAvailable(VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME)
+                                     && isExtensionAvailable(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+    if (canImportHostMemory) {
+        info.device_extension_names.push_back(VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME);
+        info.device_extension_names.push_back(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+    }
+
     init_device(info);
     init_device_queue(info);
 
@@ -218,12 +282,40 @@ int sample_main(int argc, char *argv[]) {
                                *info.device,
                                *info.desc_pool,
                                *info.cmd_pool,
-                               info.graphics_queue);
+                               info.graphics_queue,
+                               info.graphics_queue_family_index,
+                               info.device_extension_names);
+    if (info.async_compute_queue) {
+        device.setQueue(clspv_utils::device::kQueue_asyncCompute, info.async_compute_queue, info.async_compute_queue_family_index);
+    }
+    if (info.transfer_queue) {
+        device.setQueue(clspv_utils::device::kQueue_transfer, info.transfer_queue, info.transfer_queue_family_index);
+    }
+    device.setPipelineCacheDirectory(android_utils::getInternalDataPath());
+
+    if (canImportHostMemory) {
+        auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR) info.inst->getProcAddr("vkGetPhysicalDeviceProperties2KHR");
+        if (getProperties2) {
+            vk::PhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties;
+            vk::PhysicalDeviceProperties2 properties;
+            properties.pNext = &hostProperties;
+            getProperties2(info.gpu, reinterpret_cast<VkPhysicalDeviceProperties2*>(&properties));
+            device.setMinImportedHostPointerAlignment(hostProperties.minImportedHostPointerAlignment);
+        }
+    }
 
     const auto results = test_manifest::run(manifest, device);
     test_result_logging::logResults(info, results);
 
     memmove_test::runAllTests(info);
+    chunked_fill_test::runAllTests(info, device);
+    invocation_batch_test::runAllTests(device);
+    task_graph_test::runAllTests(device);
+    transfer_overlap_test::runAllTests(device);
+    host_import_test::runAllTests(device);
+    uniform_ring_test::runAllTests(device);
+
+    test_result_logging::logMemoryUsage(info, device);
 
     //
     // Clean up
@@ -8,10 +8,17 @@
 namespace clspv_utils {
 
     // execution types
+    class completion;
+    class descriptor_ring;
     class device;
     class invocation;
+    class invocation_batch;
     class kernel;
     class module;
+    class task_graph;
+    class timestamp_pool;
+    class transfer_batch;
+    class uniform_ring;
 
     struct execution_time_t;
     struct kernel_req_t;
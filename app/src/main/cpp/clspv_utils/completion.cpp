@@ -0,0 +1,181 @@
+//
+// Created on 10/18/26.
+//
+
+#include "completion.hpp"
+
+#include "device.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+namespace {
+    using namespace clspv_utils;
+
+    std::uint64_t to_vulkan_timeout(completion::timeout_t timeout)
+    {
+        if (timeout == completion::infinite()) {
+            return std::numeric_limits<std::uint64_t>::max();
+        }
+        return (timeout.count() < 0 ? 0 : static_cast<std::uint64_t>(timeout.count()));
+    }
+
+    vector<vk::Fence> get_pending_fences(vk::ArrayProxy<const completion> completions, vk::Device& device)
+    {
+        vector<vk::Fence> result;
+        result.reserve(completions.size());
+
+        for (auto& c : completions) {
+            if (!c.poll()) {
+                if (device && device != c.getDevice()) {
+                    fail_runtime_error("completions must all belong to the same device");
+                }
+                device = c.getDevice();
+                result.push_back(c.getFence());
+            }
+        }
+
+        return result;
+    }
+
+    // The deleter of a completion's fence, which runs once, when the last copy of the completion
+    // is destroyed. A fence must not be destroyed while a pending submission may still signal it.
+    // An error while waiting, such as a lost device, cannot be reported from a destructor, so the
+    // fence is destroyed regardless.
+    void destroy_fence(vk::Device device, vk::UniqueFence* fence)
+    {
+        try {
+            if (*fence) {
+                device.waitForFences(**fence, VK_TRUE, std::numeric_limits<std::uint64_t>::max());
+            }
+        }
+        catch (...) {
+        }
+
+        delete fence;
+    }
+
+} // anonymous namespace
+
+namespace clspv_utils {
+
+    completion::completion()
+    {
+        // this space intentionally left blank
+    }
+
+    completion::completion(vk::Device device, vk::UniqueFence fence)
+            : mDevice(device),
+              mFence(new vk::UniqueFence(std::move(fence)), [device](vk::UniqueFence* f) { destroy_fence(device, f); })
+    {
+    }
+
+    completion::completion(completion&& other)
+            : completion()
+    {
+        swap(other);
+    }
+
+    completion::~completion()
+    {
+        // the fence's deleter waits for the work, once the last copy is destroyed
+    }
+
+    completion& completion::operator=(const completion& other)
+    {
+        completion temp(other);
+        swap(temp);
+        return *this;
+    }
+
+    completion& completion::operator=(completion&& other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    void completion::swap(completion& other)
+    {
+        using std::swap;
+
+        swap(mDevice, other.mDevice);
+        swap(mFence, other.mFence);
+    }
+
+    bool completion::poll() const
+    {
+        return (!mFence || vk::Result::eSuccess == mDevice.getFenceStatus(**mFence));
+    }
+
+    void completion::wait() const
+    {
+        wait(infinite());
+    }
+
+    bool completion::wait(timeout_t timeout) const
+    {
+        return (!mFence || vk::Result::eSuccess == mDevice.waitForFences(**mFence, VK_TRUE, to_vulkan_timeout(timeout)));
+    }
+
+    bool waitAll(vk::ArrayProxy<const completion> completions, completion::timeout_t timeout)
+    {
+        vk::Device device;
+        const auto fences = get_pending_fences(completions, device);
+        if (fences.empty()) {
+            return true;
+        }
+
+        return (vk::Result::eSuccess == device.waitForFences(fences, VK_TRUE, to_vulkan_timeout(timeout)));
+    }
+
+    int waitAny(vk::ArrayProxy<const completion> completions, completion::timeout_t timeout)
+    {
+        vk::Device device;
+        const auto fences = get_pending_fences(completions, device);
+
+        // Only block if none of the completions has already completed
+        if (!fences.empty() && fences.size() == completions.size()) {
+            if (vk::Result::eSuccess != device.waitForFences(fences, VK_FALSE, to_vulkan_timeout(timeout))) {
+                return -1;
+            }
+        }
+
+        const auto found = std::find_if(completions.begin(), completions.end(), [](const completion& c) {
+            return c.poll();
+        });
+        return (found == completions.end() ? -1 : static_cast<int>(std::distance(completions.begin(), found)));
+    }
+
+    completion submitCommand(const device& inDevice, vk::CommandBuffer commandBuffer)
+    {
+        return submitCommand(inDevice, inDevice.getComputeQueue(), commandBuffer);
+    }
+
+    completion submitCommand(const device&                         inDevice,
+                             vk::Queue                             queue,
+                             vk::CommandBuffer                     commandBuffer,
+                             vk::ArrayProxy<const vk::Semaphore>   waitSemaphores,
+                             vk::ArrayProxy<const vk::Semaphore>   signalSemaphores)
+    {
+        vk::UniqueFence fence = inDevice.getDevice().createFenceUnique(vk::FenceCreateInfo());
+
+        // The queue may run any kind of command, so wait for the semaphores before all of them
+        const vector<vk::PipelineStageFlags> waitStages(waitSemaphores.size(), vk::PipelineStageFlagBits::eAllCommands);
+
+        vk::SubmitInfo submitInfo;
+        submitInfo.setCommandBufferCount(1)
+                .setPCommandBuffers(&commandBuffer)
+                .setWaitSemaphoreCount(waitSemaphores.size())
+                .setPWaitSemaphores(waitSemaphores.data())
+                .setPWaitDstStageMask(waitStages.empty() ? nullptr : waitStages.data())
+                .setSignalSemaphoreCount(signalSemaphores.size())
+                .setPSignalSemaphores(signalSemaphores.data());
+
+        inDevice.submit(queue, submitInfo, *fence);
+
+        return completion(inDevice.getDevice(), std::move(fence));
+    }
+
+} // namespace clspv_utils
@@ -0,0 +1,91 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVUTILS_COMPLETION_HPP
+#define CLSPVUTILS_COMPLETION_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+
+#include <chrono>
+
+#include <vulkan/vulkan.hpp>
+
+namespace clspv_utils {
+
+    // A completion tracks work submitted to a queue through the fence signaled by that
+    // submission. A default constructed completion represents no outstanding work, and so is
+    // always complete. Copies of a completion share the same fence. Destroying the last copy
+    // blocks until its work has completed.
+    class completion {
+    public:
+        typedef std::chrono::nanoseconds    timeout_t;
+
+        static timeout_t    infinite() { return timeout_t::max(); }
+
+                    completion();
+
+                    completion(vk::Device device, vk::UniqueFence fence);
+
+                    completion(const completion& other) = default;
+
+                    completion(completion&& other);
+
+                    ~completion();
+
+        completion& operator=(const completion& other);
+
+        completion& operator=(completion&& other);
+
+        void        swap(completion& other);
+
+        // Return true if the work has completed. Never blocks.
+        bool        poll() const;
+
+        // Block until the work has completed.
+        void        wait() const;
+
+        // Block until the work has completed or the timeout expires. Return true if the work
+        // has completed.
+        bool        wait(timeout_t timeout) const;
+
+        vk::Device  getDevice() const { return mDevice; }
+        vk::Fence   getFence() const { return (mFence ? **mFence : vk::Fence()); }
+
+    private:
+        vk::Device                  mDevice;
+        shared_ptr<vk::UniqueFence> mFence;
+    };
+
+    inline void swap(completion& lhs, completion& rhs)
+    {
+        lhs.swap(rhs);
+    }
+
+    // Block until every completion has completed or the timeout expires. Return true if all of
+    // the work has completed.
+    bool        waitAll(vk::ArrayProxy<const completion> completions,
+                        completion::timeout_t            timeout = completion::infinite());
+
+    // Block until at least one completion has completed or the timeout expires. Return the index
+    // of a completed entry, or -1 if the timeout expired first.
+    int         waitAny(vk::ArrayProxy<const completion> completions,
+                        completion::timeout_t            timeout = completion::infinite());
+
+    // Submit the command buffer to the device's compute queue, returning a completion which
+    // signals when the command buffer has finished executing.
+    completion  submitCommand(const device& inDevice, vk::CommandBuffer commandBuffer);
+
+    // Submit the command buffer to one of the device's queues. Its commands wait for
+    // waitSemaphores to be signaled, and it signals signalSemaphores when it has finished
+    // executing, so that work can be handed off between queues.
+    completion  submitCommand(const device&                         inDevice,
+                              vk::Queue                             queue,
+                              vk::CommandBuffer                     commandBuffer,
+                              vk::ArrayProxy<const vk::Semaphore>   waitSemaphores = nullptr,
+                              vk::ArrayProxy<const vk::Semaphore>   signalSemaphores = nullptr);
+}
+
+#endif //CLSPVUTILS_COMPLETION_HPP
@@ -0,0 +1,132 @@
+//
+// Created on 10/18/26.
+//
+
+#include "descriptor_ring.hpp"
+
+#include <algorithm>
+
+namespace {
+
+    // Sets are allocated from a ring's pools in blocks of this many, and never freed individually
+    const std::uint32_t kSetsPerPool = 16;
+
+}
+
+namespace clspv_utils {
+
+    descriptor_ring::lease::lease()
+    {
+        // this space intentionally left blank
+    }
+
+    descriptor_ring::lease::lease(shared_ptr<descriptor_ring> ring, vk::DescriptorSet descriptor)
+            : mRing(std::move(ring)),
+              mDescriptor(descriptor)
+    {
+    }
+
+    descriptor_ring::lease::lease(lease&& other)
+            : lease()
+    {
+        swap(other);
+    }
+
+    descriptor_ring::lease::~lease()
+    {
+        release();
+    }
+
+    descriptor_ring::lease& descriptor_ring::lease::operator=(lease&& other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    void descriptor_ring::lease::swap(lease& other)
+    {
+        using std::swap;
+
+        swap(mRing, other.mRing);
+        swap(mDescriptor, other.mDescriptor);
+    }
+
+    void descriptor_ring::lease::release(completion inFlight)
+    {
+        if (mRing && mDescriptor) {
+            mRing->recycle(mDescriptor, std::move(inFlight));
+        }
+        mRing.reset();
+        mDescriptor = vk::DescriptorSet();
+    }
+
+    descriptor_ring::descriptor_ring(device                                         inDevice,
+                                     vk::DescriptorSetLayout                        layout,
+                                     vk::ArrayProxy<const vk::DescriptorPoolSize>   poolSizes)
+            : mDevice(inDevice),
+              mLayout(layout),
+              mSetSizes(poolSizes.begin(), poolSizes.end())
+    {
+    }
+
+    descriptor_ring::~descriptor_ring()
+    {
+    }
+
+    descriptor_ring::lease descriptor_ring::acquire()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        const auto found = std::find_if(mRetired.begin(), mRetired.end(), [](const retired_descriptor& r) {
+            return r.mInFlight.poll();
+        });
+
+        if (found == mRetired.end()) {
+            return lease(shared_from_this(), allocate());
+        }
+
+        const vk::DescriptorSet descriptor = found->mDescriptor;
+        mRetired.erase(found);
+
+        return lease(shared_from_this(), descriptor);
+    }
+
+    vk::DescriptorSet descriptor_ring::allocate()
+    {
+        // grow by a whole pool when the newest one is full
+        if (mPools.empty() || mSetsInLastPool == kSetsPerPool) {
+            vector<vk::DescriptorPoolSize> poolSizes(mSetSizes);
+            for (auto& ps : poolSizes) {
+                ps.descriptorCount *= kSetsPerPool;
+            }
+
+            vk::DescriptorPoolCreateInfo createInfo;
+            createInfo.setMaxSets(kSetsPerPool)
+                    .setPoolSizeCount(poolSizes.size())
+                    .setPPoolSizes(poolSizes.empty() ? nullptr : poolSizes.data());
+
+            mPools.push_back(mDevice.getDevice().createDescriptorPoolUnique(createInfo));
+            mSetsInLastPool = 0;
+        }
+
+        vk::DescriptorSetAllocateInfo allocateInfo;
+        allocateInfo.setDescriptorPool(*mPools.back())
+                .setDescriptorSetCount(1)
+                .setPSetLayouts(&mLayout);
+
+        const vk::DescriptorSet result = mDevice.getDevice().allocateDescriptorSets(allocateInfo)[0];
+        ++mSetsInLastPool;
+        return result;
+    }
+
+    void descriptor_ring::recycle(vk::DescriptorSet descriptor, completion inFlight)
+    {
+        retired_descriptor retired;
+        retired.mDescriptor = descriptor;
+        retired.mInFlight = std::move(inFlight);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRetired.push_back(std::move(retired));
+    }
+
+} // namespace clspv_utils
@@ -0,0 +1,98 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVUTILS_DESCRIPTOR_RING_HPP
+#define CLSPVUTILS_DESCRIPTOR_RING_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+#include "completion.hpp"
+#include "device.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include <vulkan/vulkan.hpp>
+
+namespace clspv_utils {
+
+    // A descriptor_ring hands out descriptor sets of a single layout, so that each invocation of
+    // a kernel has its own set and several invocations may be in flight at once. A set released
+    // together with a completion is not reused until that completion has signaled. New sets are
+    // allocated only when no released set is available, from descriptor pools owned by the ring,
+    // so that rings never contend for a shared pool. A ring may be used from several threads.
+    class descriptor_ring : public std::enable_shared_from_this<descriptor_ring> {
+    public:
+        // A lease is exclusive ownership of one descriptor set from a ring. Destroying a lease
+        // returns the set to the ring for immediate reuse; use release() instead if work which
+        // references the set may still be executing.
+        class lease {
+        public:
+                                lease();
+
+                                lease(shared_ptr<descriptor_ring> ring, vk::DescriptorSet descriptor);
+
+                                lease(lease&& other);
+
+                                ~lease();
+
+            lease&              operator=(lease&& other);
+
+            void                swap(lease& other);
+
+            vk::DescriptorSet   get() const { return mDescriptor; }
+
+            explicit operator   bool() const { return (bool)mDescriptor; }
+
+            // Return the set to the ring, to be reused once the completion has signaled.
+            void                release(completion inFlight = completion());
+
+        private:
+            shared_ptr<descriptor_ring> mRing;
+            vk::DescriptorSet           mDescriptor;
+        };
+
+    public:
+        // poolSizes gives the number of descriptors of each type in one set of the layout
+                    descriptor_ring(device                                      inDevice,
+                                    vk::DescriptorSetLayout                     layout,
+                                    vk::ArrayProxy<const vk::DescriptorPoolSize> poolSizes);
+
+                    ~descriptor_ring();
+
+        lease       acquire();
+
+    private:
+        struct retired_descriptor {
+            vk::DescriptorSet   mDescriptor;
+            completion          mInFlight;
+        };
+
+    private:
+        void                recycle(vk::DescriptorSet descriptor, completion inFlight);
+
+        vk::DescriptorSet   allocate();
+
+    private:
+        device                              mDevice;
+        vk::DescriptorSetLayout             mLayout;
+        vector<vk::DescriptorPoolSize>      mSetSizes;
+        std::mutex                          mMutex;
+
+        vector<vk::UniqueDescriptorPool>    mPools;
+        std::uint32_t                       mSetsInLastPool = 0;
+
+        // declared after mPools so that in-flight work is waited on before the sets are freed
+        vector<retired_descriptor>          mRetired;
+    };
+
+    inline void swap(descriptor_ring::lease& lhs, descriptor_ring::lease& rhs)
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#endif //CLSPVUTILS_DESCRIPTOR_RING_HPP
@@ -6,12 +6,19 @@
 
 #include "interface.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+
+#include <unistd.h>
 
 
 namespace {
     using namespace clspv_utils;
 
+    const vk::DeviceSize kUniformRingCapacity = 256 * 1024;
+    const std::uint32_t kTimestampQueriesPerPool = 96;
+
     //
     // boost_* code heavily borrowed from Boost 1.65.0
     // Ideally, we'd just use boost directly (that's what it's for, after all). However, it's a lot
@@ -71,6 +78,31 @@ namespace {
         return result;
     }
 
+    bool isExtensionEnabled(const vk::ArrayProxy<const char* const>& extensions, const char* name)
+    {
+        return std::any_of(extensions.begin(), extensions.end(), [name](const char* e) {
+            return 0 == std::strcmp(e, name);
+        });
+    }
+
+    vk::QueueFlags getQueueFamilyFlags(vk::PhysicalDevice physicalDevice, std::uint32_t familyIndex)
+    {
+        const auto families = physicalDevice.getQueueFamilyProperties();
+        if (familyIndex >= families.size()) {
+            fail_runtime_error("invalid queue family index");
+        }
+        return families[familyIndex].queueFlags;
+    }
+
+    template <typename Fn>
+    void getDeviceProc(vk::Device device, const char* name, Fn& fn)
+    {
+        fn = reinterpret_cast<Fn>(device.getProcAddr(name));
+        if (!fn) {
+            fail_runtime_error("device does not export an entry point for an enabled extension");
+        }
+    }
+
 } // anonymous namespace
 
 namespace clspv_utils {
@@ -86,30 +118,161 @@ namespace clspv_utils {
         return std::move(inDevice.getDevice().allocateDescriptorSetsUnique(createInfo)[0]);
     }
 
+    vulkan_utils::transfer_fn createTransferFn(const device& inDevice)
+    {
+        return [inDevice](const std::function<void (vk::CommandBuffer)>& recordFn) {
+            vk::UniqueCommandBuffer commandBuffer = vulkan_utils::allocate_command_buffer(inDevice.getDevice(),
+                                                                                          inDevice.getCommandPool());
+
+            commandBuffer->begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+            recordFn(*commandBuffer);
+            commandBuffer->end();
+
+            submitCommand(inDevice, *commandBuffer).wait();
+        };
+    }
+
     device::device(vk::PhysicalDevice                   physicalDevice,
                    vk::Device                           device,
                    vk::DescriptorPool                   descriptorPool,
                    vk::CommandPool                      commandPool,
-                   vk::Queue                            computeQueue)
+                   vk::Queue                            computeQueue,
+                   std::uint32_t                        computeQueueFamilyIndex,
+                   vk::ArrayProxy<const char* const>    enabledExtensions)
             : mPhysicalDevice(physicalDevice),
               mDevice(device),
               mMemoryProperties(physicalDevice.getMemoryProperties()),
               mDescriptorPool(descriptorPool),
-              mCommandPool(commandPool),
-              mComputeQueue(computeQueue),
+              mCommandPools(new command_pool_cache),
               mSamplerCache(new sampler_cache),
               mSamplerDescriptorCache(new descriptor_cache)
     {
+        queue_info& computeInfo = mQueues[kQueue_compute];
+        computeInfo.mQueue = computeQueue;
+        computeInfo.mFamilyIndex = computeQueueFamilyIndex;
+        computeInfo.mFlags = getQueueFamilyFlags(physicalDevice, computeQueueFamilyIndex);
+        mQueueMutexes[kQueue_compute] = std::make_shared<std::mutex>();
+
+        if (commandPool) {
+            mCommandPools->mPools[command_pool_key(std::this_thread::get_id(), computeQueueFamilyIndex)] = commandPool;
+        }
+
+        mMemoryAllocator = vulkan_utils::memory_allocator::getDefault(mDevice, mMemoryProperties);
+
+        mUniformRing = std::make_shared<uniform_ring>(mDevice,
+                                                      mMemoryProperties,
+                                                      physicalDevice.getProperties().limits,
+                                                      kUniformRingCapacity);
+        mTimestampPool = std::make_shared<timestamp_pool>(mDevice, kTimestampQueriesPerPool);
+        mStagingPool = std::make_shared<vulkan_utils::staging_pool>(mDevice, mMemoryProperties);
+
+        if (isExtensionEnabled(enabledExtensions, VK_KHR_DESCRIPTOR_UPDATE_TEMPLATE_EXTENSION_NAME)) {
+            mExtensionDispatch = std::make_shared<extension_dispatch>();
+            getDeviceProc(mDevice, "vkCreateDescriptorUpdateTemplateKHR", mExtensionDispatch->vkCreateDescriptorUpdateTemplateKHR);
+            getDeviceProc(mDevice, "vkDestroyDescriptorUpdateTemplateKHR", mExtensionDispatch->vkDestroyDescriptorUpdateTemplate);
+            getDeviceProc(mDevice, "vkUpdateDescriptorSetWithTemplateKHR", mExtensionDispatch->vkUpdateDescriptorSetWithTemplateKHR);
+
+            if (isExtensionEnabled(enabledExtensions, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME)) {
+                getDeviceProc(mDevice, "vkCmdPushDescriptorSetWithTemplateKHR", mExtensionDispatch->vkCmdPushDescriptorSetWithTemplateKHR);
+                mSupportsPushDescriptors = true;
+            }
+        }
+
+        if (isExtensionEnabled(enabledExtensions, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME)) {
+            getDeviceProc(mDevice, "vkGetMemoryHostPointerPropertiesEXT", mHostMemoryImporter.vkGetMemoryHostPointerPropertiesEXT);
+            mHostMemoryImporter.mMinImportedHostPointerAlignment = sysconf(_SC_PAGESIZE);
+        }
+    }
+
+    void device::setQueue(queue_role role, vk::Queue queue, std::uint32_t familyIndex)
+    {
+        if (kQueue_compute == role) {
+            fail_runtime_error("the compute queue is set when the device is created");
+        }
+
+        const auto flags = getQueueFamilyFlags(mPhysicalDevice, familyIndex);
+        if (kQueue_asyncCompute == role && !(flags & vk::QueueFlagBits::eCompute)) {
+            fail_runtime_error("async compute queue must support compute");
+        }
+
+        queue_info& info = mQueues[role];
+        info.mQueue = queue;
+        info.mFamilyIndex = familyIndex;
+        info.mFlags = flags;
+
+        // a queue used in several roles must still only be submitted to by one thread at a time
+        mQueueMutexes[role] = std::make_shared<std::mutex>();
+        for (int r = 0; r < kQueue_count; ++r) {
+            if (r != role && mQueues[r].mQueue == queue) {
+                mQueueMutexes[role] = mQueueMutexes[r];
+                break;
+            }
+        }
+    }
+
+    vk::CommandPool device::getCommandPool(queue_role role) const
+    {
+        assert(mCommandPools);
+
+        const command_pool_key key(std::this_thread::get_id(), getQueue(role).mFamilyIndex);
+
+        std::lock_guard<std::mutex> lock(mCommandPools->mMutex);
+
+        const auto found = mCommandPools->mPools.find(key);
+        if (found != mCommandPools->mPools.end()) {
+            return found->second;
+        }
+
+        vk::CommandPoolCreateInfo createInfo;
+        createInfo.setQueueFamilyIndex(key.second)
+                .setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
+
+        mCommandPools->mOwnedPools.push_back(mDevice.createCommandPoolUnique(createInfo));
+        mCommandPools->mPools[key] = *mCommandPools->mOwnedPools.back();
+
+        return mCommandPools->mPools[key];
+    }
+
+    const device::queue_info& device::getQueue(queue_role role) const
+    {
+        return (hasDedicatedQueue(role) ? mQueues[role] : mQueues[kQueue_compute]);
+    }
+
+    vector<std::uint32_t> device::getQueueFamilyIndices() const
+    {
+        vector<std::uint32_t> result;
+        for (auto& q : mQueues) {
+            if (q.mQueue && result.end() == std::find(result.begin(), result.end(), q.mFamilyIndex)) {
+                result.push_back(q.mFamilyIndex);
+            }
+        }
+        return result;
+    }
+
+    void device::submit(vk::Queue queue, const vk::SubmitInfo& submitInfo, vk::Fence fence) const
+    {
+        for (int r = 0; r < kQueue_count; ++r) {
+            if (mQueues[r].mQueue && mQueues[r].mQueue == queue) {
+                std::lock_guard<std::mutex> lock(*mQueueMutexes[r]);
+                queue.submit(submitInfo, fence);
+                return;
+            }
+        }
+
+        fail_runtime_error("submitting to a queue the device does not own");
     }
 
     vk::Sampler device::getCachedSampler(int opencl_flags)
     {
         assert(mSamplerCache);
 
-        if (!mSamplerCache->count(opencl_flags)) {
-            (*mSamplerCache)[opencl_flags] = createCompatibleSampler(mDevice, opencl_flags);
+        std::lock_guard<std::mutex> lock(mSamplerCache->mMutex);
+
+        vk::UniqueSampler& sampler = mSamplerCache->mSamplers[opencl_flags];
+        if (!sampler) {
+            sampler = createCompatibleSampler(mDevice, opencl_flags);
         }
-        return *(*mSamplerCache)[opencl_flags];
+        return *sampler;
     }
 
     vk::UniqueDescriptorSetLayout device::createSamplerDescriptorLayout(const sampler_list_proxy& samplers) const
@@ -180,17 +343,20 @@ namespace clspv_utils {
 
         const std::size_t hash = compute_hash(samplers);
 
-        if (0 == mSamplerDescriptorCache->count(hash))
+        // groups are only created as modules are loaded, so a single lock does not contend
+        std::lock_guard<std::mutex> lock(mSamplerDescriptorCache->mMutex);
+
+        if (0 == mSamplerDescriptorCache->mGroups.count(hash))
         {
             unique_descriptor_group unique_group;
             unique_group.mLayout = createSamplerDescriptorLayout(samplers);
             unique_group.mDescriptor = createSamplerDescriptor(samplers, *unique_group.mLayout);
 
-            (*mSamplerDescriptorCache)[hash] = std::move(unique_group);
+            mSamplerDescriptorCache->mGroups[hash] = std::move(unique_group);
         }
 
-        const auto found = mSamplerDescriptorCache->find(hash);
-        assert(found != mSamplerDescriptorCache->end());
+        const auto found = mSamplerDescriptorCache->mGroups.find(hash);
+        assert(found != mSamplerDescriptorCache->mGroups.end());
 
         descriptor_group result;
         result.mLayout = *found->second.mLayout;
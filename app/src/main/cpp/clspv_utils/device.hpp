@@ -9,13 +9,24 @@
 
 #include "clspv_utils_interop.hpp"
 #include "interface.hpp"
+#include "timestamp_pool.hpp"
+#include "uniform_ring.hpp"
 
 #include <vulkan/vulkan.hpp>
 
+#include "vulkan_utils/staging_pool.hpp"
+#include "vulkan_utils/vulkan_utils.hpp"
+
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace clspv_utils {
 
+    // A device may be shared by several host threads. Its caches, the queues it submits to and the
+    // device level pools used by kernels and invocations are internally synchronized. Command
+    // pools are per thread (see getCommandPool), so a command buffer must be recorded, reset and
+    // freed on the thread which allocated it.
     class device {
     public:
         struct descriptor_group
@@ -24,28 +35,116 @@ namespace clspv_utils {
             vk::DescriptorSetLayout mLayout;
         };
 
+        // Entry points for the descriptor update template and push descriptor extensions. These
+        // are not exported by the Android loader, so they are fetched from the device. The member
+        // names match those expected by vulkan.hpp's Dispatch parameter.
+        struct extension_dispatch
+        {
+            PFN_vkCreateDescriptorUpdateTemplateKHR     vkCreateDescriptorUpdateTemplateKHR     = nullptr;
+            PFN_vkDestroyDescriptorUpdateTemplateKHR    vkDestroyDescriptorUpdateTemplate       = nullptr;
+            PFN_vkUpdateDescriptorSetWithTemplateKHR    vkUpdateDescriptorSetWithTemplateKHR    = nullptr;
+            PFN_vkCmdPushDescriptorSetWithTemplateKHR   vkCmdPushDescriptorSetWithTemplateKHR   = nullptr;
+        };
+
+        typedef vk::UniqueHandle<vk::DescriptorUpdateTemplate, extension_dispatch> unique_update_template;
+
         typedef vk::ArrayProxy<const sampler_spec_t> sampler_list_proxy;
 
+        // The roles in which queues are used. Work submitted to different queues may execute
+        // concurrently, and is ordered by semaphores.
+        enum queue_role {
+            kQueue_compute      = 0,    // the queue on which work is submitted by default
+            kQueue_asyncCompute,        // a second compute queue, for kernels independent of kQueue_compute
+            kQueue_transfer,            // a queue for uploads and readbacks
+
+            kQueue_count
+        };
+
+        struct queue_info
+        {
+            vk::Queue       mQueue;
+            std::uint32_t   mFamilyIndex    = VK_QUEUE_FAMILY_IGNORED;
+            vk::QueueFlags  mFlags;
+        };
+
         device() {}
 
         device(vk::PhysicalDevice   physicalDevice,
                vk::Device           device,
                vk::DescriptorPool   descriptorPool,
                vk::CommandPool      commandPool,
-               vk::Queue            computeQueue);
+               vk::Queue            computeQueue,
+               std::uint32_t        computeQueueFamilyIndex,
+               vk::ArrayProxy<const char* const> enabledExtensions = nullptr);
 
         vk::PhysicalDevice  getPhysicalDevice() const { return mPhysicalDevice; }
         vk::Device          getDevice() const { return mDevice; }
         vk::DescriptorPool  getDescriptorPool() const { return mDescriptorPool; }
-        vk::CommandPool     getCommandPool() const { return mCommandPool; }
-        vk::Queue           getComputeQueue() const { return mComputeQueue; }
+        vk::Queue           getComputeQueue() const { return getQueue(kQueue_compute).mQueue; }
+
+        // Return the calling thread's command pool for the role's queue family, creating it on
+        // first use. The pool passed to the constructor serves the constructing thread's
+        // kQueue_compute family; the others are created with eResetCommandBuffer.
+        vk::CommandPool     getCommandPool(queue_role role = kQueue_compute) const;
+
+        // Use the queue, from the given family, for the role. Queues should be set before kernels
+        // are created from the device, since kernels and invocations hold their own copies of it.
+        void                setQueue(queue_role role, vk::Queue queue, std::uint32_t familyIndex);
+
+        // Return the queue for the role, or the kQueue_compute queue if none has been set
+        const queue_info&   getQueue(queue_role role) const;
+
+        bool                hasDedicatedQueue(queue_role role) const { return (bool)mQueues[role].mQueue; }
+
+        // The distinct families of the device's queues. Buffers and images used on more than one
+        // of them should be created to be shared between them.
+        vector<std::uint32_t>   getQueueFamilyIndices() const;
+
+        // Submit to one of the device's queues. Submissions to a queue are serialized, so any
+        // other submission to it must also go through the device.
+        void                submit(vk::Queue queue, const vk::SubmitInfo& submitInfo, vk::Fence fence) const;
+
+        // The ring from which pod_ubo kernel arguments are sub-allocated
+        shared_ptr<uniform_ring>    getUniformRing() const { return mUniformRing; }
+
+        // The pool from which invocations allocate their timestamp queries
+        shared_ptr<timestamp_pool>  getTimestampPool() const { return mTimestampPool; }
+
+        // The pool from which image upload and readback buffers are drawn
+        shared_ptr<vulkan_utils::staging_pool>  getStagingPool() const { return mStagingPool; }
+
+        // The allocator from which the device's buffers and images are drawn. The device holds it,
+        // so its cached blocks and usage counters last as long as the device does.
+        shared_ptr<vulkan_utils::memory_allocator>  getMemoryAllocator() const { return mMemoryAllocator; }
 
         const vk::PhysicalDeviceMemoryProperties&   getMemoryProperties() const { return mMemoryProperties; }
 
+        // The directory in which modules persist their pipeline caches and tuned workgroup sizes.
+        // Nothing is persisted if it is empty, which is the default. Modules created afterwards
+        // use it.
+        void            setPipelineCacheDirectory(const string& directory) { mPipelineCacheDirectory = directory; }
+        const string&   getPipelineCacheDirectory() const { return mPipelineCacheDirectory; }
+
+        // True if VK_KHR_descriptor_update_template was enabled on the device
+        bool    supportsDescriptorUpdateTemplates() const { return (bool)mExtensionDispatch; }
+
+        // True if VK_KHR_push_descriptor was also enabled on the device
+        bool    supportsPushDescriptors() const { return mSupportsPushDescriptors; }
+
+        const extension_dispatch&   getExtensionDispatch() const { return *mExtensionDispatch; }
+
+        // Imports host memory into buffers without copying it, if VK_EXT_external_memory_host was
+        // enabled on the device. The alignment defaults to the host page size; the exact value is
+        // an instance level query, so the application should set it when it knows it.
+        const vulkan_utils::host_memory_importer&   getHostMemoryImporter() const { return mHostMemoryImporter; }
+        void    setMinImportedHostPointerAlignment(vk::DeviceSize alignment) { mHostMemoryImporter.mMinImportedHostPointerAlignment = alignment; }
+
         vk::Sampler                     getCachedSampler(int opencl_flags);
 
         vk::UniqueDescriptorSetLayout   createSamplerDescriptorLayout(const sampler_list_proxy& samplers) const;
 
+        // The set is allocated from the device's descriptor pool, which is only otherwise used by
+        // getCachedSamplerDescriptorGroup. Callers must synchronize with that.
         vk::UniqueDescriptorSet         createSamplerDescriptor(const sampler_list_proxy& samplers,
                                                                 vk::DescriptorSetLayout layout);
 
@@ -58,24 +157,56 @@ namespace clspv_utils {
             vk::UniqueDescriptorSetLayout mLayout;
         };
 
-        typedef map<std::size_t, unique_descriptor_group> descriptor_cache;
-        typedef map<int, vk::UniqueSampler> sampler_cache;
+        struct descriptor_cache
+        {
+            std::mutex                                  mMutex;
+            map<std::size_t, unique_descriptor_group>   mGroups;
+        };
+
+        struct sampler_cache
+        {
+            std::mutex                      mMutex;
+            map<int, vk::UniqueSampler>     mSamplers;
+        };
+
+        typedef std::pair<std::thread::id, std::uint32_t> command_pool_key;
+
+        struct command_pool_cache
+        {
+            std::mutex                              mMutex;
+            map<command_pool_key, vk::CommandPool>  mPools;
+            vector<vk::UniqueCommandPool>           mOwnedPools;
+        };
 
     private:
         vk::PhysicalDevice                  mPhysicalDevice;
         vk::Device                          mDevice;
         vk::PhysicalDeviceMemoryProperties  mMemoryProperties;
         vk::DescriptorPool                  mDescriptorPool;
-        vk::CommandPool                     mCommandPool;
-        vk::Queue                           mComputeQueue;
+        queue_info                          mQueues[kQueue_count];
+        shared_ptr<std::mutex>              mQueueMutexes[kQueue_count];
+        shared_ptr<command_pool_cache>      mCommandPools;
 
         shared_ptr<descriptor_cache>        mSamplerDescriptorCache;
         shared_ptr<sampler_cache>           mSamplerCache;
+        shared_ptr<uniform_ring>            mUniformRing;
+        shared_ptr<timestamp_pool>          mTimestampPool;
+        shared_ptr<vulkan_utils::memory_allocator>  mMemoryAllocator;
+        shared_ptr<vulkan_utils::staging_pool>  mStagingPool;
+        shared_ptr<extension_dispatch>      mExtensionDispatch;
+        bool                                mSupportsPushDescriptors    = false;
+        vulkan_utils::host_memory_importer  mHostMemoryImporter;
+        string                              mPipelineCacheDirectory;
     };
 
     vk::UniqueDescriptorSet allocateDescriptorSet(const device&           inDevice,
                                                   vk::DescriptorSetLayout layout);
 
+    // Return a function which runs transfers synchronously on the device's compute queue, for
+    // buffers staged through vulkan_utils::buffer::map. The compute queue is used so that
+    // buffers need not be shared with the transfer queue's family.
+    vulkan_utils::transfer_fn   createTransferFn(const device& inDevice);
+
 }
 
 #endif //CLSPVUTILS_DEVICE_HPP
@@ -31,7 +31,7 @@ namespace {
     };
 
     const auto kArgKind_DescriptorType_Map = {
-            std::make_pair(arg_spec_t::kind_pod_ubo,    vk::DescriptorType::eUniformBuffer),
+            std::make_pair(arg_spec_t::kind_pod_ubo,    vk::DescriptorType::eUniformBufferDynamic),
             std::make_pair(arg_spec_t::kind_pod,        vk::DescriptorType::eStorageBuffer),
             std::make_pair(arg_spec_t::kind_buffer,     vk::DescriptorType::eStorageBuffer),
             std::make_pair(arg_spec_t::kind_buffer_ubo, vk::DescriptorType::eUniformBuffer),
@@ -44,6 +44,7 @@ namespace {
     const auto kSpvMapArgType_ArgKind_Map = {
             std::make_pair("pod",        arg_spec_t::kind_pod),
             std::make_pair("pod_ubo",    arg_spec_t::kind_pod_ubo),
+            std::make_pair("pod_pushconstant",   arg_spec_t::kind_pod_pushconstant),
             std::make_pair("buffer",     arg_spec_t::kind_buffer),
             std::make_pair("buffer_ubo", arg_spec_t::kind_buffer_ubo),
             std::make_pair("combined_image_sampler",   arg_spec_t::kind_combined_image_sampler),
@@ -177,6 +178,22 @@ namespace {
         return result;
     }
 
+    // True if the argument occupies its own binding in the kernel's arguments descriptor set.
+    // Pod arguments packed after offset 0 share the binding of the first.
+    bool isDescriptorArgument(const arg_spec_t& ka)
+    {
+        return (0 == ka.mOffset && ka.mKind != arg_spec_t::kind_pod_pushconstant);
+    }
+
+    vk::DescriptorType getArgumentDescriptorType(arg_spec_t::kind argKind, bool usePushDescriptors)
+    {
+        vk::DescriptorType result = getDescriptorType(argKind);
+        if (usePushDescriptors && result == vk::DescriptorType::eUniformBufferDynamic) {
+            result = vk::DescriptorType::eUniformBuffer;
+        }
+        return result;
+    }
+
 } // anonymous namespace
 
 namespace clspv_utils {
@@ -284,12 +301,8 @@ namespace clspv_utils {
     void standardizeKernelArgumentOrder(kernel_spec_t::arg_list& arguments)
     {
         std::sort(arguments.begin(), arguments.end(), [](const arg_spec_t& lhs, const arg_spec_t& rhs) {
-            auto isPod = [](arg_spec_t::kind kind) {
-                return (kind == arg_spec_t::kind_pod || kind == arg_spec_t::kind_pod_ubo);
-            };
-
-            const auto lhs_is_pod = isPod(lhs.mKind);
-            const auto rhs_is_pod = isPod(rhs.mKind);
+            const auto lhs_is_pod = isPodArgument(lhs.mKind);
+            const auto rhs_is_pod = isPodArgument(rhs.mKind);
 
             return (lhs_is_pod == rhs_is_pod ? lhs.mOrdinal < rhs.mOrdinal : !lhs_is_pod);
         });
@@ -302,8 +315,23 @@ namespace clspv_utils {
         return (found == arguments.end() ? -1 : found->mDescriptorSet);
     }
 
+    vk::PushConstantRange getKernelPushConstantRange(const kernel_spec_t::arg_list& arguments) {
+        std::uint32_t rangeEnd = 0;
+        for (auto& ka : arguments) {
+            if (ka.mKind == arg_spec_t::kind_pod_pushconstant) {
+                rangeEnd = std::max(rangeEnd, static_cast<std::uint32_t>(ka.mOffset + ka.mArgSize));
+            }
+        }
+
+        // push constant ranges must be a multiple of 4 bytes
+        rangeEnd = (rangeEnd + 3) & ~3u;
+
+        return vk::PushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, rangeEnd);
+    }
+
     vk::UniqueDescriptorSetLayout createKernelArgumentDescriptorLayout(const kernel_spec_t::arg_list& arguments,
-                                                                       vk::Device inDevice)
+                                                                       vk::Device inDevice,
+                                                                       bool usePushDescriptors)
     {
         vector<vk::DescriptorSetLayoutBinding> bindingSet;
 
@@ -312,10 +340,9 @@ namespace clspv_utils {
                 .setDescriptorCount(1);
 
         for (auto &ka : arguments) {
-            // ignore any argument not in offset 0
-            if (0 != ka.mOffset) continue;
+            if (!isDescriptorArgument(ka)) continue;
 
-            binding.descriptorType = getDescriptorType(ka.mKind);
+            binding.descriptorType = getArgumentDescriptorType(ka.mKind, usePushDescriptors);
             binding.binding = ka.mBinding;
 
             bindingSet.push_back(binding);
@@ -324,10 +351,36 @@ namespace clspv_utils {
         vk::DescriptorSetLayoutCreateInfo createInfo;
         createInfo.setBindingCount(bindingSet.size())
                 .setPBindings(bindingSet.size() ? bindingSet.data() : nullptr);
+        if (usePushDescriptors) {
+            createInfo.setFlags(vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR);
+        }
 
         return inDevice.createDescriptorSetLayoutUnique(createInfo);
     }
 
+    vector<vk::DescriptorUpdateTemplateEntry>
+    createKernelArgumentTemplateEntries(const kernel_spec_t::arg_list&  arguments,
+                                        bool                            usePushDescriptors)
+    {
+        vector<vk::DescriptorUpdateTemplateEntry> result;
+
+        vk::DescriptorUpdateTemplateEntry entry;
+        entry.setDescriptorCount(1)
+                .setStride(sizeof(arg_descriptor_info_t));
+
+        for (auto &ka : arguments) {
+            if (!isDescriptorArgument(ka)) continue;
+
+            entry.setDstBinding(ka.mBinding)
+                    .setDescriptorType(getArgumentDescriptorType(ka.mKind, usePushDescriptors))
+                    .setOffset(result.size() * sizeof(arg_descriptor_info_t));
+
+            result.push_back(entry);
+        }
+
+        return result;
+    }
+
     /***********************************************************************************************
      * arg_spec_t::kind functions
      **********************************************************************************************/
@@ -344,6 +397,12 @@ namespace clspv_utils {
         return found->second;
     }
 
+    bool isPodArgument(arg_spec_t::kind argKind) {
+        return (argKind == arg_spec_t::kind_pod
+                || argKind == arg_spec_t::kind_pod_ubo
+                || argKind == arg_spec_t::kind_pod_pushconstant);
+    }
+
     /***********************************************************************************************
      * OpenCL sampler flags functions
      **********************************************************************************************/
@@ -436,7 +495,9 @@ namespace clspv_utils {
         for (auto& ka : spec.mArguments) {
             // All arguments for a given kernel that are passed in a descriptor set need to be in
             // the same descriptor set
-            if (ka.mKind != arg_spec_t::kind_local && ka.mDescriptorSet != arg_ds) {
+            if (ka.mKind != arg_spec_t::kind_local
+                && ka.mKind != arg_spec_t::kind_pod_pushconstant
+                && ka.mDescriptorSet != arg_ds) {
                 fail_runtime_error("kernel arg descriptor_sets don't match");
             }
 
@@ -487,6 +548,14 @@ namespace clspv_utils {
                 fail_runtime_error("local kernel argument missing spec constant");
             }
         }
+        else if (arg.mKind == arg_spec_t::kind_pod_pushconstant) {
+            if (arg.mOffset < 0) {
+                fail_runtime_error("push constant kernel argument missing offset");
+            }
+            if (arg.mArgSize <= 0) {
+                fail_runtime_error("push constant kernel argument missing argSize");
+            }
+        }
         else {
             if (arg.mDescriptorSet < 0) {
                 fail_runtime_error("kernel argument missing descriptorSet");
@@ -16,6 +16,7 @@ namespace clspv_utils {
             kind_unknown,
             kind_pod,
             kind_pod_ubo,
+            kind_pod_pushconstant,
             kind_buffer,
             kind_buffer_ubo,
             kind_combined_image_sampler,
@@ -34,6 +35,12 @@ namespace clspv_utils {
         int     mArgSize        = -1;
     };
 
+    // One slot of the packed array from which an arguments descriptor update template reads
+    union arg_descriptor_info_t {
+        VkDescriptorImageInfo   mImage;
+        VkDescriptorBufferInfo  mBuffer;
+    };
+
     struct constant_spec_t {
         int                     mDescriptorSet  = -1;
         int                     mBinding        = -1;
@@ -91,8 +98,23 @@ namespace clspv_utils {
      * kernel_spec_t::arg_list functions
      */
 
+    /*
+     * If usePushDescriptors is true, the layout is created for use with VK_KHR_push_descriptor.
+     * Push descriptor sets cannot hold dynamic descriptors, so pod_ubo arguments are then plain
+     * uniform buffers whose descriptor carries the offset of the argument block.
+     */
     vk::UniqueDescriptorSetLayout createKernelArgumentDescriptorLayout(const kernel_spec_t::arg_list&   arguments,
-                                                                       vk::Device                       inDevice);
+                                                                       vk::Device                       inDevice,
+                                                                       bool                             usePushDescriptors = false);
+
+    /*
+     * Return the descriptor update template entries for the kernel's arguments descriptor set.
+     * There is one entry per binding in the set, in argument order, each reading one
+     * arg_descriptor_info_t from a packed array. The arguments must be in standard order.
+     */
+    vector<vk::DescriptorUpdateTemplateEntry>
+    createKernelArgumentTemplateEntries(const kernel_spec_t::arg_list&  arguments,
+                                        bool                            usePushDescriptors = false);
 
     /*
      * Sort the args such that pods are grouped together at the end of the sequence, and that
@@ -102,12 +124,20 @@ namespace clspv_utils {
 
     int     getKernelArgumentDescriptorSet(const kernel_spec_t::arg_list& arguments);
 
+    /*
+     * Return the push constant range covering all pod_pushconstant arguments. The range has zero
+     * size if the kernel has no such arguments.
+     */
+    vk::PushConstantRange   getKernelPushConstantRange(const kernel_spec_t::arg_list& arguments);
+
     /*
      * arg_spec_t::kind functions
      */
 
     vk::DescriptorType  getDescriptorType(arg_spec_t::kind argKind);
 
+    bool                isPodArgument(arg_spec_t::kind argKind);
+
     /*
      * OpenCL sampler flags functions
      */
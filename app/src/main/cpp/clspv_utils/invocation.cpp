@@ -6,7 +6,10 @@
 
 #include "interface.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <iterator>
 #include <memory>
 
 
@@ -26,11 +29,13 @@ namespace clspv_utils {
     invocation::invocation(invocation_req_t req)
             : mReq(std::move(req))
     {
-        vk::QueryPoolCreateInfo poolCreateInfo;
-        poolCreateInfo.setQueryType(vk::QueryType::eTimestamp)
-                .setQueryCount(kTimestamp_count);
+        mTimestamps = mReq.mDevice.getTimestampPool()->allocate(kTimestamp_count);
 
-        mQueryPool = mReq.mDevice.getDevice().createQueryPoolUnique(poolCreateInfo);
+        mArgumentDescriptorInfo.resize(mReq.mArgumentsTemplateEntries.size());
+
+        if (mReq.mArgumentsDescriptors) {
+            mArgumentsDescriptor = mReq.mArgumentsDescriptors->acquire();
+        }
     }
 
     invocation::invocation(invocation&& other)
@@ -40,6 +45,17 @@ namespace clspv_utils {
     }
 
     invocation::~invocation() {
+        // If the kernel has evicted the pipeline, this invocation holds the last reference to it
+        if (mPipeline && mPipeline.unique()) {
+            mLastSubmission.wait();
+        }
+
+        // The arguments descriptor may still be referenced by a pending submission, so it is not
+        // reused until that submission completes. The same is true of the pod arguments and
+        // timestamp queries.
+        mTimestamps.release(mLastSubmission);
+        mPodAllocation.release(mLastSubmission);
+        mArgumentsDescriptor.release(std::move(mLastSubmission));
     }
 
     void invocation::swap(invocation& other)
@@ -47,19 +63,48 @@ namespace clspv_utils {
         using std::swap;
 
         swap(mReq, other.mReq);
-        swap(mQueryPool, other.mQueryPool);
+        swap(mQueueRole, other.mQueueRole);
+        swap(mTimestamps, other.mTimestamps);
+        swap(mCommandBuffer, other.mCommandBuffer);
+        swap(mArgumentsDescriptor, other.mArgumentsDescriptor);
+        swap(mPipeline, other.mPipeline);
+        swap(mLastSubmission, other.mLastSubmission);
 
         swap(mSpecConstantArguments, other.mSpecConstantArguments);
+        swap(mPodArguments, other.mPodArguments);
+        swap(mNumPodArguments, other.mNumPodArguments);
+        swap(mPodAllocation, other.mPodAllocation);
         swap(mBufferMemoryBarriers, other.mBufferMemoryBarriers);
         swap(mImageMemoryBarriers, other.mImageMemoryBarriers);
 
-        swap(mImageArgumentInfo, other.mImageArgumentInfo);
-        swap(mBufferArgumentInfo, other.mBufferArgumentInfo);
-        swap(mArgumentDescriptorWrites, other.mArgumentDescriptorWrites);
+        swap(mArgumentDescriptorInfo, other.mArgumentDescriptorInfo);
+        swap(mNumDescriptorArguments, other.mNumDescriptorArguments);
     }
 
     std::size_t invocation::countArguments() const {
-        return mArgumentDescriptorWrites.size() + mSpecConstantArguments.size();
+        return mNumDescriptorArguments + mSpecConstantArguments.size() + mNumPodArguments;
+    }
+
+    arg_descriptor_info_t& invocation::nextDescriptorArgument(vk::DescriptorType kind) {
+        validateArgType(countArguments(), kind);
+
+        // descriptor arguments precede the pod arguments, so they fill the slots in order
+        assert(mNumDescriptorArguments < mArgumentDescriptorInfo.size());
+        return mArgumentDescriptorInfo[mNumDescriptorArguments++];
+    }
+
+    const arg_spec_t& invocation::nextPodArgument() const {
+        const std::size_t ordinal = countArguments();
+        if (ordinal >= mReq.mKernelSpec.mArguments.size()) {
+            fail_runtime_error("adding too many arguments to kernel invocation");
+        }
+
+        auto& ka = mReq.mKernelSpec.mArguments.data()[ordinal];
+        if (ka.mKind != arg_spec_t::kind_pod_ubo && ka.mKind != arg_spec_t::kind_pod_pushconstant) {
+            fail_runtime_error("adding incompatible argument to kernel invocation");
+        }
+
+        return ka;
     }
 
     std::uint32_t invocation::validateArgType(std::size_t        ordinal,
@@ -93,20 +138,40 @@ namespace clspv_utils {
     }
 
     void invocation::addStorageBufferArgument(vulkan_utils::buffer& buffer) {
+        addStorageBufferArgument(buffer, 0, VK_WHOLE_SIZE);
+    }
+
+    void invocation::addStorageBufferArgument(vulkan_utils::buffer& buffer, vk::DeviceSize offset, vk::DeviceSize range) {
         if (!(buffer.getUsage() & vk::BufferUsageFlagBits::eStorageBuffer)) {
             fail_runtime_error("buffer is not configured as a storage buffer");
         }
 
-        mBufferMemoryBarriers.push_back(buffer.prepareForShaderRead());
-        mBufferMemoryBarriers.push_back(buffer.prepareForShaderWrite());
-        mBufferArgumentInfo.push_back(buffer.use());
+        vk::BufferMemoryBarrier barrier = buffer.prepareForShaderReadWrite();
+        barrier.setOffset(offset)
+               .setSize(range);
+
+        // A resubmission of the recorded command buffer must wait for this invocation's own write
+        barrier.srcAccessMask |= vk::AccessFlagBits::eShaderWrite;
 
-        vk::WriteDescriptorSet argSet;
-        argSet.setDstSet(mReq.mArgumentsDescriptor)
-                .setDstBinding(validateArgType(countArguments(), vk::DescriptorType::eStorageBuffer))
-                .setDescriptorCount(1)
-                .setDescriptorType(vk::DescriptorType::eStorageBuffer);
-        mArgumentDescriptorWrites.push_back(argSet);
+        mBufferMemoryBarriers.push_back(barrier);
+        nextDescriptorArgument(vk::DescriptorType::eStorageBuffer).mBuffer = buffer.use(offset, range);
+    }
+
+    void invocation::addReadOnlyStorageBufferArgument(vulkan_utils::buffer& buffer) {
+        addReadOnlyStorageBufferArgument(buffer, 0, VK_WHOLE_SIZE);
+    }
+
+    void invocation::addReadOnlyStorageBufferArgument(vulkan_utils::buffer& buffer, vk::DeviceSize offset, vk::DeviceSize range) {
+        if (!(buffer.getUsage() & vk::BufferUsageFlagBits::eStorageBuffer)) {
+            fail_runtime_error("buffer is not configured as a storage buffer");
+        }
+
+        vk::BufferMemoryBarrier barrier = buffer.prepareForShaderRead();
+        barrier.setOffset(offset)
+               .setSize(range);
+
+        mBufferMemoryBarriers.push_back(barrier);
+        nextDescriptorArgument(vk::DescriptorType::eStorageBuffer).mBuffer = buffer.use(offset, range);
     }
 
     void invocation::addUniformBufferArgument(vulkan_utils::buffer& buffer) {
@@ -115,27 +180,13 @@ namespace clspv_utils {
         }
 
         mBufferMemoryBarriers.push_back(buffer.prepareForShaderRead());
-        mBufferArgumentInfo.push_back(buffer.use());
-
-        vk::WriteDescriptorSet argSet;
-        argSet.setDstSet(mReq.mArgumentsDescriptor)
-                .setDstBinding(validateArgType(countArguments(), vk::DescriptorType::eUniformBuffer))
-                .setDescriptorCount(1)
-                .setDescriptorType(vk::DescriptorType::eUniformBuffer);
-        mArgumentDescriptorWrites.push_back(argSet);
+        nextDescriptorArgument(vk::DescriptorType::eUniformBuffer).mBuffer = buffer.use();
     }
 
     void invocation::addSamplerArgument(vk::Sampler samp) {
         vk::DescriptorImageInfo samplerInfo;
         samplerInfo.setSampler(samp);
-        mImageArgumentInfo.push_back(samplerInfo);
-
-        vk::WriteDescriptorSet argSet;
-        argSet.setDstSet(mReq.mArgumentsDescriptor)
-                .setDstBinding(validateArgType(countArguments(), vk::DescriptorType::eSampler))
-                .setDescriptorCount(1)
-                .setDescriptorType(vk::DescriptorType::eSampler);
-        mArgumentDescriptorWrites.push_back(argSet);
+        nextDescriptorArgument(vk::DescriptorType::eSampler).mImage = samplerInfo;
     }
 
     void invocation::addCombinedImageSampler(vulkan_utils::image& image) {
@@ -163,40 +214,22 @@ namespace clspv_utils {
         vk::Sampler textureSampler;
         mReq.mDevice.getDevice().createSampler(&samplerCreateInfo, nullptr, &textureSampler);
         imageInfo.setSampler(textureSampler);
-        mImageArgumentInfo.push_back(imageInfo);
-
-        //addSamplerArgument()
-        vk::WriteDescriptorSet argSet;
-        argSet.setDstSet(mReq.mArgumentsDescriptor)
-                .setDstBinding(validateArgType(countArguments(), vk::DescriptorType::eCombinedImageSampler))
-                .setDescriptorCount(1)
-                .setPImageInfo(&imageInfo)
-                .setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
-        mArgumentDescriptorWrites.push_back(argSet);
+        nextDescriptorArgument(vk::DescriptorType::eCombinedImageSampler).mImage = imageInfo;
     }
 
     void invocation::addReadOnlyImageArgument(vulkan_utils::image& image) {
         mImageMemoryBarriers.push_back(image.prepare(vk::ImageLayout::eShaderReadOnlyOptimal));
-        mImageArgumentInfo.push_back(image.use());
-
-        vk::WriteDescriptorSet argSet;
-        argSet.setDstSet(mReq.mArgumentsDescriptor)
-                .setDstBinding(validateArgType(countArguments(), vk::DescriptorType::eSampledImage))
-                .setDescriptorCount(1)
-                .setDescriptorType(vk::DescriptorType::eSampledImage);
-        mArgumentDescriptorWrites.push_back(argSet);
+        nextDescriptorArgument(vk::DescriptorType::eSampledImage).mImage = image.use();
     }
 
     void invocation::addWriteOnlyImageArgument(vulkan_utils::image& image) {
-        mImageMemoryBarriers.push_back(image.prepare(vk::ImageLayout::eGeneral));
-        mImageArgumentInfo.push_back(image.use());
+        vk::ImageMemoryBarrier barrier = image.prepare(vk::ImageLayout::eGeneral);
+
+        // A resubmission of the recorded command buffer must wait for this invocation's own write
+        barrier.srcAccessMask |= vk::AccessFlagBits::eShaderWrite;
 
-        vk::WriteDescriptorSet argSet;
-        argSet.setDstSet(mReq.mArgumentsDescriptor)
-                .setDstBinding(validateArgType(countArguments(), vk::DescriptorType::eStorageImage))
-                .setDescriptorCount(1)
-                .setDescriptorType(vk::DescriptorType::eStorageImage);
-        mArgumentDescriptorWrites.push_back(argSet);
+        mImageMemoryBarriers.push_back(barrier);
+        nextDescriptorArgument(vk::DescriptorType::eStorageImage).mImage = image.use();
     }
 
     void invocation::addLocalArraySizeArgument(unsigned int numElements) {
@@ -204,103 +237,238 @@ namespace clspv_utils {
         mSpecConstantArguments.push_back(numElements);
     }
 
-    void invocation::updateDescriptorSets() {
-        //
-        // Set up to create the descriptor set write structures for arguments.
-        // We will iterate the param lists in the same order,
-        // picking up image and buffer infos in order.
-        //
+    void invocation::addPodArgument(const void* data, std::size_t numBytes) {
+        const arg_spec_t& ka = nextPodArgument();
+        if (ka.mArgSize > 0 && static_cast<std::size_t>(ka.mArgSize) != numBytes) {
+            fail_runtime_error("pod argument size does not match the kernel's argument");
+        }
 
-        auto nextImage = mImageArgumentInfo.begin();
-        auto nextBuffer = mBufferArgumentInfo.begin();
+        const std::size_t end = ka.mOffset + numBytes;
+        if (mPodArguments.size() < end) {
+            mPodArguments.resize(end);
+        }
 
-        for (auto& a : mArgumentDescriptorWrites) {
-            switch (a.descriptorType) {
+        std::memcpy(mPodArguments.data() + ka.mOffset, data, numBytes);
+        ++mNumPodArguments;
+    }
+
+    void invocation::setPodArguments(const void* data, std::size_t numBytes) {
+        nextPodArgument();
+
+        auto bytes = static_cast<const std::uint8_t*>(data);
+        mPodArguments.assign(bytes, bytes + numBytes);
+        mNumPodArguments = mReq.mKernelSpec.mArguments.size() - mNumDescriptorArguments - mSpecConstantArguments.size();
+    }
+
+    void invocation::setPushConstants(const void* data, std::size_t numBytes) {
+        if (!hasPushConstants()) {
+            fail_runtime_error("kernel has no push constant arguments");
+        }
+        if (numBytes < mReq.mPushConstantRange.size) {
+            fail_runtime_error("push constant data is smaller than the kernel's push constant range");
+        }
+
+        setPodArguments(data, mReq.mPushConstantRange.size);
+    }
+
+    void invocation::uploadPodArguments() {
+        const auto found = std::find_if(mReq.mKernelSpec.mArguments.begin(),
+                                        mReq.mKernelSpec.mArguments.end(),
+                                        [](const arg_spec_t& ka) {
+                                            return ka.mKind == arg_spec_t::kind_pod_ubo;
+                                        });
+        if (found == mReq.mKernelSpec.mArguments.end()) {
+            return;
+        }
+
+        if (mPodArguments.empty()) {
+            fail_runtime_error("pod arguments have not been set");
+        }
+
+        // Any previous block may still be in use by the last submission of this invocation
+        mPodAllocation.release(mLastSubmission);
+        mPodAllocation = mReq.mDevice.getUniformRing()->allocate(mPodArguments.size());
+        std::memcpy(mPodAllocation.data(), mPodArguments.data(), mPodArguments.size());
+
+        vk::DescriptorBufferInfo bufferInfo = mPodAllocation.getDescriptorInfo();
+
+        // A pushed descriptor cannot be dynamic, so it addresses the block directly
+        if (mReq.mUsePushDescriptors) {
+            bufferInfo.setOffset(mPodAllocation.getOffset());
+        }
+
+        // pod arguments follow all others, so the pod_ubo binding is the last slot
+        assert(!mArgumentDescriptorInfo.empty()
+               && mReq.mArgumentsTemplateEntries.back().dstBinding == static_cast<std::uint32_t>(found->mBinding));
+        mArgumentDescriptorInfo.back().mBuffer = bufferInfo;
+    }
+
+    void invocation::writeArgumentDescriptor() {
+        vector<vk::WriteDescriptorSet> writes;
+        writes.reserve(mReq.mArgumentsTemplateEntries.size());
+
+        for (std::size_t i = 0; i < mReq.mArgumentsTemplateEntries.size(); ++i) {
+            const auto& entry = mReq.mArgumentsTemplateEntries[i];
+            const auto& info = mArgumentDescriptorInfo[i];
+
+            vk::WriteDescriptorSet argSet;
+            argSet.setDstSet(mArgumentsDescriptor.get())
+                    .setDstBinding(entry.dstBinding)
+                    .setDescriptorCount(1)
+                    .setDescriptorType(entry.descriptorType);
+
+            switch (entry.descriptorType) {
                 case vk::DescriptorType::eStorageImage:
                 case vk::DescriptorType::eSampledImage:
                 case vk::DescriptorType::eSampler:
                 case vk::DescriptorType::eCombinedImageSampler:
-                    a.setPImageInfo(&(*nextImage));
-                    ++nextImage;
+                    argSet.setPImageInfo(reinterpret_cast<const vk::DescriptorImageInfo*>(&info.mImage));
                     break;
 
                 case vk::DescriptorType::eUniformBuffer:
+                case vk::DescriptorType::eUniformBufferDynamic:
                 case vk::DescriptorType::eStorageBuffer:
-                    a.setPBufferInfo(&(*nextBuffer));
-                    ++nextBuffer;
+                    argSet.setPBufferInfo(reinterpret_cast<const vk::DescriptorBufferInfo*>(&info.mBuffer));
                     break;
 
                 default:
                     assert(0 && "unkown argument type");
             }
+
+            writes.push_back(argSet);
         }
 
-        //
-        // Do the actual descriptor set updates
-        //
-        mReq.mDevice.getDevice().updateDescriptorSets(mArgumentDescriptorWrites, nullptr);
+        mReq.mDevice.getDevice().updateDescriptorSets(writes, nullptr);
     }
 
-    void invocation::fillCommandBuffer(vk::CommandBuffer commandBuffer, const vk::Extent3D& num_workgroups)
+    void invocation::updateDescriptorSets() {
+        uploadPodArguments();
+
+        // pushed descriptors are written when the command buffer is filled
+        if (mReq.mUsePushDescriptors || !mArgumentsDescriptor) {
+            return;
+        }
+
+        if (mReq.mArgumentsTemplate) {
+            mReq.mDevice.getDevice().updateDescriptorSetWithTemplateKHR(mArgumentsDescriptor.get(),
+                                                                        mReq.mArgumentsTemplate,
+                                                                        mArgumentDescriptorInfo.data(),
+                                                                        mReq.mDevice.getExtensionDispatch());
+        }
+        else {
+            writeArgumentDescriptor();
+        }
+    }
+
+    void invocation::fillCommandBuffer(vk::CommandBuffer                             commandBuffer,
+                                       const vk::Extent3D&                           num_workgroups,
+                                       vk::ArrayProxy<const vk::BufferMemoryBarrier> bufferBarriers,
+                                       vk::ArrayProxy<const vk::ImageMemoryBarrier>  imageBarriers)
     {
-        auto pipeline = mReq.mGetPipelineFn(mSpecConstantArguments);
+        mPipeline = mReq.mGetPipelineFn(mSpecConstantArguments);
 
-        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, **mPipeline);
 
-        vk::DescriptorSet descriptors[] = { mReq.mLiteralSamplerDescriptor, mReq.mArgumentsDescriptor };
+        vk::DescriptorSet descriptors[] = { mReq.mLiteralSamplerDescriptor, mArgumentsDescriptor.get() };
         std::uint32_t numDescriptors = (descriptors[0] ? 2 : 1);
         if (1 == numDescriptors) descriptors[0] = descriptors[1];
 
-        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
-                                         mReq.mPipelineLayout,
-                                         0,
-                                         { numDescriptors, descriptors },
-                                         nullptr);
+        // a kernel whose arguments are all push constants, or whose arguments are pushed, has
+        // no arguments descriptor
+        if (!descriptors[numDescriptors - 1]) --numDescriptors;
 
-        commandBuffer.resetQueryPool(*mQueryPool, kTimestamp_first, kTimestamp_count);
+        if (numDescriptors > 0) {
+            // the pod_ubo block, if any, is the only dynamic descriptor
+            const std::uint32_t podOffset = static_cast<std::uint32_t>(mPodAllocation.getOffset());
+            const bool hasDynamicOffset = (mPodAllocation && mArgumentsDescriptor);
 
-        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader,
-                                     *mQueryPool,
-                                     kTimestamp_startOfExecution);
+            commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                             mReq.mPipelineLayout,
+                                             0,
+                                             { numDescriptors, descriptors },
+                                             { hasDynamicOffset ? 1u : 0u, &podOffset });
+        }
 
-        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
-                                      vk::PipelineStageFlagBits::eComputeShader,
-                                      vk::DependencyFlags(),
-                                      nullptr,    // memory barriers
-                                      mBufferMemoryBarriers,    // buffer memory barriers
-                                      mImageMemoryBarriers);    // image memory barriers
+        if (mReq.mUsePushDescriptors) {
+            commandBuffer.pushDescriptorSetWithTemplateKHR(mReq.mArgumentsTemplate,
+                                                           mReq.mPipelineLayout,
+                                                           mReq.mLiteralSamplerDescriptor ? 1 : 0,
+                                                           mArgumentDescriptorInfo.data(),
+                                                           mReq.mDevice.getExtensionDispatch());
+        }
 
-        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader,
-                                     *mQueryPool,
-                                     kTimestamp_postHostBarrier);
+        if (hasPushConstants()) {
+            if (mPodArguments.empty()) {
+                fail_runtime_error("push constant arguments have not been set");
+            }
 
-        commandBuffer.dispatch(num_workgroups.width, num_workgroups.height, num_workgroups.depth);
+            // arguments packed individually may not reach the end of the range
+            if (mPodArguments.size() < mReq.mPushConstantRange.size) {
+                mPodArguments.resize(mReq.mPushConstantRange.size);
+            }
 
-        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eComputeShader,
-                                     *mQueryPool,
-                                     kTimestamp_postExecution);
-    }
+            commandBuffer.pushConstants(mReq.mPipelineLayout,
+                                        mReq.mPushConstantRange.stageFlags,
+                                        mReq.mPushConstantRange.offset,
+                                        mReq.mPushConstantRange.size,
+                                        mPodArguments.data());
+        }
+
+        mTimestamps.reset(commandBuffer);
+
+        mTimestamps.writeTimestamp(commandBuffer,
+                                   vk::PipelineStageFlagBits::eComputeShader,
+                                   kTimestamp_startOfExecution);
+
+        if (!bufferBarriers.empty() || !imageBarriers.empty()) {
+            vk::AccessFlags srcAccess;
+            for (auto& b : bufferBarriers) srcAccess |= b.srcAccessMask;
+            for (auto& b : imageBarriers) srcAccess |= b.srcAccessMask;
+
+            commandBuffer.pipelineBarrier(vulkan_utils::getAccessStages(srcAccess),
+                                          vk::PipelineStageFlagBits::eComputeShader,
+                                          vk::DependencyFlags(),
+                                          nullptr,          // memory barriers
+                                          bufferBarriers,   // buffer memory barriers
+                                          imageBarriers);   // image memory barriers
+        }
 
-    void invocation::submitCommand(vk::CommandBuffer commandBuffer) {
-        vk::CommandBuffer rawCommand = commandBuffer;
-        vk::SubmitInfo submitInfo;
-        submitInfo.setCommandBufferCount(1)
-                .setPCommandBuffers(&rawCommand);
+        mTimestamps.writeTimestamp(commandBuffer,
+                                   vk::PipelineStageFlagBits::eComputeShader,
+                                   kTimestamp_postHostBarrier);
 
-        mReq.mDevice.getComputeQueue().submit(submitInfo, nullptr);
+        commandBuffer.dispatch(num_workgroups.width, num_workgroups.height, num_workgroups.depth);
 
+        mTimestamps.writeTimestamp(commandBuffer,
+                                   vk::PipelineStageFlagBits::eComputeShader,
+                                   kTimestamp_postExecution);
     }
 
     execution_time_t invocation::run(const vk::Extent3D& num_workgroups) {
-        const auto commandBuffer = vulkan_utils::allocate_command_buffer(mReq.mDevice.getDevice(), mReq.mDevice.getCommandPool());
+        record(num_workgroups);
+        return submit();
+    }
+
+    void invocation::record(const vk::Extent3D& numWorkgroups) {
+        if (!mCommandBuffer) {
+            mCommandBuffer = vulkan_utils::allocate_command_buffer(mReq.mDevice.getDevice(),
+                                                                   mReq.mDevice.getCommandPool(mQueueRole));
+        }
 
-        commandBuffer->begin(vk::CommandBufferBeginInfo());
-        dispatch(*commandBuffer, num_workgroups);
-        commandBuffer->end();
+        // the command pool is created with eResetCommandBuffer, so begin() implicitly resets
+        // any previous recording
+        mCommandBuffer->begin(vk::CommandBufferBeginInfo());
+        dispatch(*mCommandBuffer, numWorkgroups);
+        mCommandBuffer->end();
+    }
+
+    execution_time_t invocation::submit() {
+        if (!mCommandBuffer) {
+            fail_runtime_error("invocation must be recorded before it is submitted");
+        }
 
         auto start = std::chrono::high_resolution_clock::now();
-        submitCommand(*commandBuffer);
-        mReq.mDevice.getComputeQueue().waitIdle();
+        submitAsync().wait();
         auto end = std::chrono::high_resolution_clock::now();
 
         execution_time_t result = getExecutionTime();
@@ -308,22 +476,52 @@ namespace clspv_utils {
         return result;
     }
 
+    completion invocation::submitAsync(vk::ArrayProxy<const vk::Semaphore> waitSemaphores,
+                                       vk::ArrayProxy<const vk::Semaphore> signalSemaphores) {
+        if (!mCommandBuffer) {
+            fail_runtime_error("invocation must be recorded before it is submitted");
+        }
+
+        mLastSubmission = submitCommand(mReq.mDevice,
+                                        mReq.mDevice.getQueue(mQueueRole).mQueue,
+                                        *mCommandBuffer,
+                                        waitSemaphores,
+                                        signalSemaphores);
+        return mLastSubmission;
+    }
+
+    void invocation::setQueue(device::queue_role role) {
+        if (mCommandBuffer) {
+            fail_runtime_error("invocation queue must be selected before it is recorded");
+        }
+        if (!(mReq.mDevice.getQueue(role).mFlags & vk::QueueFlagBits::eCompute)) {
+            fail_runtime_error("invocations must be submitted to a compute queue");
+        }
+
+        mQueueRole = role;
+    }
+
     void invocation::dispatch(vk::CommandBuffer commandBuffer, const vk::Extent3D& numWorkgroups)
     {
+        // Only the barriers which order a prior access to an argument are needed
+        vector<vk::BufferMemoryBarrier> bufferBarriers;
+        std::copy_if(mBufferMemoryBarriers.begin(), mBufferMemoryBarriers.end(),
+                     std::back_inserter(bufferBarriers),
+                     [](const vk::BufferMemoryBarrier& b) { return vulkan_utils::isBarrierRequired(b); });
+
+        vector<vk::ImageMemoryBarrier> imageBarriers;
+        std::copy_if(mImageMemoryBarriers.begin(), mImageMemoryBarriers.end(),
+                     std::back_inserter(imageBarriers),
+                     [](const vk::ImageMemoryBarrier& b) { return vulkan_utils::isBarrierRequired(b); });
+
         updateDescriptorSets();
-        fillCommandBuffer(commandBuffer, numWorkgroups);
+        fillCommandBuffer(commandBuffer, numWorkgroups, bufferBarriers, imageBarriers);
     }
 
     execution_time_t invocation::getExecutionTime()
     {
         uint64_t timestamps[kTimestamp_count];
-        mReq.mDevice.getDevice().getQueryPoolResults(*mQueryPool,
-                                                     kTimestamp_first,
-                                                     kTimestamp_count,
-                                                     sizeof(uint64_t),
-                                                     timestamps,
-                                                     sizeof(uint64_t),
-                                                     vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+        mTimestamps.getResults(timestamps);
 
         execution_time_t result;
         result.timestamps.start = timestamps[kTimestamp_startOfExecution];
@@ -332,4 +530,20 @@ namespace clspv_utils {
         return result;
     }
 
+    bool invocation::tryGetExecutionTime(execution_time_t& result)
+    {
+        // Until a resubmission has reset them, the queries still hold the previous execution's
+        // results, so its completion is checked first
+        uint64_t timestamps[kTimestamp_count];
+        if (!mLastSubmission.poll() || !mTimestamps.tryGetResults(timestamps)) {
+            return false;
+        }
+
+        result = execution_time_t();
+        result.timestamps.start = timestamps[kTimestamp_startOfExecution];
+        result.timestamps.host_barrier = timestamps[kTimestamp_postHostBarrier];
+        result.timestamps.execution = timestamps[kTimestamp_postExecution];
+        return true;
+    }
+
 } // namespace clspv_utils
@@ -8,12 +8,17 @@
 #include "clspv_utils_fwd.hpp"
 
 #include "clspv_utils_interop.hpp"
+#include "completion.hpp"
+#include "descriptor_ring.hpp"
 #include "device.hpp"
 #include "interface.hpp"
 #include "invocation_req.hpp"
+#include "timestamp_pool.hpp"
+#include "uniform_ring.hpp"
 
 #include <chrono>
 #include <memory>
+#include <type_traits>
 
 #include <vulkan/vulkan.hpp>
 
@@ -48,6 +53,18 @@ namespace clspv_utils {
                     ~invocation();
 
         void    addStorageBufferArgument(vulkan_utils::buffer& buffer);
+
+        // clspv's descriptor map does not say whether a kernel writes a storage buffer. Clients
+        // may declare that it does not, so that the buffer's barrier can be elided when no prior
+        // write needs to be made visible.
+        void    addReadOnlyStorageBufferArgument(vulkan_utils::buffer& buffer);
+
+        // Bind only a range of the buffer, such as one chunk of a vulkan_utils::chunked_buffer.
+        // The barrier covers only the range, so invocations of disjoint ranges in a batch are
+        // not ordered against each other.
+        void    addStorageBufferArgument(vulkan_utils::buffer& buffer, vk::DeviceSize offset, vk::DeviceSize range);
+        void    addReadOnlyStorageBufferArgument(vulkan_utils::buffer& buffer, vk::DeviceSize offset, vk::DeviceSize range);
+
         void    addUniformBufferArgument(vulkan_utils::buffer& buffer);
         void    addCombinedImageSampler(vulkan_utils::image& image);
         void    addReadOnlyImageArgument(vulkan_utils::image& image);
@@ -55,9 +72,61 @@ namespace clspv_utils {
         void    addSamplerArgument(vk::Sampler samp);
         void    addLocalArraySizeArgument(unsigned int numElements);
 
+        // Add the next pod argument. The value is packed at the offset given for the argument
+        // in the spvmap, and passed to the kernel either as push constants or through the
+        // device's uniform ring, depending on how the kernel was compiled.
+        void    addPodArgument(const void* data, std::size_t numBytes);
+
+        template <typename T>
+        void    addPodArgument(const T& value)
+        {
+            static_assert(std::is_standard_layout<T>::value, "pod arguments must have standard layout");
+            addPodArgument(&value, sizeof(value));
+        }
+
+        // Set the values of all remaining pod arguments at once, as a block laid out as described
+        // by the argument offsets in the spvmap.
+        void    setPodArguments(const void* data, std::size_t numBytes);
+
+        // Set the values of all pod_pushconstant arguments at once. The data must cover the
+        // kernel's push constant range.
+        void    setPushConstants(const void* data, std::size_t numBytes);
+
+        template <typename T>
+        void    setPushConstants(const T& data)
+        {
+            setPushConstants(&data, sizeof(data));
+        }
+
+        // Return true if the kernel's pod arguments are passed as push constants
+        bool    hasPushConstants() const { return mReq.mPushConstantRange.size > 0; }
+
+        // Select the queue to which the invocation is submitted, kQueue_compute by default. The
+        // queue must support compute, and must be selected before the invocation is recorded.
+        void                setQueue(device::queue_role role);
+
         // Execute the invocation synchronously.
         execution_time_t    run(const vk::Extent3D& num_workgroups);
 
+        // Record the invocation into a command buffer owned by the invocation. The command buffer,
+        // descriptor writes and barriers are retained so that the invocation can be executed
+        // repeatedly via submit() without being rebuilt. The command buffer comes from the calling
+        // thread's command pool, so the invocation must be re-recorded and destroyed on that
+        // thread; it may be submitted from any thread.
+        void                record(const vk::Extent3D& numWorkgroups);
+
+        // Execute the most recently recorded command buffer synchronously.
+        execution_time_t    submit();
+
+        // Submit the most recently recorded command buffer without waiting for it to complete.
+        // Once the returned completion has signaled, getExecutionTime() reports its timing. The
+        // invocation must not be re-recorded or destroyed until then. The submission waits for
+        // waitSemaphores and signals signalSemaphores, to order it against work on other queues.
+        completion          submitAsync(vk::ArrayProxy<const vk::Semaphore> waitSemaphores = nullptr,
+                                        vk::ArrayProxy<const vk::Semaphore> signalSemaphores = nullptr);
+
+        bool                isRecorded() const { return (bool)mCommandBuffer; }
+
         // Record the invocation into the command buffer. The client is responsible for submitting
         // the command buffer and waiting for completion.
         void                dispatch(vk::CommandBuffer commandBuffer,
@@ -67,13 +136,23 @@ namespace clspv_utils {
         // careful to avoid races if the invocation is dispatched multiple times!
         execution_time_t    getExecutionTime();
 
+        // Like getExecutionTime(), but return false rather than wait if the most recent
+        // execution has not yet completed. This lets a timing loop collect the results of an
+        // earlier submission while later ones are in flight.
+        bool                tryGetExecutionTime(execution_time_t& result);
+
 
         void    swap(invocation& other);
 
     private:
-        void    fillCommandBuffer(vk::CommandBuffer commandBuffer, const vk::Extent3D&    num_workgroups);
+        friend class invocation_batch;
+        friend class task_graph;
+
         void    updateDescriptorSets();
-        void    submitCommand(vk::CommandBuffer commandBuffer);
+        void    fillCommandBuffer(vk::CommandBuffer                             commandBuffer,
+                                  const vk::Extent3D&                           num_workgroups,
+                                  vk::ArrayProxy<const vk::BufferMemoryBarrier> bufferBarriers,
+                                  vk::ArrayProxy<const vk::ImageMemoryBarrier>  imageBarriers);
 
         // Sanity check that the nth argument (specified by ordinal) has the indicated
         // spvmap type. Throw an exception if false. Return the binding number if true.
@@ -82,6 +161,18 @@ namespace clspv_utils {
 
         std::size_t countArguments() const;
 
+        // Validate that the next argument is a descriptor of the given type, and return its slot
+        // in the packed descriptor info
+        arg_descriptor_info_t&  nextDescriptorArgument(vk::DescriptorType kind);
+
+        // Write the arguments descriptor without an update template
+        void    writeArgumentDescriptor();
+
+        // Return the spec of the next argument, which must be a pod argument
+        const arg_spec_t&   nextPodArgument() const;
+
+        void    uploadPodArguments();
+
     private:
         enum Timestamp {
             kTimestamp_startOfExecution    = 0,
@@ -94,16 +185,22 @@ namespace clspv_utils {
 
     private:
         invocation_req_t                    mReq;
-        vk::UniqueQueryPool                 mQueryPool;
+        device::queue_role                  mQueueRole  = device::kQueue_compute;
+        timestamp_pool::allocation          mTimestamps;
+        vk::UniqueCommandBuffer             mCommandBuffer;
+        descriptor_ring::lease              mArgumentsDescriptor;
+        shared_ptr<vk::UniquePipeline>      mPipeline;
+        completion                          mLastSubmission;
 
         vector<vk::BufferMemoryBarrier>     mBufferMemoryBarriers;
         vector<vk::ImageMemoryBarrier>      mImageMemoryBarriers;
 
-        vector<vk::DescriptorImageInfo>     mImageArgumentInfo;
-        vector<vk::DescriptorBufferInfo>    mBufferArgumentInfo;
-
-        vector<vk::WriteDescriptorSet>      mArgumentDescriptorWrites;
+        vector<arg_descriptor_info_t>       mArgumentDescriptorInfo;
+        std::size_t                         mNumDescriptorArguments = 0;
         vector<std::uint32_t>               mSpecConstantArguments;
+        vector<std::uint8_t>                mPodArguments;
+        std::size_t                         mNumPodArguments    = 0;
+        uniform_ring::allocation            mPodAllocation;
     };
 
     inline void swap(invocation & lhs, invocation & rhs)
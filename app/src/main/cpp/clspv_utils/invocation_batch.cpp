@@ -0,0 +1,285 @@
+//
+// Created on 10/18/26.
+//
+
+#include "invocation_batch.hpp"
+
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    using namespace clspv_utils;
+
+    struct resource_access {
+        bool    mRead       = false;
+        bool    mWritten    = false;
+    };
+
+    const vk::AccessFlags kWriteAccess = vk::AccessFlagBits::eShaderWrite;
+
+    // On the first use of a resource in the batch, the barrier recorded by the invocation orders
+    // it against work that preceded the batch, and is required only if that work touched it.
+    // Later, a barrier is required if this access conflicts with an access by an earlier
+    // dispatch in the batch, in which case it must also wait on that access.
+    template <typename Handle, typename Barrier>
+    bool is_barrier_required(const map<Handle, resource_access>&  history,
+                             Handle                               resource,
+                             Barrier&                             barrier)
+    {
+        const auto found = history.find(resource);
+        if (found == history.end()) {
+            return vulkan_utils::isBarrierRequired(barrier);
+        }
+
+        const bool isWrite = (bool)(barrier.dstAccessMask & kWriteAccess);
+        if (!found->second.mWritten && !isWrite) {
+            return false;
+        }
+
+        if (found->second.mWritten) barrier.srcAccessMask |= kWriteAccess;
+        if (found->second.mRead) barrier.srcAccessMask |= vk::AccessFlagBits::eShaderRead;
+        return true;
+    }
+
+    template <typename Handle>
+    void note_access(map<Handle, resource_access>& history, Handle resource, vk::AccessFlags dstAccess)
+    {
+        auto& access = history[resource];
+        if (dstAccess & kWriteAccess) {
+            access.mWritten = true;
+        }
+        else {
+            access.mRead = true;
+        }
+    }
+
+    // Buffers are tracked by range, so that dispatches to disjoint chunks of a buffer need not
+    // wait for each other
+    struct range_access {
+        vk::DeviceSize  mOffset = 0;
+        vk::DeviceSize  mSize   = VK_WHOLE_SIZE;
+        resource_access mAccess;
+    };
+
+    bool is_overlapping(const range_access& r, const vk::BufferMemoryBarrier& barrier)
+    {
+        const bool rIsBefore = (VK_WHOLE_SIZE != r.mSize && r.mOffset + r.mSize <= barrier.offset);
+        const bool barrierIsBefore = (VK_WHOLE_SIZE != barrier.size && barrier.offset + barrier.size <= r.mOffset);
+        return !rIsBefore && !barrierIsBefore;
+    }
+
+    bool is_barrier_required(const map<vk::Buffer, vector<range_access>>&   history,
+                             vk::BufferMemoryBarrier&                       barrier)
+    {
+        const auto found = history.find(barrier.buffer);
+        if (found == history.end()) {
+            // The first use orders the whole buffer against work preceding the batch, so that
+            // later uses of other ranges need not
+            barrier.setOffset(0)
+                   .setSize(VK_WHOLE_SIZE);
+            return vulkan_utils::isBarrierRequired(barrier);
+        }
+
+        resource_access earlier;
+        for (auto& r : found->second) {
+            if (is_overlapping(r, barrier)) {
+                earlier.mRead |= r.mAccess.mRead;
+                earlier.mWritten |= r.mAccess.mWritten;
+            }
+        }
+
+        const bool isWrite = (bool)(barrier.dstAccessMask & kWriteAccess);
+        if (!earlier.mWritten && !(isWrite && earlier.mRead)) {
+            return false;
+        }
+
+        if (earlier.mWritten) barrier.srcAccessMask |= kWriteAccess;
+        if (earlier.mRead) barrier.srcAccessMask |= vk::AccessFlagBits::eShaderRead;
+        return true;
+    }
+
+    void note_access(map<vk::Buffer, vector<range_access>>& history, const vk::BufferMemoryBarrier& barrier)
+    {
+        range_access r;
+        r.mOffset = barrier.offset;
+        r.mSize = barrier.size;
+        if (barrier.dstAccessMask & kWriteAccess) {
+            r.mAccess.mWritten = true;
+        }
+        else {
+            r.mAccess.mRead = true;
+        }
+        history[barrier.buffer].push_back(r);
+    }
+
+} // anonymous namespace
+
+namespace clspv_utils {
+
+    invocation_batch::invocation_batch()
+    {
+        // this space intentionally left blank
+    }
+
+    invocation_batch::invocation_batch(device inDevice)
+            : mDevice(inDevice)
+    {
+    }
+
+    invocation_batch::invocation_batch(invocation_batch&& other)
+            : invocation_batch()
+    {
+        swap(other);
+    }
+
+    invocation_batch::~invocation_batch()
+    {
+    }
+
+    invocation_batch& invocation_batch::operator=(invocation_batch&& other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    void invocation_batch::swap(invocation_batch& other)
+    {
+        using std::swap;
+
+        swap(mDevice, other.mDevice);
+        swap(mQueueRole, other.mQueueRole);
+        swap(mEntries, other.mEntries);
+        swap(mCommandBuffer, other.mCommandBuffer);
+        swap(mIsRecorded, other.mIsRecorded);
+    }
+
+    void invocation_batch::addInvocation(invocation& inv, const vk::Extent3D& numWorkgroups)
+    {
+        if (inv.mReq.mDevice.getDevice() != mDevice.getDevice()) {
+            fail_runtime_error("invocations in a batch must share the batch's device");
+        }
+
+        // An invocation's descriptor set and pod arguments are rewritten each time it is
+        // recorded, so it can only be recorded once per batch.
+        const auto isDuplicate = std::any_of(mEntries.begin(), mEntries.end(), [&inv](const entry& e) {
+            return e.mInvocation == &inv;
+        });
+        if (isDuplicate) {
+            fail_runtime_error("an invocation cannot be added to a batch more than once");
+        }
+
+        entry newEntry;
+        newEntry.mInvocation = &inv;
+        newEntry.mNumWorkgroups = numWorkgroups;
+        mEntries.push_back(newEntry);
+
+        mIsRecorded = false;
+    }
+
+    void invocation_batch::setQueue(device::queue_role role)
+    {
+        if (mCommandBuffer) {
+            fail_runtime_error("batch queue must be selected before it is recorded");
+        }
+        if (!(mDevice.getQueue(role).mFlags & vk::QueueFlagBits::eCompute)) {
+            fail_runtime_error("invocations must be submitted to a compute queue");
+        }
+
+        mQueueRole = role;
+    }
+
+    void invocation_batch::record()
+    {
+        if (mEntries.empty()) {
+            fail_runtime_error("cannot record an empty invocation batch");
+        }
+
+        if (!mCommandBuffer) {
+            mCommandBuffer = vulkan_utils::allocate_command_buffer(mDevice.getDevice(), mDevice.getCommandPool(mQueueRole));
+        }
+
+        map<vk::Buffer, vector<range_access>>   bufferHistory;
+        map<vk::Image, resource_access>     imageHistory;
+
+        vector<vk::BufferMemoryBarrier>     bufferBarriers;
+        vector<vk::ImageMemoryBarrier>      imageBarriers;
+
+        mCommandBuffer->begin(vk::CommandBufferBeginInfo());
+
+        for (auto& e : mEntries) {
+            invocation& inv = *e.mInvocation;
+
+            bufferBarriers.clear();
+            for (auto b : inv.mBufferMemoryBarriers) {
+                if (is_barrier_required(bufferHistory, b)) {
+                    bufferBarriers.push_back(b);
+                }
+            }
+
+            // Image barriers which change layout are always required
+            imageBarriers.clear();
+            for (auto b : inv.mImageMemoryBarriers) {
+                if (is_barrier_required(imageHistory, b.image, b) || b.oldLayout != b.newLayout) {
+                    imageBarriers.push_back(b);
+                }
+            }
+
+            for (auto& b : inv.mBufferMemoryBarriers) {
+                note_access(bufferHistory, b);
+            }
+            for (auto& b : inv.mImageMemoryBarriers) {
+                note_access(imageHistory, b.image, b.dstAccessMask);
+            }
+
+            e.mBarrierCount = bufferBarriers.size() + imageBarriers.size();
+
+            inv.updateDescriptorSets();
+            inv.fillCommandBuffer(*mCommandBuffer, e.mNumWorkgroups, bufferBarriers, imageBarriers);
+        }
+
+        mCommandBuffer->end();
+        mIsRecorded = true;
+    }
+
+    execution_time_t invocation_batch::run()
+    {
+        if (!mIsRecorded) {
+            record();
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        submitAsync().wait();
+        auto end = std::chrono::high_resolution_clock::now();
+
+        const execution_time_t first = mEntries.front().mInvocation->getExecutionTime();
+        const execution_time_t last = mEntries.back().mInvocation->getExecutionTime();
+
+        execution_time_t result;
+        result.cpu_duration = end - start;
+        result.timestamps.start = first.timestamps.start;
+        result.timestamps.host_barrier = first.timestamps.host_barrier;
+        result.timestamps.execution = last.timestamps.execution;
+        return result;
+    }
+
+    completion invocation_batch::submitAsync(vk::ArrayProxy<const vk::Semaphore> waitSemaphores,
+                                             vk::ArrayProxy<const vk::Semaphore> signalSemaphores)
+    {
+        if (!mIsRecorded) {
+            record();
+        }
+
+        completion result = submitCommand(mDevice,
+                                          mDevice.getQueue(mQueueRole).mQueue,
+                                          *mCommandBuffer,
+                                          waitSemaphores,
+                                          signalSemaphores);
+        for (auto& e : mEntries) {
+            e.mInvocation->mLastSubmission = result;
+        }
+        return result;
+    }
+
+} // namespace clspv_utils
@@ -0,0 +1,88 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVUTILS_INVOCATION_BATCH_HPP
+#define CLSPVUTILS_INVOCATION_BATCH_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+#include "completion.hpp"
+#include "device.hpp"
+#include "invocation.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+namespace clspv_utils {
+
+    // An invocation_batch records dispatches of several invocations, possibly of different
+    // kernels, into a single command buffer which is submitted once. A memory barrier is only
+    // recorded for a resource when it is first used in the batch, or when an earlier dispatch in
+    // the batch has a conflicting access to it.
+    //
+    // Invocations are referenced, not copied. Each must outlive the execution of the batch, and
+    // must not be re-recorded while the batch is executing. Invocations should be added in the
+    // order their arguments were added, since image layout transitions are computed then.
+    class invocation_batch {
+    public:
+                            invocation_batch();
+
+        explicit            invocation_batch(device inDevice);
+
+                            invocation_batch(invocation_batch&& other);
+
+                            ~invocation_batch();
+
+        invocation_batch&   operator=(invocation_batch&& other);
+
+        void                swap(invocation_batch& other);
+
+        void                addInvocation(invocation& inv, const vk::Extent3D& numWorkgroups);
+
+        // Select the queue to which the batch is submitted, as for invocation::setQueue
+        void                setQueue(device::queue_role role);
+
+        std::size_t         size() const { return mEntries.size(); }
+
+        // Record all dispatches into the batch's command buffer.
+        void                record();
+
+        bool                isRecorded() const { return mIsRecorded; }
+
+        // The number of buffer and image barriers recorded before the index'th dispatch, once
+        // the batch is recorded
+        std::size_t         getBarrierCount(std::size_t index) const { return mEntries[index].mBarrierCount; }
+
+        // Execute the batch synchronously, recording it first if necessary. The timestamps span
+        // the start of the first dispatch to the end of the last; per-dispatch timing is
+        // available from each invocation's getExecutionTime().
+        execution_time_t    run();
+
+        // Submit the batch without waiting for it to complete, recording it first if necessary.
+        // The submission waits for waitSemaphores and signals signalSemaphores.
+        completion          submitAsync(vk::ArrayProxy<const vk::Semaphore> waitSemaphores = nullptr,
+                                        vk::ArrayProxy<const vk::Semaphore> signalSemaphores = nullptr);
+
+    private:
+        struct entry {
+            invocation*     mInvocation = nullptr;
+            vk::Extent3D    mNumWorkgroups;
+            std::size_t     mBarrierCount   = 0;
+        };
+
+    private:
+        device                  mDevice;
+        device::queue_role      mQueueRole  = device::kQueue_compute;
+        vector<entry>           mEntries;
+        vk::UniqueCommandBuffer mCommandBuffer;
+        bool                    mIsRecorded = false;
+    };
+
+    inline void swap(invocation_batch& lhs, invocation_batch& rhs)
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#endif //CLSPVUTILS_INVOCATION_BATCH_HPP
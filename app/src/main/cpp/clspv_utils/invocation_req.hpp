@@ -7,6 +7,7 @@
 
 #include "clspv_utils_fwd.hpp"
 
+#include "descriptor_ring.hpp"
 #include "device.hpp"
 
 #include <vulkan/vulkan.hpp>
@@ -16,16 +17,25 @@
 namespace clspv_utils {
 
     struct invocation_req_t {
-        typedef std::function<vk::Pipeline (vk::ArrayProxy<std::uint32_t>)> get_pipeline_fn;
+        typedef std::function<shared_ptr<vk::UniquePipeline> (vk::ArrayProxy<std::uint32_t>)> get_pipeline_fn;
 
         device              mDevice;
         kernel_spec_t       mKernelSpec;
 
-        vk::PipelineLayout  mPipelineLayout;
+        vk::PipelineLayout      mPipelineLayout;
+        vk::PushConstantRange   mPushConstantRange;
         get_pipeline_fn     mGetPipelineFn;
 
-        vk::DescriptorSet   mLiteralSamplerDescriptor;
-        vk::DescriptorSet   mArgumentsDescriptor;
+        vk::DescriptorSet               mLiteralSamplerDescriptor;
+        shared_ptr<descriptor_ring>     mArgumentsDescriptors;
+
+        // The arguments descriptor is written from a packed array of arg_descriptor_info_t laid
+        // out by these entries. mArgumentsTemplate is null if the device does not support update
+        // templates. If mUsePushDescriptors is set, there is no arguments descriptor set and the
+        // arguments are pushed when the invocation is recorded.
+        vector<vk::DescriptorUpdateTemplateEntry>   mArgumentsTemplateEntries;
+        vk::DescriptorUpdateTemplate                mArgumentsTemplate;
+        bool                                        mUsePushDescriptors = false;
     };
 }
 
@@ -6,18 +6,47 @@
 
 #include "vulkan_utils/vulkan_utils.hpp"
 
+#include <algorithm>
+
 namespace {
+    using namespace clspv_utils;
+
+    // The smallest maxPushDescriptors permitted by VK_KHR_push_descriptor. Kernels with more
+    // descriptor arguments than this fall back to descriptor sets.
+    const std::size_t kMinMaxPushDescriptors = 32;
 
     vk::UniquePipelineLayout create_pipeline_layout(vk::Device                                      device,
-                                                    vk::ArrayProxy<const vk::DescriptorSetLayout>   layouts)
+                                                    vk::ArrayProxy<const vk::DescriptorSetLayout>   layouts,
+                                                    vk::ArrayProxy<const vk::PushConstantRange>     pushConstantRanges)
     {
         vk::PipelineLayoutCreateInfo createInfo;
         createInfo.setSetLayoutCount(layouts.size())
-                .setPSetLayouts(layouts.data());
+                .setPSetLayouts(layouts.data())
+                .setPushConstantRangeCount(pushConstantRanges.size())
+                .setPPushConstantRanges(pushConstantRanges.data());
 
         return device.createPipelineLayoutUnique(createInfo);
     }
 
+    // The number of descriptors of each type in one set written by the template entries
+    vector<vk::DescriptorPoolSize> get_descriptor_pool_sizes(const vector<vk::DescriptorUpdateTemplateEntry>& entries)
+    {
+        vector<vk::DescriptorPoolSize> result;
+
+        for (auto& e : entries) {
+            auto found = std::find_if(result.begin(), result.end(), [&e](const vk::DescriptorPoolSize& ps) {
+                return ps.type == e.descriptorType;
+            });
+            if (found == result.end()) {
+                result.push_back(vk::DescriptorPoolSize(e.descriptorType, 0));
+                found = result.end() - 1;
+            }
+            found->descriptorCount += e.descriptorCount;
+        }
+
+        return result;
+    }
+
 }
 
 namespace clspv_utils {
@@ -29,18 +58,60 @@ namespace clspv_utils {
     kernel::kernel(kernel_req_t         layout,
                    const vk::Extent3D&  workgroup_sizes) :
             mReq(std::move(layout)),
-            mSpecConstants({ workgroup_sizes.width, workgroup_sizes.height, workgroup_sizes.depth })
+            mPipelinesMutex(std::make_shared<std::mutex>()),
+            mSpecConstants({ workgroup_sizes.width, workgroup_sizes.height, workgroup_sizes.depth }),
+            mPushConstantRange(getKernelPushConstantRange(mReq.mKernelSpec.mArguments))
     {
         if (-1 != getKernelArgumentDescriptorSet(mReq.mKernelSpec.mArguments)) {
-            mArgumentsLayout = createKernelArgumentDescriptorLayout(mReq.mKernelSpec.mArguments, mReq.mDevice.getDevice());
-
-            mArgumentsDescriptor = allocateDescriptorSet(mReq.mDevice, *mArgumentsLayout);
+            mUsePushDescriptors = mReq.mDevice.supportsPushDescriptors();
+            mArgumentsTemplateEntries = createKernelArgumentTemplateEntries(mReq.mKernelSpec.mArguments, mUsePushDescriptors);
+            if (mUsePushDescriptors && mArgumentsTemplateEntries.size() > kMinMaxPushDescriptors) {
+                mUsePushDescriptors = false;
+                mArgumentsTemplateEntries = createKernelArgumentTemplateEntries(mReq.mKernelSpec.mArguments, mUsePushDescriptors);
+            }
+
+            mArgumentsLayout = createKernelArgumentDescriptorLayout(mReq.mKernelSpec.mArguments,
+                                                                    mReq.mDevice.getDevice(),
+                                                                    mUsePushDescriptors);
+
+            // push descriptors are written into the command buffer, so there are no sets to recycle
+            if (!mUsePushDescriptors) {
+                mArgumentsDescriptors = std::make_shared<descriptor_ring>(mReq.mDevice,
+                                                                          *mArgumentsLayout,
+                                                                          get_descriptor_pool_sizes(mArgumentsTemplateEntries));
+            }
         }
 
         vector<vk::DescriptorSetLayout> layouts;
         if (mReq.mLiteralSamplerLayout) layouts.push_back(mReq.mLiteralSamplerLayout);
         if (mArgumentsLayout) layouts.push_back(*mArgumentsLayout);
-        mPipelineLayout = create_pipeline_layout(mReq.mDevice.getDevice(), layouts);
+
+        vector<vk::PushConstantRange> pushConstantRanges;
+        if (mPushConstantRange.size > 0) {
+            const auto maxSize = mReq.mDevice.getPhysicalDevice().getProperties().limits.maxPushConstantsSize;
+            if (mPushConstantRange.size > maxSize) {
+                fail_runtime_error("kernel's push constant arguments exceed the device's maxPushConstantsSize");
+            }
+            pushConstantRanges.push_back(mPushConstantRange);
+        }
+
+        mPipelineLayout = create_pipeline_layout(mReq.mDevice.getDevice(), layouts, pushConstantRanges);
+
+        if (mArgumentsLayout && mReq.mDevice.supportsDescriptorUpdateTemplates()) {
+            vk::DescriptorUpdateTemplateCreateInfo createInfo;
+            createInfo.setDescriptorUpdateEntryCount(mArgumentsTemplateEntries.size())
+                    .setPDescriptorUpdateEntries(mArgumentsTemplateEntries.data())
+                    .setTemplateType(mUsePushDescriptors ? vk::DescriptorUpdateTemplateType::ePushDescriptorsKHR
+                                                         : vk::DescriptorUpdateTemplateType::eDescriptorSet)
+                    .setDescriptorSetLayout(*mArgumentsLayout)
+                    .setPipelineBindPoint(vk::PipelineBindPoint::eCompute)
+                    .setPipelineLayout(*mPipelineLayout)
+                    .setSet(layouts.size() - 1);
+
+            mArgumentsTemplate = mReq.mDevice.getDevice().createDescriptorUpdateTemplateKHRUnique(createInfo,
+                                                                                                  nullptr,
+                                                                                                  mReq.mDevice.getExtensionDispatch());
+        }
     }
 
     kernel::~kernel() {
@@ -64,10 +135,18 @@ namespace clspv_utils {
 
         swap(mReq, other.mReq);
         swap(mArgumentsLayout, other.mArgumentsLayout);
-        swap(mArgumentsDescriptor, other.mArgumentsDescriptor);
+        swap(mArgumentsDescriptors, other.mArgumentsDescriptors);
         swap(mPipelineLayout, other.mPipelineLayout);
-        swap(mPipeline, other.mPipeline);
+        swap(mPipelinesMutex, other.mPipelinesMutex);
+        swap(mPipelines, other.mPipelines);
+        swap(mPipelineUseCount, other.mPipelineUseCount);
+        swap(mMaxCachedPipelines, other.mMaxCachedPipelines);
+        swap(mPipelineStats, other.mPipelineStats);
         swap(mSpecConstants, other.mSpecConstants);
+        swap(mPushConstantRange, other.mPushConstantRange);
+        swap(mArgumentsTemplateEntries, other.mArgumentsTemplateEntries);
+        swap(mArgumentsTemplate, other.mArgumentsTemplate);
+        swap(mUsePushDescriptors, other.mUsePushDescriptors);
     }
 
     invocation_req_t kernel::createInvocationReq() {
@@ -76,38 +155,92 @@ namespace clspv_utils {
         result.mDevice = mReq.mDevice;
         result.mKernelSpec = mReq.mKernelSpec;
         result.mPipelineLayout = *mPipelineLayout;
+        result.mPushConstantRange = mPushConstantRange;
         result.mGetPipelineFn = std::bind(&kernel::updatePipeline, this, std::placeholders::_1);
         result.mLiteralSamplerDescriptor = mReq.mLiteralSamplerDescriptor;
-        result.mArgumentsDescriptor = *mArgumentsDescriptor;
+        result.mArgumentsDescriptors = mArgumentsDescriptors;
+        result.mArgumentsTemplateEntries = mArgumentsTemplateEntries;
+        result.mArgumentsTemplate = *mArgumentsTemplate;
+        result.mUsePushDescriptors = mUsePushDescriptors;
+
+        return result;
+    }
+
+    shared_ptr<vk::UniquePipeline> kernel::updatePipeline(vk::ArrayProxy<uint32_t> otherSpecConstants) {
+        const spec_constant_list specConstants = getSpecConstants(otherSpecConstants);
 
+        {
+            std::lock_guard<std::mutex> lock(*mPipelinesMutex);
+
+            const auto found = mPipelines.find(specConstants);
+            if (found != mPipelines.end()) {
+                ++mPipelineStats.mHits;
+                found->second.mLastUse = ++mPipelineUseCount;
+                return found->second.mPipeline;
+            }
+
+            ++mPipelineStats.mMisses;
+        }
+
+        return addPipeline(specConstants, createPipeline(specConstants));
+    }
+
+    kernel::spec_constant_list kernel::getSpecConstants(vk::ArrayProxy<uint32_t> otherSpecConstants) const {
+        spec_constant_list result(mSpecConstants);
+        result.insert(result.end(), otherSpecConstants.begin(), otherSpecConstants.end());
         return result;
     }
 
-    vk::Pipeline kernel::updatePipeline(vk::ArrayProxy<uint32_t> otherSpecConstants) {
-        // TODO Consider case where there are multiple invocations active at one.
-        // In that case, we should not delete the previous pipeline!
-        // Thus, the pipeline really needs to be in a shared state.
+    vk::UniquePipeline kernel::createPipeline(spec_constant_list specConstants) const {
+        return vulkan_utils::create_compute_pipeline(mReq.mDevice.getDevice(),
+                                                     mReq.mShaderModule,
+                                                     mReq.mKernelSpec.mName.c_str(),
+                                                     *mPipelineLayout,
+                                                     mReq.mPipelineCache,
+                                                     specConstants);
+    }
+
+    shared_ptr<vk::UniquePipeline> kernel::addPipeline(const spec_constant_list& specConstants, vk::UniquePipeline pipeline) {
+        std::lock_guard<std::mutex> lock(*mPipelinesMutex);
 
-        // If the spec constants being passed are equal to the spec constants we already have,
-        // the existing pipeline is up to date.
-        if (mPipeline
-            && mSpecConstants.size() == otherSpecConstants.size() + 3
-            && std::equal(std::next(mSpecConstants.begin(), 3), mSpecConstants.end(),
-                                    otherSpecConstants.begin()) ) {
-            return *mPipeline;
+        // another thread may have compiled the same specialization meanwhile; keep its pipeline
+        cached_pipeline& cached = mPipelines[specConstants];
+        cached.mLastUse = ++mPipelineUseCount;
+        if (!cached.mPipeline) {
+            cached.mPipeline = std::make_shared<vk::UniquePipeline>(std::move(pipeline));
         }
 
-        mSpecConstants.resize(3 + otherSpecConstants.size());
-        std::copy(otherSpecConstants.begin(), otherSpecConstants.end(), std::next(mSpecConstants.begin(), 3));
+        // hold a reference, since eviction may remove the entry just added
+        shared_ptr<vk::UniquePipeline> result = cached.mPipeline;
+        evictPipelines();
+        return result;
+    }
+
+    void kernel::setMaxCachedPipelines(std::size_t maxPipelines) {
+        std::lock_guard<std::mutex> lock(*mPipelinesMutex);
+
+        mMaxCachedPipelines = maxPipelines;
+        evictPipelines();
+    }
 
-        mPipeline = vulkan_utils::create_compute_pipeline(mReq.mDevice.getDevice(),
-                                                          mReq.mShaderModule,
-                                                          mReq.mKernelSpec.mName.c_str(),
-                                                          *mPipelineLayout,
-                                                          mReq.mPipelineCache,
-                                                          mSpecConstants);
+    kernel::pipeline_stats kernel::getPipelineStats() const {
+        std::lock_guard<std::mutex> lock(*mPipelinesMutex);
+        return mPipelineStats;
+    }
+
+    void kernel::evictPipelines() {
+        if (0 == mMaxCachedPipelines) {
+            return;
+        }
 
-        return *mPipeline;
+        while (mPipelines.size() > mMaxCachedPipelines) {
+            const auto lru = std::min_element(mPipelines.begin(), mPipelines.end(),
+                                              [](const pipeline_map::value_type& lhs, const pipeline_map::value_type& rhs) {
+                                                  return lhs.second.mLastUse < rhs.second.mLastUse;
+                                              });
+            mPipelines.erase(lru);
+            ++mPipelineStats.mEvictions;
+        }
     }
 
 } // namespace clspv_utils
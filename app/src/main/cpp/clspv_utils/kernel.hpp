@@ -8,16 +8,28 @@
 #include "clspv_utils_fwd.hpp"
 
 #include "clspv_utils_interop.hpp"
+#include "descriptor_ring.hpp"
 #include "device.hpp"
 #include "interface.hpp"
 #include "invocation_req.hpp"
 #include "kernel_req.hpp"
 
+#include <mutex>
+
 #include <vulkan/vulkan.hpp>
 
 namespace clspv_utils {
 
+    // A kernel's pipeline cache and descriptor ring are internally synchronized, so invocations
+    // of one kernel may be created and recorded on several threads at once.
     class kernel {
+    public:
+        struct pipeline_stats {
+            std::size_t mHits       = 0;
+            std::size_t mMisses     = 0;
+            std::size_t mEvictions  = 0;
+        };
+
     public:
                             kernel();
 
@@ -35,22 +47,60 @@ namespace clspv_utils {
 
         const device&       getDevice() { return mReq.mDevice; }
 
-        vk::Pipeline        updatePipeline(vk::ArrayProxy<uint32_t> otherSpecConstants);
+        // Return the pipeline specialized with the given spec constants (beyond the workgroup
+        // size), creating it if it is not already cached. The pipeline is shared with the cache,
+        // so that it outlives its eviction for as long as an invocation holds it. Pipelines are
+        // compiled outside the cache's lock.
+        shared_ptr<vk::UniquePipeline>  updatePipeline(vk::ArrayProxy<uint32_t> otherSpecConstants);
+
+        // Bound the number of cached pipelines, evicting the least recently used ones when
+        // exceeded. Zero, the default, means no bound.
+        void                    setMaxCachedPipelines(std::size_t maxPipelines);
+
+        pipeline_stats          getPipelineStats() const;
 
         void                swap(kernel& other);
 
         invocation_req_t    createInvocationReq();
 
     private:
+        friend class module;
+
         typedef vector<std::uint32_t>   spec_constant_list;
 
+        struct cached_pipeline {
+            shared_ptr<vk::UniquePipeline>  mPipeline;
+            std::uint64_t                   mLastUse    = 0;
+        };
+
+        typedef map<spec_constant_list, cached_pipeline> pipeline_map;
+
+    private:
+        spec_constant_list              getSpecConstants(vk::ArrayProxy<uint32_t> otherSpecConstants) const;
+
+        // Compile a pipeline without touching the cache, so that it may be called concurrently
+        vk::UniquePipeline              createPipeline(spec_constant_list specConstants) const;
+
+        shared_ptr<vk::UniquePipeline>  addPipeline(const spec_constant_list& specConstants, vk::UniquePipeline pipeline);
+
+        // Called with mPipelinesMutex held
+        void    evictPipelines();
+
     private:
         kernel_req_t                    mReq;
         vk::UniqueDescriptorSetLayout   mArgumentsLayout;
-        vk::UniqueDescriptorSet         mArgumentsDescriptor;
+        shared_ptr<descriptor_ring>     mArgumentsDescriptors;
         vk::UniquePipelineLayout        mPipelineLayout;
-        vk::UniquePipeline              mPipeline;
+        shared_ptr<std::mutex>          mPipelinesMutex;
+        pipeline_map                    mPipelines;
+        std::uint64_t                   mPipelineUseCount   = 0;
+        std::size_t                     mMaxCachedPipelines = 0;
+        pipeline_stats                  mPipelineStats;
         spec_constant_list              mSpecConstants;
+        vk::PushConstantRange           mPushConstantRange;
+        vector<vk::DescriptorUpdateTemplateEntry>   mArgumentsTemplateEntries;
+        device::unique_update_template              mArgumentsTemplate;
+        bool                                        mUsePushDescriptors = false;
     };
 
     inline void swap(kernel& lhs, kernel& rhs)
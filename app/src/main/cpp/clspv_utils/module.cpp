@@ -7,15 +7,24 @@
 #include "interface.hpp"
 #include "kernel_req.hpp"
 
-#include <istream>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
 #include <functional>
+#include <iomanip>
+#include <istream>
+#include <iterator>
 #include <memory>
+#include <sstream>
+#include <thread>
 
 namespace {
     using namespace clspv_utils;
 
-    vk::UniqueShaderModule create_shader(vk::Device     device,
-                                         std::istream&  in)
+    vector<std::uint32_t> read_spirv(std::istream& in)
     {
         const auto savePos = in.tellg();
         in.seekg(0, std::ios_base::end);
@@ -31,13 +40,168 @@ namespace {
 
         in.read(reinterpret_cast<char*>(spvModule.data()), num_bytes);
 
+        return spvModule;
+    }
+
+    vk::UniqueShaderModule create_shader(vk::Device                     device,
+                                         const vector<std::uint32_t>&   spvModule)
+    {
         vk::ShaderModuleCreateInfo shaderModuleCreateInfo;
-        shaderModuleCreateInfo.setCodeSize(spvModule.size() * sizeof(decltype(spvModule)::value_type))
+        shaderModuleCreateInfo.setCodeSize(spvModule.size() * sizeof(std::uint32_t))
                 .setPCode(spvModule.data());
 
         return device.createShaderModuleUnique(shaderModuleCreateInfo);
     }
 
+    // 64-bit FNV-1a
+    std::uint64_t hash_spirv(const vector<std::uint32_t>& spvModule)
+    {
+        std::uint64_t result = 0xcbf29ce484222325ULL;
+
+        auto bytes = reinterpret_cast<const std::uint8_t*>(spvModule.data());
+        for (std::size_t i = 0; i < spvModule.size() * sizeof(std::uint32_t); ++i) {
+            result ^= bytes[i];
+            result *= 0x100000001b3ULL;
+        }
+
+        return result;
+    }
+
+    // Pipeline cache data is only usable by the same driver on the same kind of device, so the
+    // file is named for the device's pipeline cache UUID and driver version as well as the module
+    string pipeline_cache_path(const string&                        directory,
+                               const vk::PhysicalDeviceProperties&  properties,
+                               std::uint64_t                        spvHash)
+    {
+        std::ostringstream os;
+        os << directory << '/' << std::hex << std::setfill('0') << std::setw(16) << spvHash << '_';
+        for (auto b : properties.pipelineCacheUUID) {
+            os << std::setw(2) << static_cast<unsigned int>(b);
+        }
+        os << '_' << std::setw(8) << properties.driverVersion << ".pipelinecache";
+        return os.str();
+    }
+
+    // Check the header which begins all pipeline cache data against the device
+    bool is_pipeline_cache_compatible(const vector<std::uint8_t>&           data,
+                                      const vk::PhysicalDeviceProperties&   properties)
+    {
+        const std::size_t kHeaderSize = 4 * sizeof(std::uint32_t) + VK_UUID_SIZE;
+        if (data.size() < kHeaderSize) {
+            return false;
+        }
+
+        std::uint32_t header[4];
+        std::memcpy(header, data.data(), sizeof(header));
+
+        const std::uint32_t headerLength = header[0];
+        const std::uint32_t headerVersion = header[1];
+        const std::uint32_t vendorID = header[2];
+        const std::uint32_t deviceID = header[3];
+
+        return (headerLength >= kHeaderSize
+                && headerLength <= data.size()
+                && headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+                && vendorID == properties.vendorID
+                && deviceID == properties.deviceID
+                && 0 == std::memcmp(data.data() + sizeof(header), properties.pipelineCacheUUID, VK_UUID_SIZE));
+    }
+
+    // Return the saved pipeline cache data, or nothing if there is none or it is unusable
+    vector<std::uint8_t> load_pipeline_cache(const string&                          path,
+                                             const vk::PhysicalDeviceProperties&    properties)
+    {
+        vector<std::uint8_t> result;
+
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        if (in) {
+            result.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            if (in.bad() || !is_pipeline_cache_compatible(result, properties)) {
+                result.clear();
+            }
+        }
+
+        return result;
+    }
+
+    // Write the data to a temporary file and rename it into place, so that an interrupted save
+    // cannot leave a truncated file behind
+    void save_file(const string& path, const void* data, std::size_t numBytes)
+    {
+        const string tempPath = path + ".tmp";
+
+        std::ofstream out(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        out.write(static_cast<const char*>(data), numBytes);
+        out.close();
+
+        if (!out || 0 != std::rename(tempPath.c_str(), path.c_str())) {
+            std::remove(tempPath.c_str());
+            fail_runtime_error("cannot save " + path);
+        }
+    }
+
+    // The best workgroup size for a kernel depends on the device and driver as well as the
+    // module, so tuned sizes are kept in a file named for all three
+    string tuned_workgroup_sizes_path(const string&                         directory,
+                                      const vk::PhysicalDeviceProperties&   properties,
+                                      std::uint64_t                         spvHash)
+    {
+        std::ostringstream os;
+        os << directory << '/' << std::hex << std::setfill('0') << std::setw(16) << spvHash
+           << '_' << std::setw(8) << properties.vendorID
+           << '_' << std::setw(8) << properties.deviceID
+           << '_' << std::setw(8) << properties.driverVersion << ".workgroupsizes";
+        return os.str();
+    }
+
+    // Each line of the file holds an entry point and its workgroup size: "name x y z"
+    map<string, vk::Extent3D> load_tuned_workgroup_sizes(const string& path)
+    {
+        map<string, vk::Extent3D> result;
+
+        std::ifstream in(path);
+        string line;
+        while (std::getline(in, line)) {
+            std::istringstream is(line);
+
+            string entryPoint;
+            vk::Extent3D workgroupSize;
+            is >> entryPoint >> workgroupSize.width >> workgroupSize.height >> workgroupSize.depth;
+            if (is && workgroupSize.width > 0 && workgroupSize.height > 0 && workgroupSize.depth > 0) {
+                result[entryPoint] = workgroupSize;
+            }
+        }
+
+        return result;
+    }
+
+    void save_tuned_workgroup_sizes(const string& path, const map<string, vk::Extent3D>& workgroupSizes)
+    {
+        std::ostringstream os;
+        for (auto& entry : workgroupSizes) {
+            os << entry.first
+               << ' ' << entry.second.width
+               << ' ' << entry.second.height
+               << ' ' << entry.second.depth << '\n';
+        }
+
+        const string data = os.str();
+        save_file(path, data.data(), data.size());
+    }
+
+    struct pipeline_job {
+        kernel*                 mKernel = nullptr;
+        vector<std::uint32_t>   mSpecConstants;
+        vk::UniquePipeline      mPipeline;
+        std::exception_ptr      mError;
+    };
+
+    bool has_local_arguments(const kernel_spec_t& spec)
+    {
+        return std::any_of(spec.mArguments.begin(), spec.mArguments.end(), [](const arg_spec_t& ka) {
+            return ka.mKind == arg_spec_t::kind_local;
+        });
+    }
 
 } // anonymous namespace
 
@@ -65,12 +229,42 @@ namespace clspv_utils {
         mLiteralSamplerDescriptor = literalSamplerDescriptorGroup.mDescriptor;
         mLiteralSamplerDescriptorLayout = literalSamplerDescriptorGroup.mLayout;
 
-        mShaderModule = create_shader(mDevice.getDevice(), spvmoduleStream);
-        mPipelineCache = mDevice.getDevice().createPipelineCacheUnique(vk::PipelineCacheCreateInfo());
+        const auto spvModule = read_spirv(spvmoduleStream);
+        mShaderModule = create_shader(mDevice.getDevice(), spvModule);
+
+        vector<std::uint8_t> initialData;
+        if (!mDevice.getPipelineCacheDirectory().empty()) {
+            const auto properties = mDevice.getPhysicalDevice().getProperties();
+            const auto spvHash = hash_spirv(spvModule);
+            mPipelineCachePath = pipeline_cache_path(mDevice.getPipelineCacheDirectory(), properties, spvHash);
+            initialData = load_pipeline_cache(mPipelineCachePath, properties);
+
+            mTunedWorkgroupSizesPath = tuned_workgroup_sizes_path(mDevice.getPipelineCacheDirectory(), properties, spvHash);
+            mTunedWorkgroupSizes = load_tuned_workgroup_sizes(mTunedWorkgroupSizesPath);
+        }
+
+        vk::PipelineCacheCreateInfo createInfo;
+        createInfo.setInitialDataSize(initialData.size())
+                .setPInitialData(initialData.empty() ? nullptr : initialData.data());
+
+        try {
+            mPipelineCache = mDevice.getDevice().createPipelineCacheUnique(createInfo);
+        }
+        catch (const vk::SystemError&) {
+            // the driver rejected the saved data, so start over with an empty cache
+            if (initialData.empty()) throw;
+            mPipelineCache = mDevice.getDevice().createPipelineCacheUnique(vk::PipelineCacheCreateInfo());
+        }
     }
 
     module::~module()
     {
+        try {
+            savePipelineCache();
+        }
+        catch (...) {
+            // failing to persist the cache only costs compilation time in a later run
+        }
     }
 
     module& module::operator=(module&& other)
@@ -89,6 +283,106 @@ namespace clspv_utils {
         swap(mLiteralSamplerDescriptor, other.mLiteralSamplerDescriptor);
         swap(mShaderModule, other.mShaderModule);
         swap(mPipelineCache, other.mPipelineCache);
+        swap(mPipelineCachePath, other.mPipelineCachePath);
+        swap(mTunedWorkgroupSizes, other.mTunedWorkgroupSizes);
+        swap(mTunedWorkgroupSizesPath, other.mTunedWorkgroupSizesPath);
+    }
+
+    vector<kernel> module::createKernels(const vector<kernel_variant_t>&   variants,
+                                        unsigned int                      numThreads)
+    {
+        // Kernel creation touches shared state on the device, so is done serially
+        vector<kernel> result;
+        result.reserve(variants.size());
+        for (auto& v : variants) {
+            result.push_back(kernel(createKernelReq(v.mEntryPoint), v.mWorkgroupSize));
+        }
+
+        vector<pipeline_job> jobs;
+        for (std::size_t i = 0; i < variants.size(); ++i) {
+            vector<vector<std::uint32_t>> specConstants = variants[i].mSpecConstants;
+            if (specConstants.empty()
+                && !has_local_arguments(*findKernelSpec(variants[i].mEntryPoint, mModuleSpec.mKernels))) {
+                specConstants.push_back(vector<std::uint32_t>());
+            }
+
+            for (auto& sc : specConstants) {
+                pipeline_job job;
+                job.mKernel = &result[i];
+                job.mSpecConstants = job.mKernel->getSpecConstants(sc);
+                jobs.push_back(std::move(job));
+            }
+        }
+
+        if (0 == numThreads) {
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        numThreads = std::min<unsigned int>(numThreads, jobs.size());
+
+        // The pipeline cache is internally synchronized, so pipelines can be compiled concurrently
+        std::atomic<std::size_t> nextJob(0);
+        auto worker = [&jobs, &nextJob]() {
+            for (std::size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+                try {
+                    jobs[i].mPipeline = jobs[i].mKernel->createPipeline(jobs[i].mSpecConstants);
+                }
+                catch (...) {
+                    jobs[i].mError = std::current_exception();
+                }
+            }
+        };
+
+        vector<std::thread> threads;
+        for (unsigned int t = 1; t < numThreads; ++t) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& t : threads) {
+            t.join();
+        }
+
+        for (auto& job : jobs) {
+            if (job.mError) {
+                std::rethrow_exception(job.mError);
+            }
+        }
+
+        for (auto& job : jobs) {
+            job.mKernel->addPipeline(job.mSpecConstants, std::move(job.mPipeline));
+        }
+
+        return result;
+    }
+
+    void module::savePipelineCache() const
+    {
+        if (mPipelineCache && !mPipelineCachePath.empty()) {
+            const auto data = mDevice.getDevice().getPipelineCacheData(*mPipelineCache);
+            save_file(mPipelineCachePath, data.data(), data.size());
+        }
+    }
+
+    bool module::getTunedWorkgroupSize(const string& entryPoint, vk::Extent3D& result) const
+    {
+        auto found = mTunedWorkgroupSizes.find(entryPoint);
+        if (found == mTunedWorkgroupSizes.end()) {
+            return false;
+        }
+
+        result = found->second;
+        return true;
+    }
+
+    void module::setTunedWorkgroupSize(const string& entryPoint, const vk::Extent3D& workgroupSize)
+    {
+        if (!findKernelSpec(entryPoint, mModuleSpec.mKernels)) {
+            fail_runtime_error("cannot tune workgroup size for unknown entry point");
+        }
+
+        mTunedWorkgroupSizes[entryPoint] = workgroupSize;
+        if (!mTunedWorkgroupSizesPath.empty()) {
+            save_tuned_workgroup_sizes(mTunedWorkgroupSizesPath, mTunedWorkgroupSizes);
+        }
     }
 
     vector<string> module::getEntryPoints() const
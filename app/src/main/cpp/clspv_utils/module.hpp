@@ -10,6 +10,7 @@
 #include "clspv_utils_interop.hpp"
 #include "device.hpp"
 #include "interface.hpp"
+#include "kernel.hpp"
 
 #include <vulkan/vulkan.hpp>
 
@@ -17,6 +18,17 @@
 
 namespace clspv_utils {
 
+    // A kernel to create, and the pipelines to build for it
+    struct kernel_variant_t {
+        string                          mEntryPoint;
+        vk::Extent3D                    mWorkgroupSize;
+
+        // The spec constants, beyond the workgroup size, of each pipeline to build. If empty,
+        // the pipeline without argument spec constants is built, unless the kernel has local
+        // array arguments (whose sizes are spec constants).
+        vector<vector<std::uint32_t>>   mSpecConstants;
+    };
+
     class module {
     public:
                             module();
@@ -39,6 +51,24 @@ namespace clspv_utils {
 
         kernel_req_t        createKernelReq(const string &entryPoint) const;
 
+        // Create a kernel for each variant, building their pipelines concurrently on numThreads
+        // threads (or one per hardware thread, if zero) through the module's pipeline cache.
+        // If any pipeline cannot be built, the first such failure is thrown once all have been
+        // attempted.
+        vector<kernel>      createKernels(const vector<kernel_variant_t>&  variants,
+                                          unsigned int                     numThreads = 0);
+
+        // Write the module's pipeline cache to the device's pipeline cache directory. This is
+        // done automatically when the module is destroyed.
+        void                savePipelineCache() const;
+
+        // Return the workgroup size chosen for the entry point by tuning on this device, or false
+        // if it has not been tuned. Tuned sizes are persisted in the device's pipeline cache
+        // directory, so that they are available to later runs on the same device and driver.
+        bool                getTunedWorkgroupSize(const string& entryPoint, vk::Extent3D& result) const;
+
+        void                setTunedWorkgroupSize(const string& entryPoint, const vk::Extent3D& workgroupSize);
+
     private:
         device                  mDevice;
         module_spec_t           mModuleSpec;
@@ -47,6 +77,9 @@ namespace clspv_utils {
         vk::DescriptorSet       mLiteralSamplerDescriptor;
         vk::UniqueShaderModule  mShaderModule;
         vk::UniquePipelineCache mPipelineCache;
+        string                  mPipelineCachePath;
+        map<string, vk::Extent3D>   mTunedWorkgroupSizes;
+        string                  mTunedWorkgroupSizesPath;
     };
 
     inline void swap(module& lhs, module& rhs)
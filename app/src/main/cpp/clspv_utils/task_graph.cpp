@@ -0,0 +1,554 @@
+//
+// Created on 10/18/26.
+//
+
+#include "task_graph.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace {
+    using namespace clspv_utils;
+
+    const vk::AccessFlags kWriteAccess = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite;
+
+    const std::size_t kNoSegment = std::numeric_limits<std::size_t>::max();
+
+    template <typename T>
+    void push_back_unique(vector<T>& v, const T& value)
+    {
+        if (v.end() == std::find(v.begin(), v.end(), value)) {
+            v.push_back(value);
+        }
+    }
+
+    vk::BufferImageCopy get_image_copy_region(const vk::Extent3D& imageExtent)
+    {
+        vk::BufferImageCopy result;
+        result.setBufferRowLength(imageExtent.width)
+              .setBufferImageHeight(imageExtent.height)
+              .setImageExtent(imageExtent);
+        result.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
+                               .setLayerCount(1);
+        return result;
+    }
+
+} // anonymous namespace
+
+namespace clspv_utils {
+
+    task_graph::task_graph()
+    {
+        // this space intentionally left blank
+    }
+
+    task_graph::task_graph(device inDevice)
+            : mDevice(inDevice)
+    {
+    }
+
+    task_graph::task_graph(task_graph&& other)
+            : task_graph()
+    {
+        swap(other);
+    }
+
+    task_graph::~task_graph()
+    {
+        // the command buffers, events and semaphores may still be in use
+        waitAll(mLastSubmissions);
+    }
+
+    task_graph& task_graph::operator=(task_graph&& other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    void task_graph::swap(task_graph& other)
+    {
+        using std::swap;
+
+        swap(mDevice, other.mDevice);
+        swap(mNodes, other.mNodes);
+        swap(mBufferHistory, other.mBufferHistory);
+        swap(mImageHistory, other.mImageHistory);
+        swap(mSegments, other.mSegments);
+        swap(mSubmissionOrder, other.mSubmissionOrder);
+        swap(mSemaphores, other.mSemaphores);
+        swap(mLastSubmissions, other.mLastSubmissions);
+        swap(mIsCompiled, other.mIsCompiled);
+    }
+
+    task_graph::node_id task_graph::addDispatch(invocation&             inv,
+                                                const vk::Extent3D&     numWorkgroups,
+                                                device::queue_role      role)
+    {
+        if (inv.mReq.mDevice.getDevice() != mDevice.getDevice()) {
+            fail_runtime_error("invocations in a task graph must share the graph's device");
+        }
+        if (!(mDevice.getQueue(role).mFlags & vk::QueueFlagBits::eCompute)) {
+            fail_runtime_error("invocations must be submitted to a compute queue");
+        }
+
+        // An invocation's descriptor set and pod arguments are rewritten each time it is
+        // recorded, so it can only be recorded once per graph.
+        const auto isDuplicate = std::any_of(mNodes.begin(), mNodes.end(), [&inv](const node& n) {
+            return n.mInvocation == &inv;
+        });
+        if (isDuplicate) {
+            fail_runtime_error("an invocation cannot be added to a task graph more than once");
+        }
+
+        node newNode;
+        newNode.mKind = kind_dispatch;
+        newNode.mRole = role;
+        newNode.mInvocation = &inv;
+        newNode.mExtent = numWorkgroups;
+        newNode.mBufferBarriers = inv.mBufferMemoryBarriers;
+        newNode.mImageBarriers = inv.mImageMemoryBarriers;
+
+        return addNode(std::move(newNode));
+    }
+
+    task_graph::node_id task_graph::addCopy(vulkan_utils::buffer&   src,
+                                            vulkan_utils::buffer&   dst,
+                                            device::queue_role      role)
+    {
+        node newNode;
+        newNode.mKind = kind_copyBufferToBuffer;
+        newNode.mRole = role;
+        newNode.mCopySize = std::min(src.getSize(), dst.getSize());
+        newNode.mBufferBarriers.push_back(src.prepareForTransferSrc());
+        newNode.mBufferBarriers.push_back(dst.prepareForTransferDst());
+
+        return addNode(std::move(newNode));
+    }
+
+    task_graph::node_id task_graph::addCopy(vulkan_utils::buffer&   src,
+                                            vulkan_utils::image&    dst,
+                                            device::queue_role      role)
+    {
+        node newNode;
+        newNode.mKind = kind_copyBufferToImage;
+        newNode.mRole = role;
+        newNode.mExtent = dst.getExtent();
+        newNode.mBufferBarriers.push_back(src.prepareForTransferSrc());
+        newNode.mImageBarriers.push_back(dst.prepare(vk::ImageLayout::eTransferDstOptimal));
+
+        return addNode(std::move(newNode));
+    }
+
+    task_graph::node_id task_graph::addCopy(vulkan_utils::image&    src,
+                                            vulkan_utils::buffer&   dst,
+                                            device::queue_role      role)
+    {
+        node newNode;
+        newNode.mKind = kind_copyImageToBuffer;
+        newNode.mRole = role;
+        newNode.mExtent = src.getExtent();
+        newNode.mBufferBarriers.push_back(dst.prepareForTransferDst());
+        newNode.mImageBarriers.push_back(src.prepare(vk::ImageLayout::eTransferSrcOptimal));
+
+        return addNode(std::move(newNode));
+    }
+
+    void task_graph::addDependency(node_id before, node_id after)
+    {
+        if (before >= after || after >= mNodes.size()) {
+            fail_runtime_error("a task graph dependency must be on an earlier node");
+        }
+
+        push_back_unique(mNodes[after].mExplicitDependencies, before);
+        mIsCompiled = false;
+    }
+
+    task_graph::node_id task_graph::addNode(node newNode)
+    {
+        const node_id id = mNodes.size();
+
+        inferDependencies(newNode, id);
+        mNodes.push_back(std::move(newNode));
+        mIsCompiled = false;
+
+        return id;
+    }
+
+    // On the first use of a resource in the graph, the barrier prepared by the resource orders it
+    // against work that preceded the graph. Later, the barrier instead orders it against the
+    // conflicting accesses of earlier nodes, on which the node then depends. Layout transitions
+    // count as writes.
+    template <typename Handle, typename Barrier>
+    task_graph::barrier_dependencies task_graph::inferDependencies(map<Handle, resource_history>&   history,
+                                                                   Handle                           resource,
+                                                                   Barrier&                         barrier,
+                                                                   bool                             isLayoutTransition,
+                                                                   node_id                          id)
+    {
+        barrier_dependencies result;
+
+        const bool isWrite = isLayoutTransition || (bool)(barrier.dstAccessMask & kWriteAccess);
+
+        auto found = history.find(resource);
+        if (found != history.end()) {
+            vector<dependency> producers = found->second.mWriters;
+            if (isWrite) {
+                producers.insert(producers.end(), found->second.mReaders.begin(), found->second.mReaders.end());
+            }
+
+            barrier.srcAccessMask = vk::AccessFlags();
+            for (auto& p : producers) {
+                barrier.srcAccessMask |= p.mAccess;
+                push_back_unique(result.mNodes, p.mNode);
+            }
+        }
+
+        resource_history& h = history[resource];
+        const dependency access = { id, barrier.dstAccessMask };
+        if (isWrite) {
+            h.mWriters.assign(1, access);
+            h.mReaders.clear();
+        }
+        else {
+            h.mReaders.push_back(access);
+        }
+
+        return result;
+    }
+
+    void task_graph::inferDependencies(node& newNode, node_id id)
+    {
+        for (auto& b : newNode.mBufferBarriers) {
+            newNode.mBufferBarrierDependencies.push_back(inferDependencies(mBufferHistory, b.buffer, b, false, id));
+        }
+
+        for (auto& b : newNode.mImageBarriers) {
+            newNode.mImageBarrierDependencies.push_back(inferDependencies(mImageHistory, b.image, b, b.oldLayout != b.newLayout, id));
+        }
+    }
+
+    device::queue_role task_graph::getQueueRole(device::queue_role role) const
+    {
+        // roles without a queue of their own share the compute queue
+        return (mDevice.hasDedicatedQueue(role) ? role : device::kQueue_compute);
+    }
+
+    bool task_graph::isSameSegment(node_id producer, const node& consumer) const
+    {
+        return mNodes[producer].mSegment == consumer.mSegment;
+    }
+
+    // Within a submission, a barrier waits on events set by its producers if they are all in the
+    // same submission. Otherwise it is recorded as a pipeline barrier.
+    bool task_graph::waitsOnEvents(const barrier_dependencies& deps, const node& consumer) const
+    {
+        return !deps.mNodes.empty()
+               && std::all_of(deps.mNodes.begin(), deps.mNodes.end(), [this, &consumer](node_id p) {
+                   return isSameSegment(p, consumer);
+               });
+    }
+
+    vk::PipelineStageFlags task_graph::getStage(const node& n)
+    {
+        return (kind_dispatch == n.mKind ? vk::PipelineStageFlagBits::eComputeShader : vk::PipelineStageFlagBits::eTransfer);
+    }
+
+    // Start a new submission for a node which depends on a node on another queue, so that only
+    // it and the nodes after it wait on the other queue. The submission it waits on is closed,
+    // so that everything it signals for has been submitted before the wait.
+    void task_graph::assignSegments()
+    {
+        mSegments.clear();
+        mSubmissionOrder.clear();
+
+        std::size_t openSegments[device::kQueue_count];
+        std::fill(std::begin(openSegments), std::end(openSegments), kNoSegment);
+
+        auto closeSegment = [this, &openSegments](std::size_t s) {
+            std::size_t& open = openSegments[mSegments[s].mRole];
+            if (open == s) {
+                open = kNoSegment;
+                mSubmissionOrder.push_back(s);
+            }
+        };
+
+        for (node_id id = 0; id < mNodes.size(); ++id) {
+            node& n = mNodes[id];
+            const device::queue_role role = getQueueRole(n.mRole);
+
+            vector<node_id> predecessors = n.mExplicitDependencies;
+            for (auto& deps : n.mBufferBarrierDependencies) {
+                predecessors.insert(predecessors.end(), deps.mNodes.begin(), deps.mNodes.end());
+            }
+            for (auto& deps : n.mImageBarrierDependencies) {
+                predecessors.insert(predecessors.end(), deps.mNodes.begin(), deps.mNodes.end());
+            }
+
+            vector<std::size_t> waitSegments;
+            for (auto p : predecessors) {
+                const std::size_t s = mNodes[p].mSegment;
+                if (mSegments[s].mRole != role) {
+                    push_back_unique(waitSegments, s);
+                }
+            }
+
+            if (!waitSegments.empty()) {
+                for (auto s : waitSegments) {
+                    closeSegment(s);
+                }
+                if (kNoSegment != openSegments[role]) {
+                    closeSegment(openSegments[role]);
+                }
+            }
+
+            if (kNoSegment == openSegments[role]) {
+                openSegments[role] = mSegments.size();
+                mSegments.push_back(segment());
+                mSegments.back().mRole = role;
+            }
+
+            segment& seg = mSegments[openSegments[role]];
+            for (auto s : waitSegments) {
+                push_back_unique(seg.mWaitSegments, s);
+            }
+            seg.mNodes.push_back(id);
+            n.mSegment = openSegments[role];
+        }
+
+        vector<std::size_t> stillOpen;
+        std::copy_if(std::begin(openSegments), std::end(openSegments), std::back_inserter(stillOpen),
+                     [](std::size_t s) { return kNoSegment != s; });
+        std::sort(stillOpen.begin(), stillOpen.end());
+        mSubmissionOrder.insert(mSubmissionOrder.end(), stillOpen.begin(), stillOpen.end());
+    }
+
+    void task_graph::compile()
+    {
+        if (mNodes.empty()) {
+            fail_runtime_error("cannot compile an empty task graph");
+        }
+
+        // the previous compilation's command buffers may still be executing
+        waitAll(mLastSubmissions);
+        mLastSubmissions.clear();
+        mSemaphores.clear();
+        for (auto& n : mNodes) {
+            n.mEvent.reset();
+        }
+
+        assignSegments();
+
+        const vk::Device device = mDevice.getDevice();
+
+        auto createEvent = [this, device](node_id p) {
+            if (!mNodes[p].mEvent) {
+                mNodes[p].mEvent = device.createEventUnique(vk::EventCreateInfo());
+            }
+        };
+
+        for (auto& n : mNodes) {
+            for (std::size_t i = 0; i < n.mBufferBarriers.size(); ++i) {
+                if (vulkan_utils::isBarrierRequired(n.mBufferBarriers[i]) && waitsOnEvents(n.mBufferBarrierDependencies[i], n)) {
+                    std::for_each(n.mBufferBarrierDependencies[i].mNodes.begin(), n.mBufferBarrierDependencies[i].mNodes.end(), createEvent);
+                }
+            }
+            for (std::size_t i = 0; i < n.mImageBarriers.size(); ++i) {
+                if (vulkan_utils::isBarrierRequired(n.mImageBarriers[i]) && waitsOnEvents(n.mImageBarrierDependencies[i], n)) {
+                    std::for_each(n.mImageBarrierDependencies[i].mNodes.begin(), n.mImageBarrierDependencies[i].mNodes.end(), createEvent);
+                }
+            }
+            for (auto p : n.mExplicitDependencies) {
+                if (isSameSegment(p, n)) {
+                    createEvent(p);
+                }
+            }
+        }
+
+        for (auto& seg : mSegments) {
+            seg.mWaitSemaphores.clear();
+            seg.mSignalSemaphores.clear();
+        }
+        for (auto& seg : mSegments) {
+            for (auto w : seg.mWaitSegments) {
+                mSemaphores.push_back(device.createSemaphoreUnique(vk::SemaphoreCreateInfo()));
+                seg.mWaitSemaphores.push_back(*mSemaphores.back());
+                mSegments[w].mSignalSemaphores.push_back(*mSemaphores.back());
+            }
+        }
+
+        for (auto& seg : mSegments) {
+            recordSegment(seg);
+        }
+
+        mIsCompiled = true;
+    }
+
+    void task_graph::recordSegment(segment& seg)
+    {
+        seg.mCommandBuffer = vulkan_utils::allocate_command_buffer(mDevice.getDevice(),
+                                                                   mDevice.getCommandPool(seg.mRole));
+
+        seg.mCommandBuffer->begin(vk::CommandBufferBeginInfo());
+
+        for (auto id : seg.mNodes) {
+            node& n = mNodes[id];
+
+            recordSync(*seg.mCommandBuffer, n);
+            recordNode(*seg.mCommandBuffer, n);
+
+            if (n.mEvent) {
+                seg.mCommandBuffer->setEvent(*n.mEvent, getStage(n));
+            }
+        }
+
+        seg.mCommandBuffer->end();
+    }
+
+    void task_graph::recordSync(vk::CommandBuffer commandBuffer, node& n)
+    {
+        vector<vk::Event>               events;
+        vk::PipelineStageFlags          eventStages;
+        vector<vk::BufferMemoryBarrier> eventBufferBarriers;
+        vector<vk::ImageMemoryBarrier>  eventImageBarriers;
+
+        vk::PipelineStageFlags          pipelineStages;
+        vector<vk::BufferMemoryBarrier> pipelineBufferBarriers;
+        vector<vk::ImageMemoryBarrier>  pipelineImageBarriers;
+
+        auto waitOnEvent = [this, &events, &eventStages](node_id p) {
+            push_back_unique(events, *mNodes[p].mEvent);
+            eventStages |= getStage(mNodes[p]);
+        };
+
+        for (std::size_t i = 0; i < n.mBufferBarriers.size(); ++i) {
+            const auto& b = n.mBufferBarriers[i];
+            if (!vulkan_utils::isBarrierRequired(b)) continue;
+
+            const auto& deps = n.mBufferBarrierDependencies[i];
+            if (waitsOnEvents(deps, n)) {
+                std::for_each(deps.mNodes.begin(), deps.mNodes.end(), waitOnEvent);
+                eventBufferBarriers.push_back(b);
+            }
+            else {
+                pipelineStages |= vulkan_utils::getAccessStages(b.srcAccessMask);
+                pipelineBufferBarriers.push_back(b);
+            }
+        }
+
+        for (std::size_t i = 0; i < n.mImageBarriers.size(); ++i) {
+            const auto& b = n.mImageBarriers[i];
+            if (!vulkan_utils::isBarrierRequired(b)) continue;
+
+            const auto& deps = n.mImageBarrierDependencies[i];
+            if (waitsOnEvents(deps, n)) {
+                std::for_each(deps.mNodes.begin(), deps.mNodes.end(), waitOnEvent);
+                eventImageBarriers.push_back(b);
+            }
+            else {
+                pipelineStages |= vulkan_utils::getAccessStages(b.srcAccessMask);
+                pipelineImageBarriers.push_back(b);
+            }
+        }
+
+        // Explicit dependencies on other queues are satisfied by the submission's semaphores
+        for (auto p : n.mExplicitDependencies) {
+            if (isSameSegment(p, n)) {
+                waitOnEvent(p);
+            }
+            else if (mSegments[mNodes[p].mSegment].mRole == mSegments[n.mSegment].mRole) {
+                pipelineStages |= getStage(mNodes[p]);
+            }
+        }
+
+        if (!events.empty()) {
+            commandBuffer.waitEvents(events,
+                                     eventStages,
+                                     getStage(n),
+                                     nullptr,
+                                     eventBufferBarriers,
+                                     eventImageBarriers);
+        }
+
+        if (pipelineStages) {
+            commandBuffer.pipelineBarrier(pipelineStages,
+                                          getStage(n),
+                                          vk::DependencyFlags(),
+                                          nullptr,
+                                          pipelineBufferBarriers,
+                                          pipelineImageBarriers);
+        }
+    }
+
+    void task_graph::recordNode(vk::CommandBuffer commandBuffer, node& n)
+    {
+        switch (n.mKind) {
+            case kind_dispatch:
+                n.mInvocation->updateDescriptorSets();
+                n.mInvocation->fillCommandBuffer(commandBuffer, n.mExtent, nullptr, nullptr);
+                break;
+
+            case kind_copyBufferToBuffer:
+                commandBuffer.copyBuffer(n.mBufferBarriers[0].buffer,
+                                         n.mBufferBarriers[1].buffer,
+                                         vk::BufferCopy(0, 0, n.mCopySize));
+                break;
+
+            case kind_copyBufferToImage:
+                commandBuffer.copyBufferToImage(n.mBufferBarriers[0].buffer,
+                                                n.mImageBarriers[0].image,
+                                                n.mImageBarriers[0].newLayout,
+                                                get_image_copy_region(n.mExtent));
+                break;
+
+            case kind_copyImageToBuffer:
+                commandBuffer.copyImageToBuffer(n.mImageBarriers[0].image,
+                                                n.mImageBarriers[0].newLayout,
+                                                n.mBufferBarriers[0].buffer,
+                                                get_image_copy_region(n.mExtent));
+                break;
+        }
+    }
+
+    vector<completion> task_graph::submitAsync()
+    {
+        if (!mIsCompiled) {
+            compile();
+        }
+
+        // The events and semaphores are reused, so the previous execution must be complete
+        waitAll(mLastSubmissions);
+        mLastSubmissions.clear();
+        for (auto& n : mNodes) {
+            if (n.mEvent) {
+                mDevice.getDevice().resetEvent(*n.mEvent);
+            }
+        }
+
+        for (auto s : mSubmissionOrder) {
+            const segment& seg = mSegments[s];
+
+            completion c = submitCommand(mDevice,
+                                         mDevice.getQueue(seg.mRole).mQueue,
+                                         *seg.mCommandBuffer,
+                                         seg.mWaitSemaphores,
+                                         seg.mSignalSemaphores);
+
+            for (auto id : seg.mNodes) {
+                if (mNodes[id].mInvocation) {
+                    mNodes[id].mInvocation->mLastSubmission = c;
+                }
+            }
+
+            mLastSubmissions.push_back(c);
+        }
+
+        return mLastSubmissions;
+    }
+
+    void task_graph::run()
+    {
+        waitAll(submitAsync());
+    }
+
+} // namespace clspv_utils
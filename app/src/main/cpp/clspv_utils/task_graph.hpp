@@ -0,0 +1,187 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVUTILS_TASK_GRAPH_HPP
+#define CLSPVUTILS_TASK_GRAPH_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+#include "completion.hpp"
+#include "device.hpp"
+#include "invocation.hpp"
+
+#include <cstddef>
+
+#include <vulkan/vulkan.hpp>
+
+#include "vulkan_utils/vulkan_utils.hpp"
+
+namespace clspv_utils {
+
+    // A task_graph executes a DAG of dispatches and copies across the device's queues. A node
+    // depends on each earlier node with a conflicting access (read after write, write after read,
+    // or write after write) to one of its resources, and on any node named in addDependency.
+    // Independent nodes are free to overlap.
+    //
+    // The graph is compiled into one submission per run of consecutive nodes on a queue. Within a
+    // submission, a node waits only on the nodes it depends on, through events. Dependencies
+    // between submissions on one queue use pipeline barriers, and those between queues use
+    // semaphores. Resources used on more than one queue family must be created to be shared
+    // between them (see device::getQueueFamilyIndices).
+    //
+    // As with invocation_batch, invocations are referenced rather than copied, and must outlive
+    // the execution of the graph. Nodes should be added in the order their arguments were
+    // added, since image layout transitions are computed then.
+    class task_graph {
+    public:
+        typedef std::size_t node_id;
+
+    public:
+                        task_graph();
+
+        explicit        task_graph(device inDevice);
+
+                        task_graph(task_graph&& other);
+
+                        ~task_graph();
+
+        task_graph&     operator=(task_graph&& other);
+
+        void            swap(task_graph& other);
+
+        // Add a dispatch of the invocation. The role must name a compute queue.
+        node_id         addDispatch(invocation&             inv,
+                                    const vk::Extent3D&     numWorkgroups,
+                                    device::queue_role      role = device::kQueue_compute);
+
+        // Add a copy of the whole of src (or as much of it as fits) into dst
+        node_id         addCopy(vulkan_utils::buffer&   src,
+                                vulkan_utils::buffer&   dst,
+                                device::queue_role      role = device::kQueue_transfer);
+
+        node_id         addCopy(vulkan_utils::buffer&   src,
+                                vulkan_utils::image&    dst,
+                                device::queue_role      role = device::kQueue_transfer);
+
+        node_id         addCopy(vulkan_utils::image&    src,
+                                vulkan_utils::buffer&   dst,
+                                device::queue_role      role = device::kQueue_transfer);
+
+        // Order node after behind node before, which must have been added earlier, regardless of
+        // their resources
+        void            addDependency(node_id before, node_id after);
+
+        std::size_t     size() const { return mNodes.size(); }
+
+        // Split the graph into submissions and record their command buffers. Adding a node
+        // discards the compiled graph.
+        void            compile();
+
+        bool            isCompiled() const { return mIsCompiled; }
+
+        std::size_t     getSubmissionCount() const { return mSubmissionOrder.size(); }
+
+        // Submit the graph without waiting for it to complete, compiling it first if necessary.
+        // Each returned completion signals when one of the graph's submissions has completed.
+        // Submitting a graph waits for its previous execution to complete.
+        vector<completion>  submitAsync();
+
+        // Execute the graph synchronously
+        void            run();
+
+    private:
+        enum node_kind {
+            kind_dispatch,
+            kind_copyBufferToBuffer,
+            kind_copyBufferToImage,
+            kind_copyImageToBuffer
+        };
+
+        struct dependency {
+            node_id             mNode;
+            vk::AccessFlags     mAccess;    // the access of mNode which must be made visible
+        };
+
+        // The nodes whose accesses a node's barrier orders it against. Empty if the barrier
+        // orders it against work submitted before the graph.
+        struct barrier_dependencies {
+            vector<node_id>     mNodes;
+        };
+
+        struct node {
+            node_kind                       mKind           = kind_dispatch;
+            device::queue_role              mRole           = device::kQueue_compute;
+            invocation*                     mInvocation     = nullptr;
+            vk::Extent3D                    mExtent;    // workgroups for dispatches, texels for image copies
+            vk::DeviceSize                  mCopySize       = 0;
+
+            vector<vk::BufferMemoryBarrier> mBufferBarriers;
+            vector<vk::ImageMemoryBarrier>  mImageBarriers;
+            vector<barrier_dependencies>    mBufferBarrierDependencies;
+            vector<barrier_dependencies>    mImageBarrierDependencies;
+            vector<node_id>                 mExplicitDependencies;
+
+            std::size_t                     mSegment        = 0;
+            vk::UniqueEvent                 mEvent;
+        };
+
+        struct segment {
+            device::queue_role              mRole           = device::kQueue_compute;
+            vector<node_id>                 mNodes;
+            vector<std::size_t>             mWaitSegments;
+            vector<vk::Semaphore>           mWaitSemaphores;
+            vector<vk::Semaphore>           mSignalSemaphores;
+            vk::UniqueCommandBuffer         mCommandBuffer;
+        };
+
+        struct resource_history {
+            vector<dependency>  mWriters;   // the last write, or nothing
+            vector<dependency>  mReaders;   // reads since the last write
+        };
+
+    private:
+        node_id         addNode(node newNode);
+
+        void            inferDependencies(node& newNode, node_id id);
+
+        template <typename Handle, typename Barrier>
+        barrier_dependencies    inferDependencies(map<Handle, resource_history>&    history,
+                                                  Handle                            resource,
+                                                  Barrier&                          barrier,
+                                                  bool                              isLayoutTransition,
+                                                  node_id                           id);
+
+        device::queue_role      getQueueRole(device::queue_role role) const;
+
+        void            assignSegments();
+        void            recordSegment(segment& seg);
+        void            recordSync(vk::CommandBuffer commandBuffer, node& n);
+        void            recordNode(vk::CommandBuffer commandBuffer, node& n);
+
+        bool            isSameSegment(node_id producer, const node& consumer) const;
+        bool            waitsOnEvents(const barrier_dependencies& deps, const node& consumer) const;
+
+        static vk::PipelineStageFlags   getStage(const node& n);
+
+    private:
+        device                          mDevice;
+        vector<node>                    mNodes;
+        map<vk::Buffer, resource_history>   mBufferHistory;
+        map<vk::Image, resource_history>    mImageHistory;
+
+        vector<segment>                 mSegments;
+        vector<std::size_t>             mSubmissionOrder;
+        vector<vk::UniqueSemaphore>     mSemaphores;
+        vector<completion>              mLastSubmissions;
+        bool                            mIsCompiled = false;
+    };
+
+    inline void swap(task_graph& lhs, task_graph& rhs)
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#endif //CLSPVUTILS_TASK_GRAPH_HPP
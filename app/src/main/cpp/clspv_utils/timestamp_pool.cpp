@@ -0,0 +1,181 @@
+//
+// Created on 10/18/26.
+//
+
+#include "timestamp_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace clspv_utils {
+
+    timestamp_pool::allocation::allocation()
+    {
+        // this space intentionally left blank
+    }
+
+    timestamp_pool::allocation::allocation(shared_ptr<timestamp_pool>  pool,
+                                           vk::QueryPool               queryPool,
+                                           std::uint32_t               firstQuery,
+                                           std::uint32_t               queryCount)
+            : mPool(std::move(pool)),
+              mQueryPool(queryPool),
+              mFirstQuery(firstQuery),
+              mQueryCount(queryCount)
+    {
+    }
+
+    timestamp_pool::allocation::allocation(allocation&& other)
+            : allocation()
+    {
+        swap(other);
+    }
+
+    timestamp_pool::allocation::~allocation()
+    {
+        release();
+    }
+
+    timestamp_pool::allocation& timestamp_pool::allocation::operator=(allocation&& other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    void timestamp_pool::allocation::swap(allocation& other)
+    {
+        using std::swap;
+
+        swap(mPool, other.mPool);
+        swap(mQueryPool, other.mQueryPool);
+        swap(mFirstQuery, other.mFirstQuery);
+        swap(mQueryCount, other.mQueryCount);
+    }
+
+    void timestamp_pool::allocation::reset(vk::CommandBuffer commandBuffer) const
+    {
+        commandBuffer.resetQueryPool(mQueryPool, mFirstQuery, mQueryCount);
+    }
+
+    void timestamp_pool::allocation::writeTimestamp(vk::CommandBuffer            commandBuffer,
+                                                    vk::PipelineStageFlagBits    stage,
+                                                    std::uint32_t                index) const
+    {
+        assert(index < mQueryCount);
+        commandBuffer.writeTimestamp(stage, mQueryPool, mFirstQuery + index);
+    }
+
+    bool timestamp_pool::allocation::tryGetResults(std::uint64_t* results) const
+    {
+        if (!mPool) {
+            fail_runtime_error("timestamp allocation is empty");
+        }
+
+        // each query yields its value followed by its availability
+        vector<std::uint64_t> values(2 * mQueryCount);
+        const auto status = mPool->mDevice.getQueryPoolResults(mQueryPool,
+                                                               mFirstQuery,
+                                                               mQueryCount,
+                                                               values.size() * sizeof(std::uint64_t),
+                                                               values.data(),
+                                                               2 * sizeof(std::uint64_t),
+                                                               vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+        if (status != vk::Result::eSuccess && status != vk::Result::eNotReady) {
+            fail_runtime_error("cannot read timestamp queries");
+        }
+
+        for (std::uint32_t i = 0; i < mQueryCount; ++i) {
+            if (0 == values[2 * i + 1]) {
+                return false;
+            }
+        }
+
+        for (std::uint32_t i = 0; i < mQueryCount; ++i) {
+            results[i] = values[2 * i];
+        }
+
+        return true;
+    }
+
+    void timestamp_pool::allocation::getResults(std::uint64_t* results) const
+    {
+        if (!mPool) {
+            fail_runtime_error("timestamp allocation is empty");
+        }
+
+        mPool->mDevice.getQueryPoolResults(mQueryPool,
+                                           mFirstQuery,
+                                           mQueryCount,
+                                           mQueryCount * sizeof(std::uint64_t),
+                                           results,
+                                           sizeof(std::uint64_t),
+                                           vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+    }
+
+    void timestamp_pool::allocation::release(completion inFlight)
+    {
+        if (mPool) {
+            mPool->recycle(mQueryPool, mFirstQuery, mQueryCount, std::move(inFlight));
+        }
+        mPool.reset();
+        mQueryPool = vk::QueryPool();
+        mFirstQuery = 0;
+        mQueryCount = 0;
+    }
+
+    timestamp_pool::timestamp_pool(vk::Device device, std::uint32_t queriesPerPool)
+            : mDevice(device),
+              mQueriesPerPool(queriesPerPool)
+    {
+    }
+
+    timestamp_pool::~timestamp_pool()
+    {
+    }
+
+    timestamp_pool::allocation timestamp_pool::allocate(std::uint32_t queryCount)
+    {
+        if (0 == queryCount || queryCount > mQueriesPerPool) {
+            fail_runtime_error("invalid number of timestamp queries requested");
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        const auto found = std::find_if(mRetired.begin(), mRetired.end(), [queryCount](const retired_block& r) {
+            return r.mQueryCount == queryCount && r.mInFlight.poll();
+        });
+
+        if (found != mRetired.end()) {
+            allocation result(shared_from_this(), found->mQueryPool, found->mFirstQuery, found->mQueryCount);
+            mRetired.erase(found);
+            return result;
+        }
+
+        // grow by a whole query pool when the newest one is full
+        if (mQueryPools.empty() || mNextQuery + queryCount > mQueriesPerPool) {
+            vk::QueryPoolCreateInfo createInfo;
+            createInfo.setQueryType(vk::QueryType::eTimestamp)
+                    .setQueryCount(mQueriesPerPool);
+
+            mQueryPools.push_back(mDevice.createQueryPoolUnique(createInfo));
+            mNextQuery = 0;
+        }
+
+        allocation result(shared_from_this(), *mQueryPools.back(), mNextQuery, queryCount);
+        mNextQuery += queryCount;
+        return result;
+    }
+
+    void timestamp_pool::recycle(vk::QueryPool queryPool, std::uint32_t firstQuery, std::uint32_t queryCount, completion inFlight)
+    {
+        retired_block retired;
+        retired.mQueryPool = queryPool;
+        retired.mFirstQuery = firstQuery;
+        retired.mQueryCount = queryCount;
+        retired.mInFlight = std::move(inFlight);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRetired.push_back(std::move(retired));
+    }
+
+} // namespace clspv_utils
@@ -0,0 +1,108 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVUTILS_TIMESTAMP_POOL_HPP
+#define CLSPVUTILS_TIMESTAMP_POOL_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+#include "completion.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include <vulkan/vulkan.hpp>
+
+namespace clspv_utils {
+
+    // A timestamp_pool hands out blocks of timestamp queries from a growing set of query pools,
+    // so that invocations need not create a query pool of their own. A block released together
+    // with a completion is not reused until that completion has signaled. Blocks may be allocated
+    // and released from several threads.
+    class timestamp_pool : public std::enable_shared_from_this<timestamp_pool> {
+    public:
+        class allocation {
+        public:
+                            allocation();
+
+                            allocation(shared_ptr<timestamp_pool>  pool,
+                                       vk::QueryPool               queryPool,
+                                       std::uint32_t               firstQuery,
+                                       std::uint32_t               queryCount);
+
+                            allocation(allocation&& other);
+
+                            ~allocation();
+
+            allocation&     operator=(allocation&& other);
+
+            void            swap(allocation& other);
+
+            explicit operator bool() const { return (bool)mPool; }
+
+            vk::QueryPool   getQueryPool() const { return mQueryPool; }
+            std::uint32_t   getFirstQuery() const { return mFirstQuery; }
+            std::uint32_t   getQueryCount() const { return mQueryCount; }
+
+            // Record a reset of all of the block's queries
+            void            reset(vk::CommandBuffer commandBuffer) const;
+
+            // Record a timestamp into the block's query at the given index
+            void            writeTimestamp(vk::CommandBuffer            commandBuffer,
+                                           vk::PipelineStageFlagBits    stage,
+                                           std::uint32_t                index) const;
+
+            // Read all of the block's timestamps into results, which must have room for
+            // getQueryCount() values. Return false, without waiting, if any is not yet available.
+            bool            tryGetResults(std::uint64_t* results) const;
+
+            // Read all of the block's timestamps, waiting for them to become available
+            void            getResults(std::uint64_t* results) const;
+
+            // Return the block to the pool, to be reused once the completion has signaled.
+            void            release(completion inFlight = completion());
+
+        private:
+            shared_ptr<timestamp_pool>  mPool;
+            vk::QueryPool               mQueryPool;
+            std::uint32_t               mFirstQuery = 0;
+            std::uint32_t               mQueryCount = 0;
+        };
+
+    public:
+                    timestamp_pool(vk::Device device, std::uint32_t queriesPerPool);
+
+                    ~timestamp_pool();
+
+        allocation  allocate(std::uint32_t queryCount);
+
+    private:
+        struct retired_block {
+            vk::QueryPool   mQueryPool;
+            std::uint32_t   mFirstQuery = 0;
+            std::uint32_t   mQueryCount = 0;
+            completion      mInFlight;
+        };
+
+    private:
+        void        recycle(vk::QueryPool queryPool, std::uint32_t firstQuery, std::uint32_t queryCount, completion inFlight);
+
+    private:
+        vk::Device                  mDevice;
+        std::uint32_t               mQueriesPerPool = 0;
+        std::mutex                  mMutex;
+        vector<vk::UniqueQueryPool> mQueryPools;
+        std::uint32_t               mNextQuery      = 0;
+        vector<retired_block>       mRetired;
+    };
+
+    inline void swap(timestamp_pool::allocation& lhs, timestamp_pool::allocation& rhs)
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#endif //CLSPVUTILS_TIMESTAMP_POOL_HPP
@@ -0,0 +1,301 @@
+//
+// Created on 10/18/26.
+//
+
+#include "transfer_batch.hpp"
+
+#include <algorithm>
+
+namespace {
+    using namespace clspv_utils;
+
+    vk::UniqueSemaphore create_semaphore(vk::Device device)
+    {
+        return device.createSemaphoreUnique(vk::SemaphoreCreateInfo());
+    }
+
+    vk::AccessFlags get_src_access(const vector<vk::ImageMemoryBarrier>& barriers)
+    {
+        vk::AccessFlags result;
+        for (auto& b : barriers) {
+            result |= b.srcAccessMask;
+        }
+        return result;
+    }
+
+    vk::AccessFlags get_dst_access(const vector<vk::ImageMemoryBarrier>& barriers)
+    {
+        vk::AccessFlags result;
+        for (auto& b : barriers) {
+            result |= b.dstAccessMask;
+        }
+        return result;
+    }
+
+    // Begin recording into the command buffer, allocating it from the role's command pool on
+    // first use, and otherwise resetting it. Its previous submission must have completed.
+    void begin_command_buffer(vk::UniqueCommandBuffer& commandBuffer, const device& inDevice, device::queue_role role)
+    {
+        if (commandBuffer) {
+            commandBuffer->reset(vk::CommandBufferResetFlags());
+        }
+        else {
+            commandBuffer = vulkan_utils::allocate_command_buffer(inDevice.getDevice(), inDevice.getCommandPool(role));
+        }
+
+        commandBuffer->begin(vk::CommandBufferBeginInfo().setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    }
+
+    // The halves of an ownership transfer have empty source or destination access masks, and
+    // so need not wait on, or block, any stage of their own queue. The semaphore between the
+    // queues orders them.
+    void record_barriers(vk::CommandBuffer commandBuffer, const vector<vk::ImageMemoryBarrier>& barriers)
+    {
+        commandBuffer.pipelineBarrier(vulkan_utils::getAccessStages(get_src_access(barriers)),
+                                      vulkan_utils::getAccessStages(get_dst_access(barriers)),
+                                      vk::DependencyFlags(),
+                                      nullptr,
+                                      nullptr,
+                                      barriers);
+    }
+
+} // anonymous namespace
+
+namespace clspv_utils {
+
+    transfer_batch::transfer_batch()
+    {
+        // this space intentionally left blank
+    }
+
+    transfer_batch::transfer_batch(device inDevice)
+            : mDevice(inDevice)
+    {
+    }
+
+    transfer_batch::transfer_batch(transfer_batch&& other)
+            : transfer_batch()
+    {
+        swap(other);
+    }
+
+    transfer_batch::~transfer_batch()
+    {
+        // Command buffers and semaphores must not be destroyed while they are pending
+        waitAll(mLastSubmissions);
+    }
+
+    transfer_batch& transfer_batch::operator=(transfer_batch&& other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    void transfer_batch::swap(transfer_batch& other)
+    {
+        using std::swap;
+
+        swap(mDevice, other.mDevice);
+        swap(mQueueRole, other.mQueueRole);
+        swap(mEntries, other.mEntries);
+        swap(mReleaseCommand, other.mReleaseCommand);
+        swap(mCommandBuffer, other.mCommandBuffer);
+        swap(mAcquireCommand, other.mAcquireCommand);
+        swap(mReleaseSemaphore, other.mReleaseSemaphore);
+        swap(mCopySemaphore, other.mCopySemaphore);
+        swap(mLastSubmissions, other.mLastSubmissions);
+    }
+
+    void transfer_batch::addUpload(vulkan_utils::buffer& src, vulkan_utils::image& dst, vk::ImageLayout layout)
+    {
+        entry newEntry;
+        newEntry.mBuffer = &src;
+        newEntry.mImage = &dst;
+        newEntry.mLayout = layout;
+        newEntry.mIsUpload = true;
+        mEntries.push_back(newEntry);
+    }
+
+    void transfer_batch::addReadback(vulkan_utils::image& src, vulkan_utils::buffer& dst)
+    {
+        entry newEntry;
+        newEntry.mBuffer = &dst;
+        newEntry.mImage = &src;
+        newEntry.mIsUpload = false;
+        mEntries.push_back(newEntry);
+    }
+
+    void transfer_batch::setQueue(device::queue_role role)
+    {
+        if (device::kQueue_compute != role && device::kQueue_transfer != role) {
+            fail_runtime_error("transfers must be submitted to the compute or transfer queue");
+        }
+
+        if (role != mQueueRole) {
+            // the copies' command buffer belongs to the previous queue's command pool
+            waitAll(mLastSubmissions);
+            mLastSubmissions.clear();
+            mCommandBuffer.reset();
+        }
+
+        mQueueRole = role;
+    }
+
+    void transfer_batch::addHandoff(handoff&                         h,
+                                    const vk::ImageMemoryBarrier&    barrier,
+                                    const vulkan_utils::image&       image,
+                                    std::uint32_t                    srcFamily,
+                                    std::uint32_t                    dstFamily,
+                                    bool                             isToCompute) const
+    {
+        // Without an ownership transfer, the semaphore orders the queues, and the barrier is
+        // recorded whole on the compute queue, since the copy queue may not support the compute
+        // stages. When the compute queue acquires the image, the barrier follows the semaphore
+        // wait, which has already made the copies' writes available, as in an acquire.
+        if (srcFamily == dstFamily || image.isShared()) {
+            if (vulkan_utils::isBarrierRequired(barrier)) {
+                if (isToCompute) {
+                    vk::ImageMemoryBarrier acquire = barrier;
+                    acquire.setSrcAccessMask(vk::AccessFlags());
+                    h.mAcquire.push_back(acquire);
+                }
+                else {
+                    h.mRelease.push_back(barrier);
+                }
+            }
+            return;
+        }
+
+        vk::ImageMemoryBarrier release = barrier;
+        release.setSrcQueueFamilyIndex(srcFamily)
+               .setDstQueueFamilyIndex(dstFamily)
+               .setDstAccessMask(vk::AccessFlags());
+        h.mRelease.push_back(release);
+
+        vk::ImageMemoryBarrier acquire = barrier;
+        acquire.setSrcQueueFamilyIndex(srcFamily)
+               .setDstQueueFamilyIndex(dstFamily)
+               .setSrcAccessMask(vk::AccessFlags());
+        h.mAcquire.push_back(acquire);
+    }
+
+    void transfer_batch::recordCopies(vk::CommandBuffer commandBuffer, bool discardUploads)
+    {
+        for (auto& e : mEntries) {
+            if (e.mIsUpload) {
+                if (discardUploads && !e.mImage->isShared()) {
+                    e.mImage->discardContents();
+                }
+                vulkan_utils::copyBufferToImage(commandBuffer, *e.mBuffer, *e.mImage);
+            }
+            else {
+                vulkan_utils::copyImageToBuffer(commandBuffer, *e.mImage, *e.mBuffer);
+            }
+        }
+    }
+
+    completion transfer_batch::submitAsync()
+    {
+        if (mEntries.empty()) {
+            fail_runtime_error("cannot submit an empty transfer batch");
+        }
+
+        // The command buffers are reused, so the previous submission must have completed
+        waitAll(mLastSubmissions);
+        mLastSubmissions.clear();
+
+        const device::queue_info& computeQueue = mDevice.getQueue(device::kQueue_compute);
+        const device::queue_info& copyQueue = mDevice.getQueue(mQueueRole);
+
+        if (copyQueue.mQueue == computeQueue.mQueue) {
+            begin_command_buffer(mCommandBuffer, mDevice, mQueueRole);
+            recordCopies(*mCommandBuffer, false);
+            mCommandBuffer->end();
+
+            mLastSubmissions.push_back(submitCommand(mDevice, computeQueue.mQueue, *mCommandBuffer));
+            return mLastSubmissions.back();
+        }
+
+        if (!mReleaseSemaphore) {
+            mReleaseSemaphore = create_semaphore(mDevice.getDevice());
+            mCopySemaphore = create_semaphore(mDevice.getDevice());
+        }
+
+        const bool isOwnershipTransfer = (copyQueue.mFamilyIndex != computeQueue.mFamilyIndex);
+
+        // Hand the images being read back to the copy queue
+        handoff readbacks;
+        for (auto& e : mEntries) {
+            if (!e.mIsUpload) {
+                addHandoff(readbacks,
+                           e.mImage->prepare(vk::ImageLayout::eTransferSrcOptimal),
+                           *e.mImage,
+                           computeQueue.mFamilyIndex,
+                           copyQueue.mFamilyIndex,
+                           false);
+            }
+        }
+
+        vector<vk::Semaphore> copyWaits;
+        if (!readbacks.mRelease.empty()) {
+            begin_command_buffer(mReleaseCommand, mDevice, device::kQueue_compute);
+            record_barriers(*mReleaseCommand, readbacks.mRelease);
+            mReleaseCommand->end();
+
+            mLastSubmissions.push_back(submitCommand(mDevice, computeQueue.mQueue, *mReleaseCommand, nullptr, *mReleaseSemaphore));
+            copyWaits.push_back(*mReleaseSemaphore);
+        }
+
+        begin_command_buffer(mCommandBuffer, mDevice, mQueueRole);
+        if (!readbacks.mAcquire.empty()) {
+            record_barriers(*mCommandBuffer, readbacks.mAcquire);
+        }
+
+        recordCopies(*mCommandBuffer, isOwnershipTransfer);
+
+        // Hand the uploaded images to the compute queue
+        handoff uploads;
+        for (auto& e : mEntries) {
+            if (e.mIsUpload) {
+                addHandoff(uploads,
+                           e.mImage->prepare(e.mLayout),
+                           *e.mImage,
+                           copyQueue.mFamilyIndex,
+                           computeQueue.mFamilyIndex,
+                           true);
+            }
+        }
+        if (!uploads.mRelease.empty()) {
+            record_barriers(*mCommandBuffer, uploads.mRelease);
+        }
+        mCommandBuffer->end();
+
+        const bool hasUploads = std::any_of(mEntries.begin(), mEntries.end(), [](const entry& e) { return e.mIsUpload; });
+
+        vector<vk::Semaphore> copySignals;
+        if (hasUploads) {
+            copySignals.push_back(*mCopySemaphore);
+        }
+        mLastSubmissions.push_back(submitCommand(mDevice, copyQueue.mQueue, *mCommandBuffer, copyWaits, copySignals));
+
+        // Later compute work is ordered after the uploads by this submission, even if no
+        // acquire barriers are needed
+        if (hasUploads) {
+            begin_command_buffer(mAcquireCommand, mDevice, device::kQueue_compute);
+            if (!uploads.mAcquire.empty()) {
+                record_barriers(*mAcquireCommand, uploads.mAcquire);
+            }
+            mAcquireCommand->end();
+
+            mLastSubmissions.push_back(submitCommand(mDevice, computeQueue.mQueue, *mAcquireCommand, *mCopySemaphore));
+        }
+
+        return mLastSubmissions.back();
+    }
+
+    void transfer_batch::run()
+    {
+        submitAsync().wait();
+    }
+
+} // namespace clspv_utils
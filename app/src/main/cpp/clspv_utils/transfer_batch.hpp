@@ -0,0 +1,118 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVUTILS_TRANSFER_BATCH_HPP
+#define CLSPVUTILS_TRANSFER_BATCH_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+#include "completion.hpp"
+#include "device.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include "vulkan_utils/vulkan_utils.hpp"
+
+namespace clspv_utils {
+
+    // A transfer_batch records several image uploads and readbacks into a single command buffer,
+    // which is submitted once. By default it is submitted to the device's compute queue, so that
+    // images and their staging buffers need not be shared with another queue family.
+    //
+    // A batch may instead be submitted to the kQueue_transfer queue, so that it overlaps with
+    // compute work. Images are then handed between the compute and transfer queues with
+    // semaphores, and with queue family ownership transfers if the queues' families differ and
+    // the images are not shared. Images being read back are released by the compute queue after
+    // all work submitted to it so far, and uploaded images are acquired by the compute queue
+    // ahead of any work submitted to it later. An upload discards the image's prior contents,
+    // and must not be submitted while the device is still using the image. An image which has
+    // been read back stays with the transfer queue's family until it is next uploaded, or its
+    // contents are discarded. Staging buffers are not transferred, so they should only be used
+    // by the transfer queue's family, or be shared.
+    //
+    // Buffers and images are referenced, not copied, and must outlive the execution of the
+    // batch. The copies are recorded afresh on each submission, in the order they were added,
+    // so a batch may be submitted again to repeat them. The batch's command buffers are
+    // allocated once, from the calling thread's command pools, and reset for each submission,
+    // so a batch must be submitted and destroyed on the thread which first submitted it.
+    class transfer_batch {
+    public:
+                        transfer_batch();
+
+        explicit        transfer_batch(device inDevice);
+
+                        transfer_batch(transfer_batch&& other);
+
+                        ~transfer_batch();
+
+        transfer_batch& operator=(transfer_batch&& other);
+
+        void            swap(transfer_batch& other);
+
+        // Copy the buffer, tightly packed, into the whole of the image, leaving the image in
+        // the given layout
+        void            addUpload(vulkan_utils::buffer& src,
+                                  vulkan_utils::image&  dst,
+                                  vk::ImageLayout       layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+        // Copy the whole of the image, tightly packed, into the buffer
+        void            addReadback(vulkan_utils::image& src, vulkan_utils::buffer& dst);
+
+        // Select the queue to which the copies are submitted: kQueue_compute or kQueue_transfer
+        void            setQueue(device::queue_role role);
+
+        std::size_t     size() const { return mEntries.size(); }
+
+        // Submit the batch without waiting for it to complete. The completion signals when the
+        // last of the batch's submissions, which may be to the compute queue, has completed.
+        // Submitting a batch waits for its previous submission to complete.
+        completion      submitAsync();
+
+        // Execute the batch synchronously
+        void            run();
+
+    private:
+        struct entry {
+            vulkan_utils::buffer*   mBuffer     = nullptr;
+            vulkan_utils::image*    mImage      = nullptr;
+            vk::ImageLayout         mLayout     = vk::ImageLayout::eUndefined;
+            bool                    mIsUpload   = true;
+        };
+
+        // The halves of the barriers which hand images from one queue to another
+        struct handoff {
+            vector<vk::ImageMemoryBarrier>  mRelease;
+            vector<vk::ImageMemoryBarrier>  mAcquire;
+        };
+
+    private:
+        void            addHandoff(handoff&                         h,
+                                   const vk::ImageMemoryBarrier&    barrier,
+                                   const vulkan_utils::image&       image,
+                                   std::uint32_t                    srcFamily,
+                                   std::uint32_t                    dstFamily,
+                                   bool                             isToCompute) const;
+
+        void            recordCopies(vk::CommandBuffer commandBuffer, bool discardUploads);
+
+    private:
+        device                  mDevice;
+        device::queue_role      mQueueRole  = device::kQueue_compute;
+        vector<entry>           mEntries;
+        vk::UniqueCommandBuffer mReleaseCommand;    // compute queue: hands readbacks to the transfer queue
+        vk::UniqueCommandBuffer mCommandBuffer;     // the copies
+        vk::UniqueCommandBuffer mAcquireCommand;    // compute queue: takes uploads from the transfer queue
+        vk::UniqueSemaphore     mReleaseSemaphore;
+        vk::UniqueSemaphore     mCopySemaphore;
+        vector<completion>      mLastSubmissions;
+    };
+
+    inline void swap(transfer_batch& lhs, transfer_batch& rhs)
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#endif //CLSPVUTILS_TRANSFER_BATCH_HPP
@@ -0,0 +1,228 @@
+//
+// Created on 10/18/26.
+//
+
+#include "uniform_ring.hpp"
+
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <algorithm>
+
+namespace {
+
+    vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return ((value + alignment - 1) / alignment) * alignment;
+    }
+
+} // anonymous namespace
+
+namespace clspv_utils {
+
+    uniform_ring::allocation::allocation()
+    {
+        // this space intentionally left blank
+    }
+
+    uniform_ring::allocation::allocation(shared_ptr<uniform_ring>  ring,
+                                         std::uint64_t             id,
+                                         vk::DeviceSize            offset,
+                                         vk::DeviceSize            size)
+            : mRing(std::move(ring)),
+              mId(id),
+              mOffset(offset),
+              mSize(size)
+    {
+    }
+
+    uniform_ring::allocation::allocation(allocation&& other)
+            : allocation()
+    {
+        swap(other);
+    }
+
+    uniform_ring::allocation::~allocation()
+    {
+        release();
+    }
+
+    uniform_ring::allocation& uniform_ring::allocation::operator=(allocation&& other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    void uniform_ring::allocation::swap(allocation& other)
+    {
+        using std::swap;
+
+        swap(mRing, other.mRing);
+        swap(mId, other.mId);
+        swap(mOffset, other.mOffset);
+        swap(mSize, other.mSize);
+    }
+
+    void* uniform_ring::allocation::data() const
+    {
+        return (mRing ? mRing->mMapped + mOffset : nullptr);
+    }
+
+    vk::DescriptorBufferInfo uniform_ring::allocation::getDescriptorInfo() const
+    {
+        // The offset of the block is supplied as a dynamic offset when the descriptor is bound
+        return vk::DescriptorBufferInfo(mRing ? mRing->getBuffer() : vk::Buffer(), 0, mSize);
+    }
+
+    void uniform_ring::allocation::release(completion inFlight)
+    {
+        if (mRing) {
+            mRing->release(mId, std::move(inFlight));
+        }
+        mRing.reset();
+        mId = 0;
+        mOffset = 0;
+        mSize = 0;
+    }
+
+    uniform_ring::uniform_ring(vk::Device                                  device,
+                               const vk::PhysicalDeviceMemoryProperties&   memoryProperties,
+                               const vk::PhysicalDeviceLimits&             limits,
+                               vk::DeviceSize                              capacity)
+            : mDevice(device),
+              mCapacity(capacity),
+              mAlignment(std::max<vk::DeviceSize>(limits.minUniformBufferOffsetAlignment, 1))
+    {
+        vk::BufferCreateInfo bufferInfo;
+        bufferInfo.setUsage(vk::BufferUsageFlagBits::eUniformBuffer)
+                .setSize(mCapacity)
+                .setSharingMode(vk::SharingMode::eExclusive);
+
+        mBuffer = mDevice.createBufferUnique(bufferInfo);
+
+        mDeviceMemory = vulkan_utils::allocate_device_memory(mDevice,
+                                                             mDevice.getBufferMemoryRequirements(*mBuffer),
+                                                             memoryProperties,
+                                                             vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+        mDevice.bindBufferMemory(*mBuffer, *mDeviceMemory, 0);
+
+        mMapped = static_cast<std::uint8_t*>(mDevice.mapMemory(*mDeviceMemory, 0, VK_WHOLE_SIZE, vk::MemoryMapFlags()));
+    }
+
+    uniform_ring::~uniform_ring()
+    {
+        // destroying the segments waits for any work still reading from the ring
+        mSegments.clear();
+
+        if (mMapped) {
+            mDevice.unmapMemory(*mDeviceMemory);
+        }
+    }
+
+    uniform_ring::allocation uniform_ring::allocate(vk::DeviceSize numBytes)
+    {
+        if (0 == numBytes || numBytes > mCapacity) {
+            fail_runtime_error("invalid uniform ring allocation size");
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        reclaim();
+
+        vk::DeviceSize offset = findSpace(numBytes);
+        while (offset == mCapacity) {
+            // The ring is full. Block until the earliest released block can be reclaimed. A block
+            // still owned by a client can never be reclaimed.
+            if (mPendingReleases.empty()) {
+                fail_runtime_error("uniform ring exhausted");
+            }
+
+            findSegment(mPendingReleases.front())->mInFlight.wait();
+            reclaim();
+
+            offset = findSpace(numBytes);
+        }
+
+        segment newSegment;
+        newSegment.mId = mNextId++;
+        newSegment.mBegin = offset;
+        newSegment.mEnd = offset + numBytes;
+
+        const std::uint64_t id = newSegment.mId;
+        const auto position = std::upper_bound(mSegments.begin(), mSegments.end(), offset, [](vk::DeviceSize o, const segment& s) {
+            return o < s.mBegin;
+        });
+        mSegments.insert(position, std::move(newSegment));
+        mHead = offset + numBytes;
+
+        return allocation(shared_from_this(), id, offset, numBytes);
+    }
+
+    std::deque<uniform_ring::segment>::iterator uniform_ring::findSegment(std::uint64_t id)
+    {
+        return std::find_if(mSegments.begin(), mSegments.end(), [id](const segment& s) {
+            return s.mId == id;
+        });
+    }
+
+    // Search the gaps between blocks for the first fit after the most recent allocation, and
+    // then for the first fit from the start of the ring
+    vk::DeviceSize uniform_ring::findSpace(vk::DeviceSize numBytes) const
+    {
+        const vk::DeviceSize head = align_up(mHead, mAlignment);
+
+        for (int pass = 0; pass < 2; ++pass) {
+            vk::DeviceSize gapBegin = 0;
+            for (std::size_t i = 0; i <= mSegments.size(); ++i) {
+                const vk::DeviceSize gapEnd = (i < mSegments.size() ? mSegments[i].mBegin : mCapacity);
+                const vk::DeviceSize start = (0 == pass ? std::max(gapBegin, head) : gapBegin);
+
+                if (start <= gapEnd && gapEnd - start >= numBytes) {
+                    return start;
+                }
+
+                if (i < mSegments.size()) {
+                    gapBegin = align_up(mSegments[i].mEnd, mAlignment);
+                }
+            }
+        }
+
+        return mCapacity;
+    }
+
+    void uniform_ring::release(std::uint64_t id, completion inFlight)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto found = findSegment(id);
+        if (found == mSegments.end()) {
+            fail_runtime_error("releasing unknown uniform ring allocation");
+        }
+
+        if (inFlight.poll()) {
+            mSegments.erase(found);
+        }
+        else {
+            found->mInFlight = std::move(inFlight);
+            mPendingReleases.push_back(id);
+        }
+
+        reclaim();
+    }
+
+    // Work is usually completed in the order it was released, so polling stops at the first
+    // release still in flight
+    void uniform_ring::reclaim()
+    {
+        while (!mPendingReleases.empty()) {
+            auto found = findSegment(mPendingReleases.front());
+            if (!found->mInFlight.poll()) {
+                break;
+            }
+
+            mSegments.erase(found);
+            mPendingReleases.pop_front();
+        }
+    }
+
+} // namespace clspv_utils
@@ -0,0 +1,119 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVUTILS_UNIFORM_RING_HPP
+#define CLSPVUTILS_UNIFORM_RING_HPP
+
+#include "clspv_utils_fwd.hpp"
+
+#include "clspv_utils_interop.hpp"
+#include "completion.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include <vulkan/vulkan.hpp>
+
+namespace clspv_utils {
+
+    // A uniform_ring is a single, persistently mapped, host coherent uniform buffer from which
+    // small blocks of kernel arguments are sub-allocated. Blocks are bound with dynamic offsets,
+    // so that passing pod arguments requires no Vulkan allocation, mapping or flush.
+    //
+    // Blocks are allocated from the ring in turn, skipping over any still held, so that a block
+    // kept for a long time, such as a recorded invocation's, does not prevent the space around it
+    // being reused. A block is reclaimed once it has been released and the completion it was
+    // released with has signaled. Blocks may be allocated and released from several threads.
+    class uniform_ring : public std::enable_shared_from_this<uniform_ring> {
+    public:
+        class allocation {
+        public:
+                            allocation();
+
+                            allocation(shared_ptr<uniform_ring>    ring,
+                                       std::uint64_t               id,
+                                       vk::DeviceSize              offset,
+                                       vk::DeviceSize              size);
+
+                            allocation(allocation&& other);
+
+                            ~allocation();
+
+            allocation&     operator=(allocation&& other);
+
+            void            swap(allocation& other);
+
+            explicit operator bool() const { return (bool)mRing; }
+
+            vk::DeviceSize  getOffset() const { return mOffset; }
+            vk::DeviceSize  getSize() const { return mSize; }
+
+            void*           data() const;
+
+            vk::DescriptorBufferInfo    getDescriptorInfo() const;
+
+            // Return the block to the ring, to be reclaimed once the completion has signaled.
+            void            release(completion inFlight = completion());
+
+        private:
+            shared_ptr<uniform_ring>    mRing;
+            std::uint64_t               mId     = 0;
+            vk::DeviceSize              mOffset = 0;
+            vk::DeviceSize              mSize   = 0;
+        };
+
+    public:
+                        uniform_ring(vk::Device                                 device,
+                                     const vk::PhysicalDeviceMemoryProperties&  memoryProperties,
+                                     const vk::PhysicalDeviceLimits&            limits,
+                                     vk::DeviceSize                             capacity);
+
+                        ~uniform_ring();
+
+        allocation      allocate(vk::DeviceSize numBytes);
+
+        vk::Buffer      getBuffer() const { return *mBuffer; }
+        vk::DeviceSize  getCapacity() const { return mCapacity; }
+
+    private:
+        struct segment {
+            std::uint64_t   mId         = 0;
+            vk::DeviceSize  mBegin      = 0;
+            vk::DeviceSize  mEnd        = 0;
+            completion      mInFlight;
+        };
+
+    private:
+        void            release(std::uint64_t id, completion inFlight);
+        void            reclaim();
+
+        std::deque<segment>::iterator   findSegment(std::uint64_t id);
+
+        // Return the offset at which numBytes could be allocated, or mCapacity if there is no room
+        vk::DeviceSize  findSpace(vk::DeviceSize numBytes) const;
+
+    private:
+        vk::Device              mDevice;
+        vk::DeviceSize          mCapacity   = 0;
+        vk::DeviceSize          mAlignment  = 1;
+        vk::UniqueBuffer        mBuffer;
+        vk::UniqueDeviceMemory  mDeviceMemory;
+        std::uint8_t*           mMapped     = nullptr;
+
+        std::mutex              mMutex;
+        std::deque<segment>     mSegments;          // in address order
+        std::deque<std::uint64_t>   mPendingReleases;   // released blocks the device may still read, in release order
+        vk::DeviceSize          mHead       = 0;    // the end of the most recent allocation
+        std::uint64_t           mNextId     = 1;
+    };
+
+    inline void swap(uniform_ring::allocation& lhs, uniform_ring::allocation& rhs)
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#endif //CLSPVUTILS_UNIFORM_RING_HPP
@@ -0,0 +1,189 @@
+//
+// Created on 10/18/26.
+//
+
+#include "host_import_test.hpp"
+
+#include "util.hpp"
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    const vk::DeviceSize kTestBytes = 1024 * 1024;
+
+    // Bytes not divisible by the import alignment, so that a mapped file must be padded
+    const vk::DeviceSize kFileTailBytes = 12;
+
+    const vk::BufferUsageFlags kImportUsage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc;
+
+    std::vector<std::uint8_t> createPattern(vk::DeviceSize num_bytes)
+    {
+        std::vector<std::uint8_t> result(num_bytes);
+        for (std::size_t i = 0; i < result.size(); ++i) {
+            result[i] = static_cast<std::uint8_t>((i * 2654435761u) >> 24);
+        }
+        return result;
+    }
+
+    vk::DeviceSize getImportAlignment(const clspv_utils::device& device)
+    {
+        return std::max<vk::DeviceSize>(device.getHostMemoryImporter().mMinImportedHostPointerAlignment,
+                                        sysconf(_SC_PAGESIZE));
+    }
+
+    // Copy the buffer on the device into a host visible buffer, and check that it begins with
+    // expected and is zero beyond that
+    bool checkContents(const clspv_utils::device&           device,
+                       vulkan_utils::buffer&                src,
+                       const std::vector<std::uint8_t>&     expected)
+    {
+        vulkan_utils::buffer dst(device.getDevice(),
+                                 device.getMemoryProperties(),
+                                 src.getSize(),
+                                 vk::BufferUsageFlagBits::eTransferDst,
+                                 vulkan_utils::kPlacement_hostVisible);
+
+        clspv_utils::createTransferFn(device)([&src, &dst](vk::CommandBuffer commandBuffer) {
+            // Host writes are visible to the submission without a barrier
+            const vk::BufferMemoryBarrier before[] = { src.prepareForTransferSrc(), dst.prepareForTransferDst() };
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eHost,
+                                          vk::PipelineStageFlagBits::eTransfer,
+                                          vk::DependencyFlags(),
+                                          nullptr,
+                                          { 2, before },
+                                          nullptr);
+
+            commandBuffer.copyBuffer(before[0].buffer, before[1].buffer, vk::BufferCopy(0, 0, src.getSize()));
+
+            const vk::MemoryBarrier after(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eHostRead);
+            commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                          vk::PipelineStageFlagBits::eHost,
+                                          vk::DependencyFlags(),
+                                          after,
+                                          nullptr,
+                                          nullptr);
+        });
+
+        auto dstMap = dst.map<std::uint8_t>(vulkan_utils::buffer::kMap_read);
+        const std::uint8_t* const begin = dstMap.get();
+        const std::uint8_t* const end = begin + dst.getSize();
+
+        return expected.size() <= dst.getSize()
+               && std::equal(expected.begin(), expected.end(), begin)
+               && std::all_of(begin + expected.size(), end, [](std::uint8_t b) { return 0 == b; });
+    }
+
+    // mustImport and mayImport say whether the buffer is expected to wrap the host memory.
+    // Drivers may refuse memory they could not have known about, such as file mappings, even
+    // when it is suitably aligned.
+    void logResult(const std::string&           label,
+                   const vulkan_utils::buffer&  buffer,
+                   bool                         mustImport,
+                   bool                         mayImport,
+                   bool                         contentsMatch)
+    {
+        const bool success = contentsMatch && (buffer.isImported() ? mayImport : !mustImport);
+
+        std::ostringstream os;
+        os << "host-import " << label
+           << " bytes:" << buffer.getSize()
+           << " imported:" << (buffer.isImported() ? "yes" : "no")
+           << " contents:" << (contentsMatch ? "match" : "mismatch")
+           << " result:" << (success ? "pass" : "fail");
+
+        if (success) {
+            LOGI("%s", os.str().c_str());
+        }
+        else {
+            LOGE("%s", os.str().c_str());
+        }
+    }
+
+    // Import a host allocation at the given offset from the import alignment
+    void runAllocationTest(const clspv_utils::device& device, const std::string& label, vk::DeviceSize offset)
+    {
+        const auto& importer = device.getHostMemoryImporter();
+        const vk::DeviceSize alignment = getImportAlignment(device);
+
+        void* allocation = nullptr;
+        if (0 != posix_memalign(&allocation, alignment, kTestBytes + alignment)) {
+            LOGE("host-import %s: cannot allocate host memory", label.c_str());
+            return;
+        }
+        std::shared_ptr<void> owner(allocation, std::free);
+
+        const auto pattern = createPattern(kTestBytes);
+        std::uint8_t* const hostPointer = static_cast<std::uint8_t*>(allocation) + offset;
+        std::copy(pattern.begin(), pattern.end(), hostPointer);
+
+        const bool canImport = importer.canImport(hostPointer, kTestBytes);
+        vulkan_utils::buffer imported(device.getDevice(),
+                                      device.getMemoryProperties(),
+                                      hostPointer,
+                                      kTestBytes,
+                                      kImportUsage,
+                                      importer,
+                                      owner);
+
+        // Drop our reference, so that an imported buffer alone keeps its memory alive
+        owner.reset();
+
+        logResult(label, imported, canImport, canImport, checkContents(device, imported, pattern));
+    }
+
+    void runFileTest(const clspv_utils::device& device)
+    {
+        const std::string directory = android_utils::getInternalDataPath();
+        if (directory.empty()) {
+            LOGI("host-import file: skipped, no data directory");
+            return;
+        }
+
+        const std::string path = directory + "/host_import_test.bin";
+        const auto pattern = createPattern(kTestBytes + kFileTailBytes);
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(pattern.data()), pattern.size());
+            if (!out) {
+                LOGE("host-import file: cannot write %s", path.c_str());
+                return;
+            }
+        }
+
+        const auto& importer = device.getHostMemoryImporter();
+        vulkan_utils::buffer mapped = vulkan_utils::createBufferFromFile(device.getDevice(),
+                                                                         device.getMemoryProperties(),
+                                                                         path,
+                                                                         kImportUsage,
+                                                                         importer);
+        std::remove(path.c_str());
+
+        const bool canImport = (nullptr != importer.vkGetMemoryHostPointerPropertiesEXT);
+        logResult("file", mapped, false, canImport, checkContents(device, mapped, pattern));
+    }
+}
+
+namespace host_import_test {
+
+    void runAllTests(const clspv_utils::device& device)
+    {
+        runAllocationTest(device, "aligned", 0);
+        runAllocationTest(device, "misaligned", sizeof(std::uint32_t));
+        runFileTest(device);
+    }
+}
@@ -0,0 +1,18 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVTEST_HOST_IMPORT_TEST_HPP
+#define CLSPVTEST_HOST_IMPORT_TEST_HPP
+
+#include "clspv_utils/device.hpp"
+
+namespace host_import_test {
+
+    // Wrap an aligned host allocation, a misaligned one, and a mapped file in buffers, copy each
+    // on the device into a buffer of its own, and check what is read back. Log whether each was
+    // imported, or copied because it could not be.
+    void runAllTests(const clspv_utils::device& device);
+}
+
+#endif //CLSPVTEST_HOST_IMPORT_TEST_HPP
@@ -0,0 +1,172 @@
+//
+// Created on 10/18/26.
+//
+
+#include "invocation_batch_test.hpp"
+
+#include "clspv_utils/invocation.hpp"
+#include "clspv_utils/invocation_batch.hpp"
+#include "clspv_utils/kernel.hpp"
+#include "clspv_utils/module.hpp"
+#include "test_utils.hpp"
+#include "util.hpp"
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+    const char* const   kModuleName     = "shaders_cl/Memory";
+    const char* const   kEntryPoint     = "CopyBufferToBufferKernel";
+    const vk::Extent3D  kWorkgroupSize(8, 8, 1);
+
+    // Each buffer holds two halves of 64x64 float4 pixels, which are aligned for any device
+    const std::int32_t      kPixelsPerRow   = 64;
+    const std::int32_t      kNumRows        = 64;
+    const std::size_t       kHalfWords      = kPixelsPerRow * kNumRows * 4;
+    const vk::DeviceSize    kHalfBytes      = kHalfWords * sizeof(std::uint32_t);
+
+    // Every word is a normal float, so that the kernel copies it exactly
+    std::uint32_t getPatternWord(std::size_t i)
+    {
+        return (static_cast<std::uint32_t>(i * 2654435761u) & 0x807fffffu) | 0x3f800000u;
+    }
+
+    // Fill the first half of the buffer with the pattern, and the second half with zero
+    void fillBuffer(vulkan_utils::buffer& b, bool isSource)
+    {
+        auto bufferMap = b.map<std::uint32_t>(vulkan_utils::buffer::kMap_write);
+        for (std::size_t i = 0; i < 2 * kHalfWords; ++i) {
+            bufferMap.get()[i] = (isSource && i < kHalfWords ? getPatternWord(i) : 0);
+        }
+    }
+
+    bool checkHalf(vulkan_utils::buffer& b, std::size_t half)
+    {
+        auto bufferMap = b.map<std::uint32_t>(vulkan_utils::buffer::kMap_read);
+        const std::uint32_t* const words = bufferMap.get() + half * kHalfWords;
+        for (std::size_t i = 0; i < kHalfWords; ++i) {
+            if (getPatternWord(i) != words[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Copy one half of src into one half of dst, binding only those halves
+    void addCopy(clspv_utils::invocation&   inv,
+                 vulkan_utils::buffer&      src,
+                 std::size_t                srcHalf,
+                 vulkan_utils::buffer&      dst,
+                 std::size_t                dstHalf)
+    {
+        inv.addReadOnlyStorageBufferArgument(src, srcHalf * kHalfBytes, kHalfBytes);
+        inv.addStorageBufferArgument(dst, dstHalf * kHalfBytes, kHalfBytes);
+        inv.addPodArgument<std::int32_t>(kPixelsPerRow);    // source pitch
+        inv.addPodArgument<std::int32_t>(0);                // source offset
+        inv.addPodArgument<std::int32_t>(kPixelsPerRow);    // destination pitch
+        inv.addPodArgument<std::int32_t>(0);                // destination offset
+        inv.addPodArgument<std::int32_t>(1);                // 32 bit components
+        inv.addPodArgument<std::int32_t>(kPixelsPerRow);
+        inv.addPodArgument<std::int32_t>(kNumRows);
+    }
+
+    void logResult(const std::string& label, std::size_t barrierCount, bool isBarrierExpected, bool contentsMatch)
+    {
+        const bool success = contentsMatch && (isBarrierExpected ? barrierCount > 0 : barrierCount == 0);
+
+        std::ostringstream os;
+        os << "invocation-batch " << label
+           << " barriers:" << barrierCount
+           << " contents:" << (contentsMatch ? "match" : "mismatch")
+           << " result:" << (success ? "pass" : "fail");
+
+        if (success) {
+            LOGI("%s", os.str().c_str());
+        }
+        else {
+            LOGE("%s", os.str().c_str());
+        }
+    }
+
+    // The first dispatch copies the first half of a into the first half of b, and the second
+    // copies that into the second half of a. The second must wait for the first's write to b,
+    // and nothing else, since it writes a range of a which the first did not read.
+    void runReadAfterWriteTest(clspv_utils::kernel& kernel)
+    {
+        const auto& device = kernel.getDevice();
+
+        vulkan_utils::buffer a = test_utils::createStorageBuffer(device, 2 * kHalfBytes);
+        vulkan_utils::buffer b = test_utils::createStorageBuffer(device, 2 * kHalfBytes);
+        fillBuffer(a, true);
+        fillBuffer(b, false);
+
+        clspv_utils::invocation first(kernel.createInvocationReq());
+        addCopy(first, a, 0, b, 0);
+
+        clspv_utils::invocation second(kernel.createInvocationReq());
+        addCopy(second, b, 0, a, 1);
+
+        const auto numWorkgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
+                                                                         vk::Extent3D(kPixelsPerRow, kNumRows, 1));
+
+        clspv_utils::invocation_batch batch(device);
+        batch.addInvocation(first, numWorkgroups);
+        batch.addInvocation(second, numWorkgroups);
+        batch.run();
+
+        const bool contentsMatch = checkHalf(b, 0) && checkHalf(a, 1);
+        logResult("read-after-write", batch.getBarrierCount(1), true, contentsMatch);
+    }
+
+    // Both dispatches copy the first half of a, into either half of b. Neither range of b
+    // overlaps the other, so no barrier is needed between them.
+    void runReadAfterReadTest(clspv_utils::kernel& kernel)
+    {
+        const auto& device = kernel.getDevice();
+
+        vulkan_utils::buffer a = test_utils::createStorageBuffer(device, 2 * kHalfBytes);
+        vulkan_utils::buffer b = test_utils::createStorageBuffer(device, 2 * kHalfBytes);
+        fillBuffer(a, true);
+        fillBuffer(b, false);
+
+        clspv_utils::invocation first(kernel.createInvocationReq());
+        addCopy(first, a, 0, b, 0);
+
+        clspv_utils::invocation second(kernel.createInvocationReq());
+        addCopy(second, a, 0, b, 1);
+
+        const auto numWorkgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
+                                                                         vk::Extent3D(kPixelsPerRow, kNumRows, 1));
+
+        clspv_utils::invocation_batch batch(device);
+        batch.addInvocation(first, numWorkgroups);
+        batch.addInvocation(second, numWorkgroups);
+        batch.run();
+
+        const bool contentsMatch = checkHalf(b, 0) && checkHalf(b, 1);
+        logResult("read-after-read", batch.getBarrierCount(1), false, contentsMatch);
+    }
+}
+
+namespace invocation_batch_test {
+
+    void runAllTests(const clspv_utils::device& device)
+    {
+        try {
+            clspv_utils::module module = test_utils::loadModule(device, kModuleName);
+            clspv_utils::kernel kernel(module.createKernelReq(kEntryPoint), kWorkgroupSize);
+
+            runReadAfterWriteTest(kernel);
+            runReadAfterReadTest(kernel);
+        }
+        catch (const std::exception& e) {
+            LOGE("invocation-batch: %s result:fail", e.what());
+        }
+    }
+}
@@ -0,0 +1,19 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVTEST_INVOCATION_BATCH_TEST_HPP
+#define CLSPVTEST_INVOCATION_BATCH_TEST_HPP
+
+#include "clspv_utils/device.hpp"
+
+namespace invocation_batch_test {
+
+    // Run batches of two buffer copy dispatches: one in which the second reads what the first
+    // wrote, which requires a barrier between them, and one in which both read the same range,
+    // which does not. Check the barriers recorded before the second dispatch and the copied
+    // contents, and log the results.
+    void runAllTests(const clspv_utils::device& device);
+}
+
+#endif //CLSPVTEST_INVOCATION_BATCH_TEST_HPP
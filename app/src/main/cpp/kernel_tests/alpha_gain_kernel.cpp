@@ -15,30 +15,6 @@ namespace alpha_gain_kernel {
            int                              width,
            int                              height,
            const float                      alpha_gain_factor) {
-        struct scalar_args {
-            int inPitch;                    // offset 0
-            int inDeviceFormat;             // DevicePixelFormat offset 4
-            int inWidth;                    // offset 8
-            int inHeight;                   // offset 12
-            float inAlphaGainFactor;        // offset 16
-        };
-        static_assert(0 == offsetof(scalar_args, inPitch), "inPitch offset incorrect");
-        static_assert(4 == offsetof(scalar_args, inDeviceFormat), "inDeviceFormat offset incorrect");
-        static_assert(8 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
-        static_assert(12 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
-        static_assert(16 == offsetof(scalar_args, inAlphaGainFactor), "inAlphaGainFactor offset incorrect");
-
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inPitch = pitch;
-        scalars->inDeviceFormat = device_format;
-        scalars->inWidth = width;
-        scalars->inHeight = height;
-        scalars->inAlphaGainFactor = alpha_gain_factor;
-        scalars.reset();
-
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(width, height, 1));
 
@@ -47,7 +23,11 @@ namespace alpha_gain_kernel {
         invocation.addCombinedImageSampler(src_image);    //For GL Kernel
 //        invocation.addReadOnlyImageArgument(src_image);    //For CL Kernel
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addPodArgument<std::int32_t>(pitch);
+        invocation.addPodArgument<std::int32_t>(device_format);
+        invocation.addPodArgument<std::int32_t>(width);
+        invocation.addPodArgument<std::int32_t>(height);
+        invocation.addPodArgument<float>(alpha_gain_factor);
         return invocation.run(num_workgroups);
     }
 
@@ -6,9 +6,12 @@
 #define CLSPVTEST_ALPHA_GAIN_KERNEL_HPP
 
 #include "clspv_utils/clspv_utils_fwd.hpp"
+#include "clspv_utils/completion.hpp"
+#include "clspv_utils/transfer_batch.hpp"
 #include "clspv_utils/kernel.hpp"
 #include "gpu_types.hpp"
 #include "test_utils.hpp"
+#include "vulkan_utils/staging_pool.hpp"
 #include "vulkan_utils/vulkan_utils.hpp"
 #include "../../third_party/vulkan/vulkan/vulkan.hpp"
 #include "clspv_utils/device.hpp"
@@ -55,57 +58,71 @@ namespace alpha_gain_kernel {
 
         virtual void prepare() override
         {
+            // the previous iteration's setup must finish before its resources are replaced
+            mSetupComplete.wait();
+
             // allocate image buffer
             const std::size_t buffer_length = mExtent.width * mExtent.height * mExtent.depth;
             const std::size_t buffer_size = buffer_length * sizeof(PixelType);
 
-            // allocate buffers and images
+            // allocate buffers and images; the source image is written in place if the device
+            // supports sampling it with linear tiling
+            const vk::Format format = vk::Format(pixels::traits<PixelType>::vk_pixel_type);
+            const vk::ImageTiling tiling = (vulkan_utils::image::supportsFormatUse(mDevice.getPhysicalDevice(),
+                                                                                   format,
+                                                                                   vulkan_utils::image::kUsage_ReadOnly,
+                                                                                   vk::ImageTiling::eLinear)
+                                            ? vk::ImageTiling::eLinear
+                                            : vk::ImageTiling::eOptimal);
             mSrcImage = vulkan_utils::image(mDevice.getDevice(),
                                             mDevice.getMemoryProperties(),
                                             vk::Extent3D(mExtent.width, mExtent.height, 1),
-                                            vk::Format(pixels::traits<PixelType>::vk_pixel_type),
-                                            vulkan_utils::image::kUsage_ReadOnly);
-
-            mSrcImageStaging = vulkan_utils::createStagingBuffer(mDevice.getDevice(),
-                                                                 mDevice.getMemoryProperties(),
-                                                                 mSrcImage,
-                                                                 true,
-                                                                 false);
-
-            mDstBuffer = vulkan_utils::createStorageBuffer(mDevice.getDevice(),
-                                                           mDevice.getMemoryProperties(),
-                                                           buffer_size);
-
-            // initialize source memory with random data
-            auto srcImageMap = mSrcImageStaging.map<PixelType>();
-            PixelType* base = (PixelType*) srcImageMap.get();
+                                            format,
+                                            vulkan_utils::image::kUsage_ReadOnly,
+                                            nullptr,
+                                            tiling,
+                                            mDevice.getPhysicalDevice());
+
+            mDstBuffer = test_utils::createStorageBuffer(mDevice, buffer_size);
+
+            // initialize source memory
+            if (mSrcImage.isHostVisible())
+            {
+                mSrcImageStaging.reset();
+
+                auto srcImageMap = mSrcImage.map<char>();
+                fillSourcePixels(srcImageMap.get(), mSrcImage.getRowPitch());
+            }
+            else
+            {
+                mSrcImageStaging = mDevice.getStagingPool()->acquire(mSrcImage);
+
+                auto srcImageMap = mSrcImageStaging->map<char>(vulkan_utils::buffer::kMap_write);
+                fillSourcePixels(srcImageMap.get(), mExtent.width * sizeof(PixelType));
+                srcImageMap.reset();
+
+                // complete setup of the image
+                mSetup = clspv_utils::transfer_batch(mDevice);
+                mSetup.addUpload(*mSrcImageStaging, mSrcImage);
+                mSetupComplete = mSetup.submitAsync();
+            }
+        }
+
+        void fillSourcePixels(char* base, std::size_t rowPitch)
+        {
             vk::Extent3D coord;
             for (coord.height = 0; coord.height < mExtent.height; ++coord.height)
             {
+                PixelType* row = reinterpret_cast<PixelType*>(base + rowPitch * coord.height);
                 for (coord.width = 0; coord.width < mExtent.width; ++coord.width)
                 {
-                    PixelType* p = base + mExtent.width * coord.height + coord.width;
+                    PixelType* p = row + coord.width;
                     p->x = coord.width;
                     p->y = coord.height;
                     p->z = coord.height*coord.width;
                     p->w = 0.9f;
                 }
             }
-            srcImageMap.reset();
-
-            // complete setup of the image
-            auto setupCommand = vulkan_utils::allocate_command_buffer(mDevice.getDevice(),
-                                                                      mDevice.getCommandPool());
-            setupCommand->begin(vk::CommandBufferBeginInfo());
-            vulkan_utils::copyBufferToImage(*setupCommand, mSrcImageStaging, mSrcImage);
-            setupCommand->end();
-
-            vk::CommandBuffer rawCommand = *setupCommand;
-            vk::SubmitInfo submitInfo;
-            submitInfo.setCommandBufferCount(1)
-                    .setPCommandBuffers(&rawCommand);
-
-            mDevice.getComputeQueue().submit(submitInfo, nullptr);
         }
 
         virtual std::string getParameterString() const override
@@ -129,7 +146,7 @@ namespace alpha_gain_kernel {
 
         virtual test_utils::Evaluation evaluate(bool verbose) override
         {
-            auto dstBufferMap = mDstBuffer.map<PixelType>();
+            auto dstBufferMap = mDstBuffer.map<PixelType>(vulkan_utils::buffer::kMap_read);
             test_utils::Evaluation result;
 
             PixelType* base = (PixelType*) dstBufferMap.get();
@@ -156,12 +173,14 @@ namespace alpha_gain_kernel {
             return result;
         }
 
-        clspv_utils::device     mDevice;
-        vk::Extent3D            mExtent;
-        vulkan_utils::buffer    mDstBuffer;
-        vulkan_utils::image     mSrcImage;
-        vulkan_utils::buffer    mSrcImageStaging;
-        float                   mAlphaGainFactor;
+        clspv_utils::device                       mDevice;
+        vk::Extent3D                              mExtent;
+        vulkan_utils::buffer                      mDstBuffer;
+        vulkan_utils::image                       mSrcImage;
+        vulkan_utils::staging_pool::pooled_buffer mSrcImageStaging;
+        clspv_utils::transfer_batch               mSetup;
+        clspv_utils::completion                   mSetupComplete;
+        float                                     mAlphaGainFactor;
     };
 
     template <typename PixelType>
@@ -18,44 +18,20 @@ namespace copybuffertobuffer_kernel {
            std::int32_t             width,
            std::int32_t             height)
     {
-        struct scalar_args {
-            std::int32_t inSrcPitch;         // offset 0
-            std::int32_t inSrcOffset;        // offset 4
-            std::int32_t inDstPitch;         // offset 8
-            std::int32_t inDstOffset;        // offset 12
-            std::int32_t inIs32Bit;          // offset 16
-            std::int32_t inWidth;            // offset 20
-            std::int32_t inHeight;           // offset 24
-        };
-        static_assert(0 == offsetof(scalar_args, inSrcPitch), "inSrcPitch offset incorrect");
-        static_assert(4 == offsetof(scalar_args, inSrcOffset), "inSrcOffset offset incorrect");
-        static_assert(8 == offsetof(scalar_args, inDstPitch), "inDstPitch offset incorrect");
-        static_assert(12 == offsetof(scalar_args, inDstOffset), "inDstOffset offset incorrect");
-        static_assert(16 == offsetof(scalar_args, inIs32Bit), "inIs32Bit offset incorrect");
-        static_assert(20 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
-        static_assert(24 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
-
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inSrcPitch = src_pitch;
-        scalars->inSrcOffset = src_offset;
-        scalars->inDstPitch = dst_pitch;
-        scalars->inDstOffset = dst_offset;
-        scalars->inIs32Bit = is32Bit;
-        scalars->inWidth = width;
-        scalars->inHeight = height;
-        scalars.reset();
-
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(width, height, 1));
 
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
-        invocation.addStorageBufferArgument(src_buffer);
+        invocation.addReadOnlyStorageBufferArgument(src_buffer);
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addPodArgument<std::int32_t>(src_pitch);
+        invocation.addPodArgument<std::int32_t>(src_offset);
+        invocation.addPodArgument<std::int32_t>(dst_pitch);
+        invocation.addPodArgument<std::int32_t>(dst_offset);
+        invocation.addPodArgument<std::int32_t>(is32Bit);
+        invocation.addPodArgument<std::int32_t>(width);
+        invocation.addPodArgument<std::int32_t>(height);
 
         return invocation.run(num_workgroups);
     }
@@ -94,12 +70,8 @@ namespace copybuffertobuffer_kernel {
         mIs32Bit = (sizeofPixelComponent == 4);
 
         // allocate buffers and images
-        mSrcBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
-                                                       buffer_size);
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
-                                                       buffer_size);
+        mSrcBuffer = test_utils::createStorageBuffer(device, buffer_size);
+        mDstBuffer = test_utils::createStorageBuffer(device, buffer_size);
     }
 
     TestBase::~TestBase()
@@ -84,8 +84,8 @@ namespace copybuffertobuffer_kernel {
 
         virtual test_utils::Evaluation evaluate(bool verbose) override
         {
-            auto srcBufferMap = mSrcBuffer.map<PixelType>();
-            auto dstBufferMap = mDstBuffer.map<PixelType>();
+            auto srcBufferMap = mSrcBuffer.map<PixelType>(vulkan_utils::buffer::kMap_read);
+            auto dstBufferMap = mDstBuffer.map<PixelType>(vulkan_utils::buffer::kMap_read);
             return test_utils::check_results(srcBufferMap.get(),
                                              dstBufferMap.get(),
                                              mBufferExtent,
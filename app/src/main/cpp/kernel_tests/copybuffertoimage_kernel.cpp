@@ -37,50 +37,21 @@ namespace copybuffertoimage_kernel {
            int                      width,
            int                      height)
     {
-        struct scalar_args {
-            int inSrcOffset;        // offset 0
-            int inSrcPitch;         // offset 4
-            int inSrcChannelOrder;  // offset 8 -- cl_channel_order
-            int inSrcChannelType;   // offset 12 -- cl_channel_type
-            int inSwapComponents;   // offset 16 -- bool
-            int inPremultiply;      // offset 20 -- bool
-            int inWidth;            // offset 24
-            int inHeight;           // offset 28
-        };
-        static_assert(0 == offsetof(scalar_args, inSrcOffset), "inSrcOffset offset incorrect");
-        static_assert(4 == offsetof(scalar_args, inSrcPitch), "inSrcPitch offset incorrect");
-        static_assert(8 == offsetof(scalar_args, inSrcChannelOrder),
-                      "inSrcChannelOrder offset incorrect");
-        static_assert(12 == offsetof(scalar_args, inSrcChannelType),
-                      "inSrcChannelType offset incorrect");
-        static_assert(16 == offsetof(scalar_args, inSwapComponents),
-                      "inSwapComponents offset incorrect");
-        static_assert(20 == offsetof(scalar_args, inPremultiply), "inPremultiply offset incorrect");
-        static_assert(24 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
-        static_assert(28 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
-
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inSrcOffset = src_offset;
-        scalars->inSrcPitch = src_pitch;
-        scalars->inSrcChannelOrder = src_channel_order;
-        scalars->inSrcChannelType = src_channel_type;
-        scalars->inSwapComponents = (swap_components ? 1 : 0);
-        scalars->inPremultiply = (premultiply ? 1 : 0);
-        scalars->inWidth = width;
-        scalars->inHeight = height;
-        scalars.reset();
-
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(width, height, 1));
 
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
-        invocation.addStorageBufferArgument(src_buffer);
+        invocation.addReadOnlyStorageBufferArgument(src_buffer);
         invocation.addWriteOnlyImageArgument(dst_image);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addPodArgument<std::int32_t>(src_offset);
+        invocation.addPodArgument<std::int32_t>(src_pitch);
+        invocation.addPodArgument<std::int32_t>(src_channel_order);
+        invocation.addPodArgument<std::int32_t>(src_channel_type);
+        invocation.addPodArgument<std::int32_t>(swap_components ? 1 : 0);
+        invocation.addPodArgument<std::int32_t>(premultiply ? 1 : 0);
+        invocation.addPodArgument<std::int32_t>(width);
+        invocation.addPodArgument<std::int32_t>(height);
 
         return invocation.run(num_workgroups);
     }
@@ -6,9 +6,12 @@
 #define CLSPVTEST_COPYBUFFERTOIMAGE_KERNEL_HPP
 
 #include "clspv_utils/clspv_utils_fwd.hpp"
+#include "clspv_utils/completion.hpp"
+#include "clspv_utils/transfer_batch.hpp"
 #include "clspv_utils/kernel.hpp"
 #include "gpu_types.hpp"
 #include "test_utils.hpp"
+#include "vulkan_utils/staging_pool.hpp"
 #include "vulkan_utils/vulkan_utils.hpp"
 
 #include <vulkan/vulkan.hpp>
@@ -47,28 +50,23 @@ namespace copybuffertoimage_kernel {
                 throw std::runtime_error("Format not supported for storage");
             }
 
-                mDevice = device.getDevice();
-            mComputeQueue = device.getComputeQueue();
-            mCommandPool = device.getCommandPool();
+            mDevice = device;
 
             const std::size_t buffer_length =
                     mBufferExtent.width * mBufferExtent.height * mBufferExtent.depth;
             const std::size_t buffer_size = buffer_length * sizeof(BufferPixelType);
 
             // allocate buffers and images
-            mSrcBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                           device.getMemoryProperties(),
-                                                           buffer_size);
+            mSrcBuffer = test_utils::createStorageBuffer(device, buffer_size);
             mDstImage = vulkan_utils::image(device.getDevice(),
                                          device.getMemoryProperties(),
                                          mBufferExtent,
                                          vk::Format(pixels::traits<ImagePixelType>::vk_pixel_type),
                                          vulkan_utils::image::kUsage_ReadWrite);
-            mDstImageStaging = vulkan_utils::createStagingBuffer(device.getDevice(),
-                                                                 device.getMemoryProperties(),
-                                                                 mDstImage,
-                                                                 false,
-                                                                 true);
+            mDstImageStaging = device.getStagingPool()->acquire(mDstImage);
+
+            mReadback = clspv_utils::transfer_batch(device);
+            mReadback.addReadback(mDstImage, *mDstImageStaging);
 
             // initialize source memory with random data
             auto srcBufferMap = mSrcBuffer.map<BufferPixelType>();
@@ -83,7 +81,7 @@ namespace copybuffertoimage_kernel {
 
             // initialize destination memory (copy source and invert, thereby forcing the kernel to make the change back to the source value)
             auto srcBufferMap = mSrcBuffer.map<BufferPixelType>();
-            auto dstImageMap = mDstImageStaging.map<ImagePixelType>();
+            auto dstImageMap = mDstImageStaging->map<ImagePixelType>();
             test_utils::copy_pixel_buffer<BufferPixelType, ImagePixelType>(srcBufferMap.get(),
                                                                            srcBufferMap.get() +
                                                                            buffer_length,
@@ -110,22 +108,10 @@ namespace copybuffertoimage_kernel {
         virtual test_utils::Evaluation evaluate(bool verbose) override
         {
             // readback the image data
-            vk::UniqueCommandBuffer readbackCommand = vulkan_utils::allocate_command_buffer(
-                    mDevice, mCommandPool);
-            readbackCommand->begin(vk::CommandBufferBeginInfo());
-            vulkan_utils::copyImageToBuffer(*readbackCommand, mDstImage, mDstImageStaging);
-            readbackCommand->end();
-
-            vk::CommandBuffer rawCommand = *readbackCommand;
-            vk::SubmitInfo submitInfo;
-            submitInfo.setCommandBufferCount(1)
-                    .setPCommandBuffers(&rawCommand);
+            mReadback.run();
 
-            mComputeQueue.submit(submitInfo, nullptr);
-            mComputeQueue.waitIdle();
-
-            auto srcBufferMap = mSrcBuffer.map<BufferPixelType>();
-            auto dstImageMap = mDstImageStaging.map<ImagePixelType>();
+            auto srcBufferMap = mSrcBuffer.map<BufferPixelType>(vulkan_utils::buffer::kMap_read);
+            auto dstImageMap = mDstImageStaging->map<ImagePixelType>(vulkan_utils::buffer::kMap_read);
             return test_utils::check_results(srcBufferMap.get(),
                                              dstImageMap.get(),
                                              mBufferExtent,
@@ -141,13 +127,12 @@ namespace copybuffertoimage_kernel {
                                                    vulkan_utils::image::kUsage_ReadWrite);
         }
 
-        vk::Device              mDevice;
-        vk::CommandPool         mCommandPool;
-        vk::Queue               mComputeQueue;
-        vk::Extent3D            mBufferExtent;
-        vulkan_utils::buffer    mSrcBuffer;
-        vulkan_utils::image     mDstImage;
-        vulkan_utils::buffer    mDstImageStaging;
+        clspv_utils::device                       mDevice;
+        vk::Extent3D                              mBufferExtent;
+        vulkan_utils::buffer                      mSrcBuffer;
+        vulkan_utils::image                       mDstImage;
+        vulkan_utils::staging_pool::pooled_buffer mDstImageStaging;
+        clspv_utils::transfer_batch               mReadback;
 
     };
 
@@ -37,39 +37,6 @@ namespace copyimagetobuffer_kernel {
            int                      width,
            int                      height)
     {
-        struct scalar_args {
-            int inDestOffset;       // offset 0
-            int inDestPitch;        // offset 4
-            int inDestChannelOrder; // offset 8 -- cl_channel_order
-            int inDestChannelType;  // offset 12 -- cl_channel_type
-            int inSwapComponents;   // offset 16 -- bool
-            int inWidth;            // offset 20
-            int inHeight;           // offset 24
-        };
-        static_assert(0 == offsetof(scalar_args, inDestOffset), "inDestOffset offset incorrect");
-        static_assert(4 == offsetof(scalar_args, inDestPitch), "inDestPitch offset incorrect");
-        static_assert(8 == offsetof(scalar_args, inDestChannelOrder),
-                      "inDestChannelOrder offset incorrect");
-        static_assert(12 == offsetof(scalar_args, inDestChannelType),
-                      "inDestChannelType offset incorrect");
-        static_assert(16 == offsetof(scalar_args, inSwapComponents),
-                      "inSwapComponents offset incorrect");
-        static_assert(20 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
-        static_assert(24 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
-
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inDestOffset = dst_offset;
-        scalars->inDestPitch = width;
-        scalars->inDestChannelOrder = dst_channel_order;
-        scalars->inDestChannelType = dst_channel_type;
-        scalars->inSwapComponents = (swap_components ? 1 : 0);
-        scalars->inWidth = width;
-        scalars->inHeight = height;
-        scalars.reset();
-
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(width, height, 1));
 
@@ -77,7 +44,13 @@ namespace copyimagetobuffer_kernel {
 
         invocation.addReadOnlyImageArgument(src_image);
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addPodArgument<std::int32_t>(dst_offset);
+        invocation.addPodArgument<std::int32_t>(width);
+        invocation.addPodArgument<std::int32_t>(dst_channel_order);
+        invocation.addPodArgument<std::int32_t>(dst_channel_type);
+        invocation.addPodArgument<std::int32_t>(swap_components ? 1 : 0);
+        invocation.addPodArgument<std::int32_t>(width);
+        invocation.addPodArgument<std::int32_t>(height);
 
         return invocation.run(num_workgroups);
     }
@@ -6,9 +6,12 @@
 #define CLSPVTEST_COPYIMAGETOBUFFER_KERNEL_HPP
 
 #include "clspv_utils/clspv_utils_fwd.hpp"
+#include "clspv_utils/completion.hpp"
+#include "clspv_utils/transfer_batch.hpp"
 #include "clspv_utils/kernel.hpp"
 #include "gpu_types.hpp"
 #include "test_utils.hpp"
+#include "vulkan_utils/staging_pool.hpp"
 #include "vulkan_utils/vulkan_utils.hpp"
 
 #include <vulkan/vulkan.hpp>
@@ -41,38 +44,23 @@ namespace copyimagetobuffer_kernel {
             const std::size_t buffer_size = buffer_length * sizeof(BufferPixelType);
 
             // allocate buffers and images
-            mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                           device.getMemoryProperties(),
-                                                           buffer_size);
+            mDstBuffer = test_utils::createStorageBuffer(device, buffer_size);
             mSrcImage = vulkan_utils::image(device.getDevice(),
                                                      device.getMemoryProperties(),
                                                      mBufferExtent,
                                                      vk::Format(pixels::traits<ImagePixelType>::vk_pixel_type),
                                                      vulkan_utils::image::kUsage_ReadOnly);
-            mSrcImageStaging = vulkan_utils::createStagingBuffer(device.getDevice(),
-                                                                 device.getMemoryProperties(),
-                                                                 mSrcImage,
-                                                                 true,
-                                                                 false);
+            mSrcImageStaging = device.getStagingPool()->acquire(mSrcImage);
 
             // initialize source memory with random data
-            auto srcImageMap = mSrcImageStaging.map<ImagePixelType>();
+            auto srcImageMap = mSrcImageStaging->map<ImagePixelType>();
             test_utils::fill_random_pixels<ImagePixelType>(srcImageMap.get(), srcImageMap.get() + buffer_length);
             srcImageMap.reset();
 
             // complete setup of the image
-            mSetupCommand = vulkan_utils::allocate_command_buffer(device.getDevice(),
-                                                                                         device.getCommandPool());
-            mSetupCommand->begin(vk::CommandBufferBeginInfo());
-            vulkan_utils::copyBufferToImage(*mSetupCommand, mSrcImageStaging, mSrcImage);
-            mSetupCommand->end();
-
-            vk::CommandBuffer rawCommand = *mSetupCommand;
-            vk::SubmitInfo submitInfo;
-            submitInfo.setCommandBufferCount(1)
-                    .setPCommandBuffers(&rawCommand);
-
-            device.getComputeQueue().submit(submitInfo, nullptr);
+            mSetup = clspv_utils::transfer_batch(device);
+            mSetup.addUpload(*mSrcImageStaging, mSrcImage);
+            mSetupComplete = mSetup.submitAsync();
         }
 
         virtual void prepare() override
@@ -80,7 +68,7 @@ namespace copyimagetobuffer_kernel {
             const std::size_t buffer_length = mBufferExtent.width * mBufferExtent.height * mBufferExtent.depth;
 
             // initialize destination memory (copy source and invert, thereby forcing the kernel to make the change back to the source value)
-            auto srcImageMap = mSrcImageStaging.map<ImagePixelType>();
+            auto srcImageMap = mSrcImageStaging->map<ImagePixelType>();
             auto dstBufferMap = mDstBuffer.map<BufferPixelType>();
             test_utils::copy_pixel_buffer<ImagePixelType, BufferPixelType>(srcImageMap.get(), srcImageMap.get() + buffer_length, dstBufferMap.get());
             test_utils::invert_pixel_buffer<BufferPixelType>(dstBufferMap.get(), dstBufferMap.get() + buffer_length);
@@ -102,8 +90,8 @@ namespace copyimagetobuffer_kernel {
 
         virtual test_utils::Evaluation evaluate(bool verbose) override
         {
-            auto srcImageMap = mSrcImageStaging.map<ImagePixelType>();
-            auto dstBufferMap = mDstBuffer.map<BufferPixelType>();
+            auto srcImageMap = mSrcImageStaging->map<ImagePixelType>(vulkan_utils::buffer::kMap_read);
+            auto dstBufferMap = mDstBuffer.map<BufferPixelType>(vulkan_utils::buffer::kMap_read);
             return test_utils::check_results(srcImageMap.get(),
                                              dstBufferMap.get(),
                                              mBufferExtent,
@@ -111,11 +99,12 @@ namespace copyimagetobuffer_kernel {
                                              verbose);
         }
 
-        vk::Extent3D            mBufferExtent;
-        vulkan_utils::buffer    mDstBuffer;
-        vulkan_utils::image     mSrcImage;
-        vulkan_utils::buffer    mSrcImageStaging;
-        vk::UniqueCommandBuffer mSetupCommand;
+        vk::Extent3D                              mBufferExtent;
+        vulkan_utils::buffer                      mDstBuffer;
+        vulkan_utils::image                       mSrcImage;
+        vulkan_utils::staging_pool::pooled_buffer mSrcImageStaging;
+        clspv_utils::transfer_batch               mSetup;
+        clspv_utils::completion                   mSetupComplete;
     };
 
     template <typename BufferPixelType, typename ImagePixelType>
@@ -4,6 +4,38 @@
 
 #include "fill_kernel.hpp"
 
+#include "clspv_utils/invocation_batch.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+    clspv_utils::invocation
+    create_invocation(clspv_utils::kernel&      kernel,
+                      vulkan_utils::buffer&     dst_buffer,
+                      vk::DeviceSize            dst_offset,
+                      vk::DeviceSize            dst_range,
+                      int                       pitch,
+                      int                       device_format,
+                      int                       offset_x,
+                      int                       offset_y,
+                      int                       width,
+                      int                       height,
+                      const gpu_types::float4&  color) {
+        clspv_utils::invocation invocation(kernel.createInvocationReq());
+
+        invocation.addStorageBufferArgument(dst_buffer, dst_offset, dst_range);
+        invocation.addPodArgument<std::int32_t>(pitch);
+        invocation.addPodArgument<std::int32_t>(device_format);
+        invocation.addPodArgument<std::int32_t>(offset_x);
+        invocation.addPodArgument<std::int32_t>(offset_y);
+        invocation.addPodArgument<std::int32_t>(width);
+        invocation.addPodArgument<std::int32_t>(height);
+        invocation.addPodArgument(color);
+        return invocation;
+    }
+}
+
 namespace fill_kernel {
 
     clspv_utils::execution_time_t
@@ -16,52 +48,151 @@ namespace fill_kernel {
            int                      width,
            int                      height,
            const gpu_types::float4& color) {
-        struct scalar_args {
-            int inPitch;        // offset 0
-            int inDeviceFormat; // DevicePixelFormat offset 4
-            int inOffsetX;      // offset 8
-            int inOffsetY;      // offset 12
-            int inWidth;        // offset 16
-            int inHeight;       // offset 20
-            gpu_types::float4 inColor;        // offset 32
-        };
-        static_assert(0 == offsetof(scalar_args, inPitch), "inPitch offset incorrect");
-        static_assert(4 == offsetof(scalar_args, inDeviceFormat),
-                      "inDeviceFormat offset incorrect");
-        static_assert(8 == offsetof(scalar_args, inOffsetX), "inOffsetX offset incorrect");
-        static_assert(12 == offsetof(scalar_args, inOffsetY), "inOffsetY offset incorrect");
-        static_assert(16 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
-        static_assert(20 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
-        static_assert(32 == offsetof(scalar_args, inColor), "inColor offset incorrect");
-
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inPitch = pitch;
-        scalars->inDeviceFormat = device_format;
-        scalars->inOffsetX = offset_x;
-        scalars->inOffsetY = offset_y;
-        scalars->inWidth = width;
-        scalars->inHeight = height;
-        scalars->inColor = color;
-        scalars.reset();
+        const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
+                                                                          vk::Extent3D(width, height, 1));
 
+        clspv_utils::invocation invocation = create_invocation(kernel,
+                                                               dst_buffer,
+                                                               0, VK_WHOLE_SIZE,
+                                                               pitch,
+                                                               device_format,
+                                                               offset_x,
+                                                               offset_y,
+                                                               width,
+                                                               height,
+                                                               color);
+        return invocation.run(num_workgroups);
+    }
+
+    clspv_utils::invocation
+    record(clspv_utils::kernel&     kernel,
+           vulkan_utils::buffer&    dst_buffer,
+           int                      pitch,
+           int                      device_format,
+           int                      offset_x,
+           int                      offset_y,
+           int                      width,
+           int                      height,
+           const gpu_types::float4& color) {
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(width, height, 1));
 
-        clspv_utils::invocation invocation(kernel.createInvocationReq());
+        clspv_utils::invocation invocation = create_invocation(kernel,
+                                                               dst_buffer,
+                                                               0, VK_WHOLE_SIZE,
+                                                               pitch,
+                                                               device_format,
+                                                               offset_x,
+                                                               offset_y,
+                                                               width,
+                                                               height,
+                                                               color);
+        invocation.record(num_workgroups);
+        return invocation;
+    }
 
-        invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
-        return invocation.run(num_workgroups);
+    clspv_utils::execution_time_t
+    invokeChunked(clspv_utils::kernel&              kernel,
+                  vulkan_utils::chunked_buffer&     dst_buffer,
+                  int                               device_format,
+                  int                               width,
+                  const gpu_types::float4&          color,
+                  std::uint32_t                     maxTileWorkgroups) {
+        const auto& device = kernel.getDevice();
+        auto limits = device.getPhysicalDevice().getProperties().limits;
+        const auto workgroupSize = kernel.getWorkgroupSize();
+
+        if (0 != maxTileWorkgroups) {
+            for (auto& count : limits.maxComputeWorkGroupCount) {
+                count = std::min(count, maxTileWorkgroups);
+            }
+        }
+
+        // Each chunk is filled as an image of its own rows, and each tile of a chunk's dispatch
+        // is told where it begins through the kernel's offset arguments
+        std::vector<clspv_utils::invocation> invocations;
+        std::vector<vk::Extent3D> numWorkgroups;
+        for (auto& chunk : dst_buffer.getChunks()) {
+            const auto chunkWorkgroups = vulkan_utils::computeNumberWorkgroups(workgroupSize,
+                                                                               vk::Extent3D(width, chunk.mNumRows, 1));
+
+            for (auto& tile : vulkan_utils::splitDispatch(chunkWorkgroups, limits)) {
+                const int offset_x = tile.mBaseWorkgroup.width * workgroupSize.width;
+                const int offset_y = tile.mBaseWorkgroup.height * workgroupSize.height;
+
+                invocations.push_back(create_invocation(kernel,
+                                                        dst_buffer.getBuffer(chunk.mBufferIndex),
+                                                        chunk.mOffset, chunk.mSize,
+                                                        width, // pitch
+                                                        device_format,
+                                                        offset_x,
+                                                        offset_y,
+                                                        std::min<int>(tile.mNumWorkgroups.width * workgroupSize.width, width - offset_x),
+                                                        std::min<int>(tile.mNumWorkgroups.height * workgroupSize.height, chunk.mNumRows - offset_y),
+                                                        color));
+                numWorkgroups.push_back(tile.mNumWorkgroups);
+            }
+        }
+
+        clspv_utils::invocation_batch batch(device);
+        for (std::size_t i = 0; i < invocations.size(); ++i) {
+            batch.addInvocation(invocations[i], numWorkgroups[i]);
+        }
+        return batch.run();
+    }
+
+    vk::Extent3D parseBufferExtent(const std::vector<std::string>& args)
+    {
+        vk::Extent3D result(64, 64, 1);
+
+        for (auto arg = args.begin(); arg != args.end(); arg = std::next(arg)) {
+            if (*arg == "-w") {
+                arg = std::next(arg);
+                if (arg == args.end()) throw std::runtime_error("badly formed arguments to fill test");
+                result.width = std::atoi(arg->c_str());
+            }
+            else if (*arg == "-h") {
+                arg = std::next(arg);
+                if (arg == args.end()) throw std::runtime_error("badly formed arguments to fill test");
+                result.height = std::atoi(arg->c_str());
+            }
+        }
+
+        return result;
+    }
+
+    chunk_limits parseChunkLimits(const std::vector<std::string>& args)
+    {
+        chunk_limits result;
+
+        for (auto arg = args.begin(); arg != args.end(); arg = std::next(arg)) {
+            if (*arg == "-maxbuffer") {
+                arg = std::next(arg);
+                if (arg == args.end()) throw std::runtime_error("badly formed arguments to fill test");
+                result.mMaxBufferBytes = std::strtoull(arg->c_str(), nullptr, 10);
+            }
+            else if (*arg == "-maxchunk") {
+                arg = std::next(arg);
+                if (arg == args.end()) throw std::runtime_error("badly formed arguments to fill test");
+                result.mMaxChunkBytes = std::strtoull(arg->c_str(), nullptr, 10);
+            }
+            else if (*arg == "-maxtile") {
+                arg = std::next(arg);
+                if (arg == args.end()) throw std::runtime_error("badly formed arguments to fill test");
+                result.mMaxTileWorkgroups = std::atoi(arg->c_str());
+            }
+        }
+
+        return result;
     }
 
     test_utils::KernelTest::invocation_tests getAllTestVariants()
     {
         const auto test_variants = {
                 getTestVariant<gpu_types::float4>(),
-                getTestVariant<gpu_types::half4>()
+                getTestVariant<gpu_types::half4>(),
+                getChunkedTestVariant<gpu_types::float4>(),
+                getChunkedTestVariant<gpu_types::half4>()
         };
 
         return test_utils::KernelTest::invocation_tests(test_variants);
@@ -9,6 +9,7 @@
 #include "clspv_utils/kernel.hpp"
 #include "gpu_types.hpp"
 #include "test_utils.hpp"
+#include "vulkan_utils/chunked_buffer.hpp"
 #include "vulkan_utils/vulkan_utils.hpp"
 
 #include <vulkan/vulkan.h>
@@ -26,36 +27,59 @@ namespace fill_kernel {
            int                              height,
            const gpu_types::float4&         color);
 
+    // Build and record a fill invocation that can be resubmitted repeatedly.
+    clspv_utils::invocation
+    record(clspv_utils::kernel&             kernel,
+           vulkan_utils::buffer&            dst_buffer,
+           int                              pitch,
+           int                              device_format,
+           int                              offset_x,
+           int                              offset_y,
+           int                              width,
+           int                              height,
+           const gpu_types::float4&         color);
+
+    // Fill a buffer too large to bind whole, such as an 8K float4 frame, with one invocation per
+    // chunk and per dispatch tile, submitted together in one batch. The pitch is the width.
+    // Dispatch tiles are at most maxTileWorkgroups in each dimension, if it is not zero, as
+    // well as within the device's limits.
+    clspv_utils::execution_time_t
+    invokeChunked(clspv_utils::kernel&              kernel,
+                  vulkan_utils::chunked_buffer&     dst_buffer,
+                  int                               device_format,
+                  int                               width,
+                  const gpu_types::float4&          color,
+                  std::uint32_t                     maxTileWorkgroups = 0);
+
     test_utils::KernelTest::invocation_tests getAllTestVariants();
 
+    // The extent given by the test's -w and -h arguments, 64x64 by default
+    vk::Extent3D parseBufferExtent(const std::vector<std::string>& args);
+
+    // Limits given by a chunked test's -maxbuffer, -maxchunk (both in bytes) and -maxtile (in
+    // workgroups) arguments, which force several buffers, chunks and dispatch tiles at small
+    // extents. By default only the device's limits apply.
+    struct chunk_limits {
+        vk::DeviceSize  mMaxBufferBytes     = vulkan_utils::chunked_buffer::kDefaultMaxBufferBytes;
+        vk::DeviceSize  mMaxChunkBytes      = VK_WHOLE_SIZE;
+        std::uint32_t   mMaxTileWorkgroups  = 0;
+    };
+
+    chunk_limits parseChunkLimits(const std::vector<std::string>& args);
+
     template <typename PixelType>
     struct Test : public test_utils::Test
     {
         Test(clspv_utils::kernel& kernel, const std::vector<std::string>& args) :
-            mBufferExtent(64, 64, 1),
+            mBufferExtent(parseBufferExtent(args)),
             mFillColor(0.25f, 0.50f, 0.75f, 1.0f)
         {
             auto& device = kernel.getDevice();
 
-            for (auto arg = args.begin(); arg != args.end(); arg = std::next(arg)) {
-                if (*arg == "-w") {
-                    arg = std::next(arg);
-                    if (arg == args.end()) throw std::runtime_error("badly formed arguments to fill test");
-                    mBufferExtent.width = std::atoi(arg->c_str());
-                }
-                else if (*arg == "-h") {
-                    arg = std::next(arg);
-                    if (arg == args.end()) throw std::runtime_error("badly formed arguments to fill test");
-                    mBufferExtent.height = std::atoi(arg->c_str());
-                }
-            }
-
             // allocate image buffer
             const std::size_t buffer_length = mBufferExtent.width * mBufferExtent.height * mBufferExtent.depth;
             const std::size_t buffer_size = buffer_length * sizeof(PixelType);
-            mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                           device.getMemoryProperties(),
-                                                           buffer_size);
+            mDstBuffer = test_utils::createStorageBuffer(device, buffer_size);
         }
 
         virtual void prepare() override
@@ -86,9 +110,20 @@ namespace fill_kernel {
                           mFillColor); // color
         }
 
+        virtual clspv_utils::invocation recordInvocation(clspv_utils::kernel& kernel) override
+        {
+            return record(kernel,
+                          mDstBuffer, // dst_buffer
+                          mBufferExtent.width,   // pitch
+                          pixels::traits<PixelType>::device_pixel_format, // device_format
+                          0, 0, // offset_x, offset_y
+                          mBufferExtent.width, mBufferExtent.height, // width, height
+                          mFillColor); // color
+        }
+
         virtual test_utils::Evaluation evaluate(bool verbose) override
         {
-            auto dstBufferMap = mDstBuffer.map<PixelType>();
+            auto dstBufferMap = mDstBuffer.map<PixelType>(vulkan_utils::buffer::kMap_read);
             return test_utils::check_results(dstBufferMap.get(),
                                              mBufferExtent,
                                              mBufferExtent.width,
@@ -101,6 +136,71 @@ namespace fill_kernel {
         gpu_types::float4       mFillColor;
     };
 
+    // Like Test, but the destination is a chunked_buffer
+    template <typename PixelType>
+    struct ChunkedTest : public test_utils::Test
+    {
+        ChunkedTest(clspv_utils::kernel& kernel, const std::vector<std::string>& args) :
+            mBufferExtent(parseBufferExtent(args)),
+            mLimits(parseChunkLimits(args)),
+            mFillColor(0.25f, 0.50f, 0.75f, 1.0f)
+        {
+            mDstChunks = test_utils::createChunkedStorageBuffer(kernel.getDevice(),
+                                                                mBufferExtent.height * mBufferExtent.depth,
+                                                                mBufferExtent.width * sizeof(PixelType),
+                                                                mLimits.mMaxBufferBytes,
+                                                                mLimits.mMaxChunkBytes);
+        }
+
+        virtual void prepare() override
+        {
+            const PixelType src_value = pixels::traits<PixelType>::translate((gpu_types::float4){ 0.0f, 0.0f, 0.0f, 0.0f });
+            for (std::size_t i = 0; i < mDstChunks.getBufferCount(); ++i) {
+                const std::size_t buffer_length = mDstChunks.getBufferRowCount(i) * mBufferExtent.width;
+                auto dstBufferMap = mDstChunks.getBuffer(i).map<PixelType>(vulkan_utils::buffer::kMap_write);
+                std::fill(dstBufferMap.get(), dstBufferMap.get() + buffer_length, src_value);
+            }
+        }
+
+        virtual std::string getParameterString() const override
+        {
+            std::ostringstream os;
+            os << "<w:" << mBufferExtent.width << " h:" << mBufferExtent.height << " d:" << mBufferExtent.depth
+               << " buffers:" << mDstChunks.getBufferCount()
+               << " chunks:" << mDstChunks.getChunks().size() << ">";
+            return os.str();
+        }
+
+        virtual clspv_utils::execution_time_t run(clspv_utils::kernel& kernel) override
+        {
+            return invokeChunked(kernel,
+                                 mDstChunks,
+                                 pixels::traits<PixelType>::device_pixel_format,
+                                 mBufferExtent.width,
+                                 mFillColor,
+                                 mLimits.mMaxTileWorkgroups);
+        }
+
+        virtual test_utils::Evaluation evaluate(bool verbose) override
+        {
+            test_utils::Evaluation result;
+            for (std::size_t i = 0; i < mDstChunks.getBufferCount(); ++i) {
+                auto dstBufferMap = mDstChunks.getBuffer(i).map<PixelType>(vulkan_utils::buffer::kMap_read);
+                result += test_utils::check_results(dstBufferMap.get(),
+                                                    vk::Extent3D(mBufferExtent.width, mDstChunks.getBufferRowCount(i), 1),
+                                                    mBufferExtent.width,
+                                                    mFillColor,
+                                                    verbose);
+            }
+            return result;
+        }
+
+        vk::Extent3D                    mBufferExtent;
+        chunk_limits                    mLimits;
+        vulkan_utils::chunked_buffer    mDstChunks;
+        gpu_types::float4               mFillColor;
+    };
+
     template <typename PixelType>
     test_utils::InvocationTest getTestVariant()
     {
@@ -110,6 +210,15 @@ namespace fill_kernel {
         return test_utils::make_invocation_test< Test<PixelType> >(os.str());
     }
 
+    template <typename PixelType>
+    test_utils::InvocationTest getChunkedTestVariant()
+    {
+        std::ostringstream os;
+        os << "<dst:" << pixels::traits<PixelType>::type_name << " chunked>";
+
+        return test_utils::make_invocation_test< ChunkedTest<PixelType> >(os.str());
+    }
+
 
 }
 
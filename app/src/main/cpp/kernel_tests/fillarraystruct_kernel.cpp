@@ -38,9 +38,7 @@ namespace fillarraystruct_kernel {
         // allocate destination buffer
         const std::size_t buffer_size = mBufferWidth * sizeof(FloatArrayWrapper);
         const int num_floats_in_buffer = num_floats_in_struct * mBufferWidth;
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
-                                                       buffer_size);
+        mDstBuffer = test_utils::createStorageBuffer(device, buffer_size);
 
         mExpectedResults.resize(mBufferWidth);
     }
@@ -78,7 +76,7 @@ namespace fillarraystruct_kernel {
 
     test_utils::Evaluation Test::evaluate(bool verbose)
     {
-        auto dstBufferMap = mDstBuffer.map<float>();
+        auto dstBufferMap = mDstBuffer.map<float>(vulkan_utils::buffer::kMap_read);
         return test_utils::check_results(reinterpret_cast<float*>(mExpectedResults.data()),
                                          dstBufferMap.get(),
                                          vk::Extent3D(num_floats_in_struct, mBufferWidth, 1),
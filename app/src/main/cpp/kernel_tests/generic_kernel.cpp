@@ -50,9 +50,7 @@ namespace generic_kernel {
                 if (arg == args.end()) clspv_utils::fail_runtime_error("badly formed arguments to generic test");
                 const std::size_t bufferSize = std::atoi(arg->c_str());
 
-                mStorageBuffers.push_back(vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                                            device.getMemoryProperties(),
-                                                                            bufferSize));
+                mStorageBuffers.push_back(test_utils::createStorageBuffer(device, bufferSize));
                 mArgOrder.push_back(kind_storageBuffer);
             }
             else if (*arg == "-sb") {
@@ -61,9 +59,7 @@ namespace generic_kernel {
                 if (arg == args.end()) clspv_utils::fail_runtime_error("badly formed arguments to generic test");
                 const auto bufferContents = hexToBytes(*arg);
 
-                mStorageBuffers.push_back(vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                                            device.getMemoryProperties(),
-                                                                            bufferContents.size()));
+                mStorageBuffers.push_back(test_utils::createStorageBuffer(device, bufferContents.size()));
                 mArgOrder.push_back(kind_storageBuffer);
 
                 auto bufferMap = mStorageBuffers.back().map<void>();
@@ -83,6 +79,12 @@ namespace generic_kernel {
                 auto bufferMap = mUniformBuffers.back().map<void>();
                 std::memcpy(bufferMap.get(), bufferContents.data(), bufferContents.size());
             }
+            else if (*arg == "-pod") {
+                // set the block of pod arguments
+                arg = std::next(arg);
+                if (arg == args.end()) clspv_utils::fail_runtime_error("badly formed arguments to generic test");
+                mPodArguments = hexToBytes(*arg);
+            }
             else if (*arg == "-las") {
                 // add a local array size argument
                 arg = std::next(arg);
@@ -112,7 +114,7 @@ namespace generic_kernel {
     {
     }
 
-    clspv_utils::execution_time_t Test::run(clspv_utils::kernel& kernel)
+    clspv_utils::invocation Test::createInvocation(clspv_utils::kernel& kernel)
     {
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
@@ -147,7 +149,23 @@ namespace generic_kernel {
             }
         }
 
-        return invocation.run(mNumWorkgroups);
+        if (!mPodArguments.empty()) {
+            invocation.setPodArguments(mPodArguments.data(), mPodArguments.size());
+        }
+
+        return invocation;
+    }
+
+    clspv_utils::execution_time_t Test::run(clspv_utils::kernel& kernel)
+    {
+        return createInvocation(kernel).run(mNumWorkgroups);
+    }
+
+    clspv_utils::invocation Test::recordInvocation(clspv_utils::kernel& kernel)
+    {
+        clspv_utils::invocation invocation = createInvocation(kernel);
+        invocation.record(mNumWorkgroups);
+        return invocation;
     }
 
     std::string Test::getParameterString() const
@@ -191,7 +209,7 @@ namespace generic_kernel {
     {
         mStream << " -ub ";
 
-        auto p = buffer.map<std::uint8_t>();
+        auto p = buffer.map<std::uint8_t>(vulkan_utils::buffer::kMap_read);
         boost::algorithm::hex(p.get(),
                               p.get() + buffer.getSize(),
                               std::ostream_iterator<char>(mStream));
@@ -34,8 +34,12 @@ namespace generic_kernel {
 
         virtual clspv_utils::execution_time_t run(clspv_utils::kernel& kernel) override;
 
+        virtual clspv_utils::invocation recordInvocation(clspv_utils::kernel& kernel) override;
+
         virtual test_utils::Evaluation evaluate(bool verbose) override;
 
+        clspv_utils::invocation createInvocation(clspv_utils::kernel& kernel);
+
         std::string             mParameterString;
 
         // TODO unify storage_list and uniform_list into buffer_list
@@ -43,6 +47,7 @@ namespace generic_kernel {
         storage_list            mStorageBuffers;
         uniform_list            mUniformBuffers;
         local_size_list         mLocalArraySizes;
+        std::vector<std::uint8_t>   mPodArguments;
         std::vector<arg_kind>   mArgOrder;
 
         vk::Extent3D        mNumWorkgroups;
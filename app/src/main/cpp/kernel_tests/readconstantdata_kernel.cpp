@@ -13,25 +13,13 @@ namespace readconstantdata_kernel {
            vulkan_utils::buffer&    dst_buffer,
            int                      width)
     {
-        struct scalar_args {
-            int inWidth;            // offset 0
-        };
-        static_assert(0 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
-
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inWidth = width;
-        scalars.reset();
-
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(width, 1, 1));
 
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addPodArgument<std::int32_t>(width);
 
         return invocation.run(num_workgroups);
     }
@@ -48,9 +36,7 @@ namespace readconstantdata_kernel {
         const std::size_t constant_data_length = 12;
 
         // allocate buffers and images
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
-                                                       buffer_size);
+        mDstBuffer = test_utils::createStorageBuffer(device, buffer_size);
 
         // set up expected results of the destination buffer
         int index = 0;
@@ -85,7 +71,7 @@ namespace readconstantdata_kernel {
 
     test_utils::Evaluation Test::evaluate(bool verbose)
     {
-        auto dstBufferMap = mDstBuffer.map<float>();
+        auto dstBufferMap = mDstBuffer.map<float>(vulkan_utils::buffer::kMap_read);
         return test_utils::check_results(mExpectedResults.data(),
                                          dstBufferMap.get(),
                                          mBufferExtent,
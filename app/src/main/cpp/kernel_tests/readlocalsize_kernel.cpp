@@ -326,34 +326,16 @@ namespace readlocalsize_kernel {
            int                      inHeight,
            int                      inPitch,
            idtype_t                 inIdType) {
-        struct scalar_args {
-            int width;  // offset 0
-            int height; // offset 4
-            int pitch;  // offset 8
-            int idtype; // offset 12
-        };
-        static_assert(0 == offsetof(scalar_args, width), "width offset incorrect");
-        static_assert(4 == offsetof(scalar_args, height), "height offset incorrect");
-        static_assert(8 == offsetof(scalar_args, pitch), "pitch offset incorrect");
-        static_assert(12 == offsetof(scalar_args, idtype), "idtype offset incorrect");
-
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->width = inWidth;
-        scalars->height = inHeight;
-        scalars->pitch = inPitch;
-        scalars->idtype = inIdType;
-        scalars.reset();
-
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(inWidth, inHeight, 1));
 
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
         invocation.addStorageBufferArgument(outLocalSizes);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addPodArgument<std::int32_t>(inWidth);
+        invocation.addPodArgument<std::int32_t>(inHeight);
+        invocation.addPodArgument<std::int32_t>(inPitch);
+        invocation.addPodArgument<std::int32_t>(inIdType);
 
         return invocation.run(num_workgroups);
     }
@@ -372,9 +354,7 @@ namespace readlocalsize_kernel {
         // allocate data buffer
         auto num_elements = mBufferExtent.width * mBufferExtent.height * mBufferExtent.depth;
         const std::size_t buffer_size = num_elements * sizeof(std::int32_t);
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
-                                                       buffer_size);
+        mDstBuffer = test_utils::createStorageBuffer(device, buffer_size);
 
         mExpectedResults = compute_expected_results(mIdType,
                                                         mBufferExtent.width,
@@ -408,7 +388,7 @@ namespace readlocalsize_kernel {
 
     test_utils::Evaluation Test::evaluate(bool verbose)
     {
-        auto dstBufferMap = mDstBuffer.map<std::int32_t>();
+        auto dstBufferMap = mDstBuffer.map<std::int32_t>(vulkan_utils::buffer::kMap_read);
         return test_utils::check_results(mExpectedResults.data(),
                                          dstBufferMap.get(),
                                          mBufferExtent,
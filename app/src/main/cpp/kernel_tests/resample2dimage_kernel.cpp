@@ -62,21 +62,6 @@ namespace resample2dimage_kernel {
             throw std::runtime_error("Depth of extent must be 1");
         }
 
-        struct scalar_args {
-            int inWidth;            // offset 0
-            int inHeight;           // offset 4
-        };
-        static_assert(0 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
-        static_assert(4 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
-
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inWidth = extent.width;
-        scalars->inHeight = extent.height;
-        scalars.reset();
-
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           extent);
 
@@ -84,7 +69,8 @@ namespace resample2dimage_kernel {
 
         invocation.addReadOnlyImageArgument(src_image);
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addPodArgument<std::int32_t>(extent.width);
+        invocation.addPodArgument<std::int32_t>(extent.height);
 
         return invocation.run(num_workgroups);
     }
@@ -107,22 +93,16 @@ namespace resample2dimage_kernel {
         const std::size_t buffer_size = buffer_length * sizeof(BufferPixelType);
 
         // allocate buffers and images
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
-                                                       buffer_size);
+        mDstBuffer = test_utils::createStorageBuffer(device, buffer_size);
         mSrcImage = vulkan_utils::image(device.getDevice(),
                                      device.getMemoryProperties(),
                                      vk::Extent3D(image_width, image_height, 1),
                                      vk::Format(pixels::traits<ImagePixelType>::vk_pixel_type),
                                      vulkan_utils::image::kUsage_ReadOnly);
-        mSrcImageStaging = vulkan_utils::createStagingBuffer(device.getDevice(),
-                                                             device.getMemoryProperties(),
-                                                             mSrcImage,
-                                                             true,
-                                                             false);
+        mSrcImageStaging = device.getStagingPool()->acquire(mSrcImage);
 
         // initialize source memory with random data
-        auto srcImageMap = mSrcImageStaging.map<ImagePixelType>();
+        auto srcImageMap = mSrcImageStaging->map<ImagePixelType>();
         std::copy(std::begin(image_buffer_data), std::end(image_buffer_data), srcImageMap.get());
         srcImageMap.reset();
 
@@ -146,17 +126,9 @@ namespace resample2dimage_kernel {
         }
 
         // complete setup of the image
-        mSetupCommand = vulkan_utils::allocate_command_buffer(device.getDevice(), device.getCommandPool());
-        mSetupCommand->begin(vk::CommandBufferBeginInfo());
-        vulkan_utils::copyBufferToImage(*mSetupCommand, mSrcImageStaging, mSrcImage);
-        mSetupCommand->end();
-
-        vk::CommandBuffer rawCommand = *mSetupCommand;
-        vk::SubmitInfo submitInfo;
-        submitInfo.setCommandBufferCount(1)
-                .setPCommandBuffers(&rawCommand);
-
-        device.getComputeQueue().submit(submitInfo, nullptr);
+        mSetup = clspv_utils::transfer_batch(device);
+        mSetup.addUpload(*mSrcImageStaging, mSrcImage);
+        mSetupComplete = mSetup.submitAsync();
     }
 
     void Test::prepare()
@@ -178,7 +150,7 @@ namespace resample2dimage_kernel {
 
     test_utils::Evaluation Test::evaluate(bool verbose)
     {
-        auto dstBufferMap = mDstBuffer.map<BufferPixelType>();
+        auto dstBufferMap = mDstBuffer.map<BufferPixelType>(vulkan_utils::buffer::kMap_read);
         return test_utils::check_results(mExpectedDstBuffer.data(),
                                          dstBufferMap.get(),
                                          mBufferExtent,
@@ -28,24 +28,6 @@ namespace resample3dimage_kernel {
            int                      height,
            int                      depth)
     {
-        struct scalar_args {
-            int inWidth;            // offset 0
-            int inHeight;           // offset 4
-            int inDepth;            // offset 8
-        };
-        static_assert(0 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
-        static_assert(4 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
-        static_assert(8 == offsetof(scalar_args, inDepth), "inDepth offset incorrect");
-
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inWidth = width;
-        scalars->inHeight = height;
-        scalars->inDepth = depth;
-        scalars.reset();
-
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           vk::Extent3D(width, height, depth));
 
@@ -53,7 +35,9 @@ namespace resample3dimage_kernel {
 
         invocation.addReadOnlyImageArgument(src_image);
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addPodArgument<std::int32_t>(width);
+        invocation.addPodArgument<std::int32_t>(height);
+        invocation.addPodArgument<std::int32_t>(depth);
 
         return invocation.run(num_workgroups);
     }
@@ -83,38 +67,23 @@ namespace resample3dimage_kernel {
         };
 
         // allocate buffers and images
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
-                                                       buffer_size);
+        mDstBuffer = test_utils::createStorageBuffer(device, buffer_size);
         mSrcImage = vulkan_utils::image(device.getDevice(),
                                      device.getMemoryProperties(),
                                      imageExtent,
                                      vk::Format(pixels::traits<ImagePixelType>::vk_pixel_type),
                                      vulkan_utils::image::kUsage_ReadOnly);
-        mSrcImageStaging = vulkan_utils::createStagingBuffer(device.getDevice(),
-                                                             device.getMemoryProperties(),
-                                                             mSrcImage,
-                                                             true,
-                                                             false);
+        mSrcImageStaging = device.getStagingPool()->acquire(mSrcImage);
 
         // initialize source memory with random data
-        auto srcImageMap = mSrcImageStaging.map<ImagePixelType>();
+        auto srcImageMap = mSrcImageStaging->map<ImagePixelType>();
         std::copy(std::begin(image_buffer_data), std::end(image_buffer_data), srcImageMap.get());
         srcImageMap.reset();
 
         // complete setup of the image
-        mSetupCommand = vulkan_utils::allocate_command_buffer(device.getDevice(),
-                                                                                     device.getCommandPool());
-        mSetupCommand->begin(vk::CommandBufferBeginInfo());
-        vulkan_utils::copyBufferToImage(*mSetupCommand, mSrcImageStaging, mSrcImage);
-        mSetupCommand->end();
-
-        vk::CommandBuffer rawCommand = *mSetupCommand;
-        vk::SubmitInfo submitInfo;
-        submitInfo.setCommandBufferCount(1)
-                .setPCommandBuffers(&rawCommand);
-
-        device.getComputeQueue().submit(submitInfo, nullptr);
+        mSetup = clspv_utils::transfer_batch(device);
+        mSetup.addUpload(*mSrcImageStaging, mSrcImage);
+        mSetupComplete = mSetup.submitAsync();
 
         // compute expected results
         mExpectedDstBuffer.resize(buffer_length);
@@ -162,7 +131,7 @@ namespace resample3dimage_kernel {
 
     test_utils::Evaluation Test::evaluate(bool verbose)
     {
-        auto dstBufferMap = mDstBuffer.map<BufferPixelType>();
+        auto dstBufferMap = mDstBuffer.map<BufferPixelType>(vulkan_utils::buffer::kMap_read);
         return test_utils::check_results(mExpectedDstBuffer.data(),
                                          dstBufferMap.get(),
                                          mBufferExtent,
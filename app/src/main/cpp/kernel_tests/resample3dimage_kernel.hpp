@@ -6,7 +6,10 @@
 #define CLSPVTEST_RESAMPLE3DIMAGE_KERNEL_HPP
 
 #include "clspv_utils/clspv_utils_fwd.hpp"
+#include "clspv_utils/completion.hpp"
+#include "clspv_utils/transfer_batch.hpp"
 #include "test_utils.hpp"
+#include "vulkan_utils/staging_pool.hpp"
 #include "vulkan_utils/vulkan_utils.hpp"
 
 #include <vector>
@@ -35,12 +38,13 @@ namespace resample3dimage_kernel {
 
         virtual test_utils::Evaluation evaluate(bool verbose) override;
 
-        vk::Extent3D                    mBufferExtent;
-        vulkan_utils::image             mSrcImage;
-        vulkan_utils::buffer            mSrcImageStaging;
-        vulkan_utils::buffer            mDstBuffer;
-        std::vector<BufferPixelType>    mExpectedDstBuffer;
-        vk::UniqueCommandBuffer         mSetupCommand;
+        vk::Extent3D                              mBufferExtent;
+        vulkan_utils::image                       mSrcImage;
+        vulkan_utils::staging_pool::pooled_buffer mSrcImageStaging;
+        vulkan_utils::buffer                      mDstBuffer;
+        std::vector<BufferPixelType>              mExpectedDstBuffer;
+        clspv_utils::transfer_batch               mSetup;
+        clspv_utils::completion                   mSetupComplete;
     };
 
     test_utils::KernelTest::invocation_tests getAllTestVariants();
@@ -25,8 +25,8 @@ namespace strangeshuffle_kernel {
 
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
-        invocation.addStorageBufferArgument(index_buffer);
-        invocation.addStorageBufferArgument(source_buffer);
+        invocation.addReadOnlyStorageBufferArgument(index_buffer);
+        invocation.addReadOnlyStorageBufferArgument(source_buffer);
         invocation.addStorageBufferArgument(destination_buffer);
         invocation.addLocalArraySizeArgument(2 * workgroup_sizes.width);
         return invocation.run(num_workgroups);
@@ -39,18 +39,12 @@ namespace strangeshuffle_kernel {
 
         // allocate source and destination buffers
         const std::size_t pixel_buffer_size = mBufferWidth * sizeof(gpu_types::float4);
-        mSrcBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
-                                                       pixel_buffer_size);
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
-                                                       pixel_buffer_size);
+        mSrcBuffer = test_utils::createStorageBuffer(device, pixel_buffer_size);
+        mDstBuffer = test_utils::createStorageBuffer(device, pixel_buffer_size);
 
         // allocate index buffer
         const std::size_t index_buffer_size = mBufferWidth * sizeof(int32_t);
-        mIndexBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                         device.getMemoryProperties(),
-                                                         index_buffer_size);
+        mIndexBuffer = test_utils::createStorageBuffer(device, index_buffer_size);
 
         auto srcBufferMap = mSrcBuffer.map<gpu_types::float4>();
         test_utils::fill_random_pixels<gpu_types::float4>(srcBufferMap.get(), srcBufferMap.get() + mBufferWidth);
@@ -76,8 +70,8 @@ namespace strangeshuffle_kernel {
 
     test_utils::Evaluation Test::evaluate(bool verbose)
     {
-        auto srcBufferMap = mSrcBuffer.map<gpu_types::float4>();
-        auto dstBufferMap = mDstBuffer.map<gpu_types::float4>();
+        auto srcBufferMap = mSrcBuffer.map<gpu_types::float4>(vulkan_utils::buffer::kMap_read);
+        auto dstBufferMap = mDstBuffer.map<gpu_types::float4>(vulkan_utils::buffer::kMap_read);
         return test_utils::check_results(srcBufferMap.get(),
                                          dstBufferMap.get(),
                                          vk::Extent3D(mBufferWidth, 1, 1),
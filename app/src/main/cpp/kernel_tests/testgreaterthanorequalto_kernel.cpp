@@ -18,28 +18,14 @@ namespace testgreaterthanorequalto_kernel {
             throw std::runtime_error("Depth must be 1");
         }
 
-        struct scalar_args {
-            int inWidth;            // offset 0
-            int inHeight;           // offset 4
-        };
-        static_assert(0 == offsetof(scalar_args, inWidth), "inWidth offset incorrect");
-        static_assert(4 == offsetof(scalar_args, inHeight), "inHeight offset incorrect");
-
-        vulkan_utils::buffer scalarBuffer = vulkan_utils::createUniformBuffer(kernel.getDevice().getDevice(),
-                                                                              kernel.getDevice().getMemoryProperties(),
-                                                                              sizeof(scalar_args));
-        auto scalars = scalarBuffer.map<scalar_args>();
-        scalars->inWidth = extent.width;
-        scalars->inHeight = extent.height;
-        scalars.reset();
-
         const auto num_workgroups = vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
                                                                           extent);
 
         clspv_utils::invocation invocation(kernel.createInvocationReq());
 
         invocation.addStorageBufferArgument(dst_buffer);
-        invocation.addUniformBufferArgument(scalarBuffer);
+        invocation.addPodArgument<std::int32_t>(extent.width);
+        invocation.addPodArgument<std::int32_t>(extent.height);
 
         return invocation.run(num_workgroups);
     }
@@ -53,9 +39,7 @@ namespace testgreaterthanorequalto_kernel {
         const std::size_t buffer_size = buffer_length * sizeof(float);
 
         // allocate buffers and images
-        mDstBuffer = vulkan_utils::createStorageBuffer(device.getDevice(),
-                                                       device.getMemoryProperties(),
-                                                       buffer_size);
+        mDstBuffer = test_utils::createStorageBuffer(device, buffer_size);
 
         // set up expected results of the destination buffer
         int index = 0;
@@ -90,7 +74,7 @@ namespace testgreaterthanorequalto_kernel {
 
     test_utils::Evaluation Test::evaluate(bool verbose)
     {
-        auto dstBufferMap = mDstBuffer.map<float>();
+        auto dstBufferMap = mDstBuffer.map<float>(vulkan_utils::buffer::kMap_read);
         return test_utils::check_results(mExpectedResults.data(), dstBufferMap.get(),
                                          mBufferExtent,
                                          mBufferExtent.width,
@@ -0,0 +1,167 @@
+//
+// Created on 10/18/26.
+//
+
+#include "task_graph_test.hpp"
+
+#include "clspv_utils/invocation.hpp"
+#include "clspv_utils/kernel.hpp"
+#include "clspv_utils/module.hpp"
+#include "clspv_utils/task_graph.hpp"
+#include "test_utils.hpp"
+#include "util.hpp"
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+    const std::size_t   kNumWords       = 256 * 1024;
+    const unsigned int  kNumRuns        = 2;
+
+    // The dispatch copies the buffer as a 2D array of float4 pixels
+    const char* const   kModuleName     = "shaders_cl/Memory";
+    const char* const   kEntryPoint     = "CopyBufferToBufferKernel";
+    const std::int32_t  kPixelsPerRow   = 256;
+    const std::int32_t  kNumRows        = kNumWords / 4 / kPixelsPerRow;
+    const vk::Extent3D  kWorkgroupSize(8, 8, 1);
+
+    enum buffer_name {
+        kBuffer_source,
+        kBuffer_top,
+        kBuffer_left,
+        kBuffer_right,
+        kBuffer_bottom,
+        kBuffer_dispatched,
+        kBuffer_transfer,
+        kBuffer_final,
+
+        kBuffer_count
+    };
+
+    // Every word is a normal float, so that the dispatch copies it exactly
+    std::uint32_t getPatternWord(std::size_t i)
+    {
+        return (static_cast<std::uint32_t>(i * 2654435761u) & 0x807fffffu) | 0x3f800000u;
+    }
+
+    void fillBuffer(vulkan_utils::buffer& b, bool isSource)
+    {
+        auto bufferMap = b.map<std::uint32_t>(vulkan_utils::buffer::kMap_write);
+        for (std::size_t i = 0; i < kNumWords; ++i) {
+            bufferMap.get()[i] = (isSource ? getPatternWord(i) : 0);
+        }
+    }
+
+    bool checkBuffer(vulkan_utils::buffer& b)
+    {
+        auto bufferMap = b.map<std::uint32_t>(vulkan_utils::buffer::kMap_read);
+        for (std::size_t i = 0; i < kNumWords; ++i) {
+            if (getPatternWord(i) != bufferMap.get()[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+namespace task_graph_test {
+
+    void runAllTests(const clspv_utils::device& device)
+    {
+        const auto queueFamilies = device.getQueueFamilyIndices();
+
+        vulkan_utils::buffer buffers[kBuffer_count];
+        for (auto& b : buffers) {
+            b = vulkan_utils::buffer(device.getDevice(),
+                                     device.getMemoryProperties(),
+                                     kNumWords * sizeof(std::uint32_t),
+                                     vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+                                     vulkan_utils::kPlacement_hostVisible,
+                                     vulkan_utils::transfer_fn(),
+                                     queueFamilies);
+        }
+
+        bool success = true;
+        std::size_t numNodes = 0;
+        std::size_t submissionCount = 0;
+        try {
+            clspv_utils::module module = test_utils::loadModule(device, kModuleName);
+            clspv_utils::kernel kernel(module.createKernelReq(kEntryPoint), kWorkgroupSize);
+
+            clspv_utils::invocation dispatch(kernel.createInvocationReq());
+            dispatch.addReadOnlyStorageBufferArgument(buffers[kBuffer_bottom]);
+            dispatch.addStorageBufferArgument(buffers[kBuffer_dispatched]);
+            dispatch.addPodArgument<std::int32_t>(kPixelsPerRow);    // source pitch
+            dispatch.addPodArgument<std::int32_t>(0);                // source offset
+            dispatch.addPodArgument<std::int32_t>(kPixelsPerRow);    // destination pitch
+            dispatch.addPodArgument<std::int32_t>(0);                // destination offset
+            dispatch.addPodArgument<std::int32_t>(1);                // 32 bit components
+            dispatch.addPodArgument<std::int32_t>(kPixelsPerRow);
+            dispatch.addPodArgument<std::int32_t>(kNumRows);
+
+            // The left and right copies both depend on the top one, through its destination, and
+            // are independent of each other. The bottom copy depends on the left one through its
+            // source, and on the right one explicitly.
+            clspv_utils::task_graph graph(device);
+            graph.addCopy(buffers[kBuffer_source], buffers[kBuffer_top], clspv_utils::device::kQueue_compute);
+            graph.addCopy(buffers[kBuffer_top], buffers[kBuffer_left], clspv_utils::device::kQueue_compute);
+            const auto right = graph.addCopy(buffers[kBuffer_top], buffers[kBuffer_right], clspv_utils::device::kQueue_compute);
+            const auto bottom = graph.addCopy(buffers[kBuffer_left], buffers[kBuffer_bottom], clspv_utils::device::kQueue_compute);
+            graph.addDependency(right, bottom);
+
+            // A kernel copies the bottom buffer, depending on the bottom copy through the
+            // invocation's barriers
+            graph.addDispatch(dispatch,
+                              vulkan_utils::computeNumberWorkgroups(kernel.getWorkgroupSize(),
+                                                                    vk::Extent3D(kPixelsPerRow, kNumRows, 1)));
+
+            // Then across to the transfer queue and back, which is a semaphore each way if the
+            // device has a transfer queue of its own
+            graph.addCopy(buffers[kBuffer_dispatched], buffers[kBuffer_transfer], clspv_utils::device::kQueue_transfer);
+            graph.addCopy(buffers[kBuffer_transfer], buffers[kBuffer_final], clspv_utils::device::kQueue_compute);
+
+            // Run the graph more than once, to check that its events and semaphores are reusable
+            for (unsigned int run = 0; run < kNumRuns; ++run) {
+                for (int i = 0; i < kBuffer_count; ++i) {
+                    fillBuffer(buffers[i], kBuffer_source == i);
+                }
+
+                graph.run();
+
+                for (auto& b : buffers) {
+                    success = checkBuffer(b) && success;
+                }
+            }
+
+            numNodes = graph.size();
+            submissionCount = graph.getSubmissionCount();
+        }
+        catch (const std::exception& e) {
+            LOGE("task-graph: %s", e.what());
+            success = false;
+        }
+
+        std::ostringstream os;
+        os << "task-graph"
+           << " nodes:" << numNodes
+           << " submissions:" << submissionCount
+           << " dedicatedTransferQueue:" << (device.hasDedicatedQueue(clspv_utils::device::kQueue_transfer) ? "yes" : "no")
+           << " runs:" << kNumRuns
+           << " result:" << (success ? "pass" : "fail");
+
+        if (success) {
+            LOGI("%s", os.str().c_str());
+        }
+        else {
+            LOGE("%s", os.str().c_str());
+        }
+    }
+}
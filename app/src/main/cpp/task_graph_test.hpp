@@ -0,0 +1,19 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVTEST_TASK_GRAPH_TEST_HPP
+#define CLSPVTEST_TASK_GRAPH_TEST_HPP
+
+#include "clspv_utils/device.hpp"
+
+namespace task_graph_test {
+
+    // Run a small graph of buffer copies: a diamond on the compute queue, then a kernel dispatch
+    // copying the diamond's result, followed by a copy on the transfer queue and another back on
+    // the compute queue. Check that every buffer in the graph received the source's contents, and
+    // log the result.
+    void runAllTests(const clspv_utils::device& device);
+}
+
+#endif //CLSPVTEST_TASK_GRAPH_TEST_HPP
@@ -148,6 +148,34 @@ namespace
         return result;
     }
 
+    vulkan_utils::memory_placement read_placement_op(std::istream& is)
+    {
+        vulkan_utils::memory_placement result = vulkan_utils::kPlacement_hostCached;
+
+        // set placement of the storage buffers created by tests
+        std::string placement;
+        is >> placement;
+
+        if (placement == "hostCached")
+        {
+            result = vulkan_utils::kPlacement_hostCached;
+        }
+        else if (placement == "hostVisible")
+        {
+            result = vulkan_utils::kPlacement_hostVisible;
+        }
+        else if (placement == "deviceLocal")
+        {
+            result = vulkan_utils::kPlacement_deviceLocal;
+        }
+        else
+        {
+            throw std::runtime_error("unrecognized placement value");
+        }
+
+        return result;
+    }
+
     test_utils::KernelTest::test_arguments read_test_args(std::istream& is)
     {
         test_utils::KernelTest::test_arguments result;
@@ -186,10 +214,30 @@ namespace
         }
     }
 
+    // A workgroup size may be preceded by the word tuned, in which case the size found by
+    // tuning the entry point is used if it has been tuned, and the listed size otherwise
+    void read_tuned_flag(std::istream& is, test_utils::KernelTest& testEntry)
+    {
+        const auto start = is.tellg();
+
+        std::string word;
+        is >> word;
+        if (word == "tuned")
+        {
+            testEntry.mUseTunedWorkgroupSize = true;
+        }
+        else
+        {
+            is.clear();
+            is.seekg(start);
+        }
+    }
+
     void read_test_op(std::istream&         is,
                       const std::string&    op,
                       manifest_t&           manifest,
-                      bool                  verbose)
+                      bool                  verbose,
+                      vulkan_utils::memory_placement placement)
     {
         if (manifest.tests.empty())
         {
@@ -198,11 +246,13 @@ namespace
 
         test_utils::KernelTest testEntry;
         testEntry.mIsVerbose = verbose;
+        testEntry.mBufferPlacement = placement;
 
         std::string testName;
         is >> testEntry.mEntryName
-           >> testName
-           >> testEntry.mWorkgroupSize.width
+           >> testName;
+        read_tuned_flag(is, testEntry);
+        is >> testEntry.mWorkgroupSize.width
            >> testEntry.mWorkgroupSize.height;
         if (op == "test3d")
         {
@@ -224,7 +274,8 @@ namespace
     void read_time_op(std::istream&         is,
                       const std::string&    op,
                       manifest_t&           manifest,
-                      bool                  verbose)
+                      bool                  verbose,
+                      vulkan_utils::memory_placement placement)
     {
         if (manifest.tests.empty())
         {
@@ -233,12 +284,14 @@ namespace
 
         test_utils::KernelTest testEntry;
         testEntry.mIsVerbose = verbose;
+        testEntry.mBufferPlacement = placement;
 
         std::string testName;
         is >> testEntry.mEntryName
            >> testName
-           >> testEntry.mTimingIterations
-           >> testEntry.mWorkgroupSize.width
+           >> testEntry.mTimingIterations;
+        read_tuned_flag(is, testEntry);
+        is >> testEntry.mWorkgroupSize.width
            >> testEntry.mWorkgroupSize.height
            >> testEntry.mWorkgroupSize.depth;
 
@@ -254,6 +307,45 @@ namespace
         manifest.tests.back().mKernelTests.push_back(testEntry);
     }
 
+    void read_tune_op(std::istream&         is,
+                      manifest_t&           manifest,
+                      bool                  verbose,
+                      vulkan_utils::memory_placement placement)
+    {
+        if (manifest.tests.empty())
+        {
+            throw std::runtime_error("no module for test");
+        }
+
+        test_utils::KernelTest testEntry;
+        testEntry.mIsVerbose = verbose;
+        testEntry.mBufferPlacement = placement;
+
+        // the workgroup size is chosen by tuning, so any valid size will pass validation
+        testEntry.mWorkgroupSize = vk::Extent3D(1, 1, 1);
+
+        std::string testName;
+        is >> testEntry.mEntryName
+           >> testName
+           >> testEntry.mTimingIterations
+           >> testEntry.mTuneDimensions;
+
+        testEntry.mArguments = read_test_args(is);
+        testEntry.mInvocationTests = lookup_test_series(testName);
+
+        validate_kernel_test(testEntry, testName);
+        if (0 >= testEntry.mTimingIterations)
+        {
+            throw std::runtime_error("illegal iteration count requested");
+        }
+        if (1 > testEntry.mTuneDimensions || 3 < testEntry.mTuneDimensions)
+        {
+            throw std::runtime_error("illegal number of dimensions to tune");
+        }
+
+        manifest.tests.back().mKernelTests.push_back(testEntry);
+    }
+
     void ensure_all_entries_tested(test_utils::ModuleTest& moduleTest)
     {
         android_utils::iassetstream spvmapStream(moduleTest.mName + ".spvmap");
@@ -318,6 +410,7 @@ namespace test_manifest
         manifest_t result;
         unsigned int iterations = 1;
         bool verbose = false;
+        vulkan_utils::memory_placement placement = vulkan_utils::kPlacement_hostCached;
 
         while (!in.eof())
         {
@@ -340,11 +433,15 @@ namespace test_manifest
                 }
                 else if (op == "test" || op == "test2d" || op == "test3d")
                 {
-                    read_test_op(in_line, op, result, verbose);
+                    read_test_op(in_line, op, result, verbose, placement);
                 }
                 else if (op == "time")
                 {
-                    read_time_op(in_line, op, result, verbose);
+                    read_time_op(in_line, op, result, verbose, placement);
+                }
+                else if (op == "tune")
+                {
+                    read_tune_op(in_line, result, verbose, placement);
                 }
                 else if (op == "skip")
                 {
@@ -358,6 +455,10 @@ namespace test_manifest
                 {
                     verbose = read_verbosity_op(in_line);
                 }
+                else if (op == "placement")
+                {
+                    placement = read_placement_op(in_line);
+                }
                 else if (op == "end")
                 {
                     // terminate reading the manifest
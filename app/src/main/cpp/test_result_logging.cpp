@@ -6,6 +6,7 @@
 
 #include "test_utils.hpp"
 #include "util.hpp"
+#include "clspv_utils/device.hpp"
 #include "vulkan_utils/vulkan_utils.hpp"
 
 #include <vulkan/vulkan.hpp>
@@ -16,6 +17,7 @@
 #include <boost/units/systems/si/prefixes.hpp>
 
 #include <algorithm>
+#include <cstring>
 #include <sstream>
 #include <utility>
 
@@ -81,6 +83,10 @@ namespace {
         std::vector<InvocationSummary>  mInvocationSummaries;
         const std::string*              mExceptionMessage   = nullptr;
 
+        vk::DeviceSize                  mPeakMemoryBytes    = 0;
+        std::uint32_t                   mPeakAllocationCount = 0;
+        const std::vector<vk::DeviceSize>*  mPeakMemoryBytesByType = nullptr;
+
         unsigned int                    mTimingIterations   = 0;
         execution_times                 mMeanTimes;
         execution_times                 mStdDeviationTimes;
@@ -221,6 +227,10 @@ namespace {
 
         if (!kr.second.mExceptionString.empty()) result.mExceptionMessage = &kr.second.mExceptionString;
 
+        result.mPeakMemoryBytes = kr.second.mPeakMemoryBytes;
+        result.mPeakAllocationCount = kr.second.mPeakAllocationCount;
+        result.mPeakMemoryBytesByType = &kr.second.mPeakMemoryBytesByType;
+
         result.mInvocationSummaries.reserve(kr.second.mInvocationResults.size());
         std::transform(kr.second.mInvocationResults.begin(), kr.second.mInvocationResults.end(),
                        std::back_inserter(result.mInvocationSummaries),
@@ -321,6 +331,19 @@ namespace {
             logInfo(os.str(), indent + 1);
         }
 
+        if (summary.mPeakAllocationCount > 0) {
+            std::ostringstream os;
+            os << "peakMemoryBytes:" << summary.mPeakMemoryBytes
+               << " peakAllocations:" << summary.mPeakAllocationCount;
+            for (std::size_t i = 0; i < summary.mPeakMemoryBytesByType->size(); ++i) {
+                const auto typeBytes = (*summary.mPeakMemoryBytesByType)[i];
+                if (typeBytes > 0) {
+                    os << " memoryType" << i << ":" << typeBytes;
+                }
+            }
+            logInfo(os.str(), indent + 1);
+        }
+
         if (0 == summary.mTimingIterations) {
             std::for_each(summary.mInvocationSummaries.begin(), summary.mInvocationSummaries.end(),
                           std::bind(logInvocationSummary, std::placeholders::_1, indent + 1));
@@ -380,6 +403,23 @@ namespace {
                       std::bind(logKernelSummary, std::placeholders::_1, indent + 1));
     }
 
+    bool isDeviceExtensionEnabled(const sample_info &info, const char* name) {
+        return std::any_of(info.device_extension_names.begin(), info.device_extension_names.end(), [name](const char* enabled) {
+            return 0 == std::strcmp(enabled, name);
+        });
+    }
+
+    std::string composeUsage(const vulkan_utils::memory_allocator::usage& u) {
+        std::ostringstream os;
+        os << "allocatedBytes:" << u.mAllocatedBytes
+           << " peakAllocatedBytes:" << u.mPeakAllocatedBytes
+           << " allocations:" << u.mAllocationCount
+           << " peakAllocations:" << u.mPeakAllocationCount
+           << " blockBytes:" << u.mBlockBytes
+           << " peakBlockBytes:" << u.mPeakBlockBytes;
+        return os.str();
+    }
+
     void logManifestSummary(const ManifestSummary& summary, unsigned int indent = 0) {
         auto longestName = std::max_element(summary.mModuleSummaries.begin(), summary.mModuleSummaries.end(),
                                             [](const ModuleSummary& lhs, const ModuleSummary& rhs) {
@@ -454,4 +494,43 @@ namespace test_result_logging {
         logManifestSummary(summary);
     }
 
+    void logMemoryUsage(const sample_info &info, const clspv_utils::device &device) {
+        const auto allocator = device.getMemoryAllocator();
+        const auto report = allocator->getUsage();
+
+        logInfo("MemoryUsage {", 0);
+        logInfo("total " + composeUsage(report.mTotal), 1);
+        logInfo("buffers " + composeUsage(report.mKinds[vulkan_utils::memory_allocator::kResource_linear]), 1);
+        logInfo("images " + composeUsage(report.mKinds[vulkan_utils::memory_allocator::kResource_optimal]), 1);
+        for (std::size_t i = 0; i < report.mMemoryTypes.size(); ++i) {
+            std::ostringstream os;
+            os << "memoryType" << i << " " << composeUsage(report.mMemoryTypes[i]);
+            logInfo(os.str(), 1);
+        }
+        {
+            std::ostringstream os;
+            os << "stagingPoolIdleBytes:" << device.getStagingPool()->getIdleBytes();
+            logInfo(os.str(), 1);
+        }
+
+        // The budget covers every process using the device, not just the memory counted above
+        auto getMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR) info.inst->getProcAddr("vkGetPhysicalDeviceMemoryProperties2KHR");
+        if (getMemoryProperties2 && isDeviceExtensionEnabled(info, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+            vk::PhysicalDeviceMemoryBudgetPropertiesEXT budget;
+            vk::PhysicalDeviceMemoryProperties2 properties;
+            properties.pNext = &budget;
+            getMemoryProperties2(info.gpu, reinterpret_cast<VkPhysicalDeviceMemoryProperties2*>(&properties));
+
+            for (std::uint32_t i = 0; i < properties.memoryProperties.memoryHeapCount; ++i) {
+                std::ostringstream os;
+                os << "memoryHeap" << i
+                   << " heapBudget:" << budget.heapBudget[i]
+                   << " heapUsage:" << budget.heapUsage[i];
+                logInfo(os.str(), 1);
+            }
+        }
+
+        logInfo("}", 0);
+    }
+
 }
\ No newline at end of file
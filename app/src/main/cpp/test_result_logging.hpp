@@ -8,6 +8,8 @@
 #include "test_manifest.hpp"
 #include "test_utils.hpp"
 
+#include "clspv_utils/clspv_utils_fwd.hpp"
+
 struct sample_info;
 
 namespace test_result_logging {
@@ -20,6 +22,10 @@ namespace test_result_logging {
     void logResults(const sample_info &info, const test_utils::ModuleTest::result &mr);
 
     void logResults(const sample_info &info, const test_manifest::results &manifestResults);
+
+    // Log the device memory held through the device, by memory type, and the budget of each heap
+    // if VK_EXT_memory_budget is enabled
+    void logMemoryUsage(const sample_info &info, const clspv_utils::device &device);
 }
 
 #endif //CLSPVTEST_TEST_RESULT_LOGGING_HPP
@@ -4,16 +4,56 @@
 
 #include "test_utils.hpp"
 
+#include "clspv_utils/completion.hpp"
 #include "clspv_utils/interface.hpp"
 #include "clspv_utils/kernel.hpp"
 #include "clspv_utils/module.hpp"
 
 #include "crlf_savvy.hpp"
 #include "util.hpp"
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <algorithm>
+#include <limits>
 
 namespace {
     using namespace test_utils;
 
+    vulkan_utils::memory_placement current_buffer_placement = vulkan_utils::kPlacement_hostCached;
+
+    // Note a placement other than the default in the parameters of the results, so that timings
+    // of a test in each placement can be told apart
+    void annotate_buffer_placement(InvocationResult& result, vulkan_utils::memory_placement placement) {
+        switch (placement) {
+            case vulkan_utils::kPlacement_hostVisible:
+                result.mParameters += " bufferPlacement:hostVisible";
+                break;
+            case vulkan_utils::kPlacement_deviceLocal:
+                result.mParameters += " bufferPlacement:deviceLocal";
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Run a kernel test, recording the device memory it holds at its peak
+    template <typename Fn>
+    KernelTest::result measure_peak_memory(vulkan_utils::memory_allocator& allocator, Fn testFn) {
+        allocator.resetPeakUsage();
+        const auto before = allocator.getUsage();
+
+        KernelTest::result result = testFn();
+
+        const auto after = allocator.getUsage();
+        result.second.mPeakMemoryBytes = after.mTotal.mPeakAllocatedBytes - before.mTotal.mAllocatedBytes;
+        result.second.mPeakAllocationCount = after.mTotal.mPeakAllocationCount - before.mTotal.mAllocationCount;
+        for (std::size_t i = 0; i < after.mMemoryTypes.size(); ++i) {
+            result.second.mPeakMemoryBytesByType.push_back(after.mMemoryTypes[i].mPeakAllocatedBytes - before.mMemoryTypes[i].mAllocatedBytes);
+        }
+
+        return result;
+    }
+
     std::string current_exception_to_string() {
         std::string result;
 
@@ -51,6 +91,32 @@ namespace {
         return result;
     }
 
+    // Return the median execution time of the timing results, in nanoseconds
+    double median_execution_ns(const std::vector<InvocationResult>& results, float timestampPeriod) {
+        std::vector<double> times;
+        for (auto& r : results) {
+            const auto& timestamps = r.mExecutionTime.timestamps;
+            // skip the rare sample in which the timestamp counter wrapped
+            if (timestamps.execution >= timestamps.host_barrier) {
+                times.push_back((timestamps.execution - timestamps.host_barrier) * timestampPeriod);
+            }
+        }
+
+        if (times.empty()) {
+            throw std::runtime_error("no execution times were measured");
+        }
+
+        auto median = times.begin() + times.size() / 2;
+        std::nth_element(times.begin(), median, times.end());
+        return *median;
+    }
+
+    std::string workgroup_size_to_string(const vk::Extent3D& workgroupSize) {
+        std::ostringstream os;
+        os << workgroupSize.width << 'x' << workgroupSize.height << 'x' << workgroupSize.depth;
+        return os.str();
+    }
+
     InvocationResult failTestFn(clspv_utils::kernel &kernel,
                                 const std::vector<std::string> &args,
                                 bool verbose) {
@@ -62,20 +128,91 @@ namespace {
 
 namespace test_utils {
 
+    vulkan_utils::memory_placement getBufferPlacement() {
+        return current_buffer_placement;
+    }
+
+    void setBufferPlacement(vulkan_utils::memory_placement placement) {
+        current_buffer_placement = placement;
+    }
+
+    vulkan_utils::buffer createStorageBuffer(const clspv_utils::device& device, vk::DeviceSize num_bytes) {
+        return vulkan_utils::createStorageBuffer(device.getDevice(),
+                                                 device.getMemoryProperties(),
+                                                 num_bytes,
+                                                 getBufferPlacement(),
+                                                 clspv_utils::createTransferFn(device));
+    }
+
+    vulkan_utils::chunked_buffer createChunkedStorageBuffer(const clspv_utils::device& device,
+                                                            std::uint32_t              numRows,
+                                                            vk::DeviceSize             rowBytes,
+                                                            vk::DeviceSize             maxBufferBytes,
+                                                            vk::DeviceSize             maxChunkBytes) {
+        return vulkan_utils::chunked_buffer(device.getDevice(),
+                                            device.getMemoryProperties(),
+                                            device.getPhysicalDevice().getProperties().limits,
+                                            numRows,
+                                            rowBytes,
+                                            vk::BufferUsageFlagBits::eStorageBuffer,
+                                            getBufferPlacement(),
+                                            clspv_utils::createTransferFn(device),
+                                            maxBufferBytes,
+                                            maxChunkBytes);
+    }
+
+    clspv_utils::module loadModule(const clspv_utils::device& device, const std::string& moduleName) {
+        android_utils::iassetstream spvmapStream(moduleName + ".spvmap");
+        if (!spvmapStream.good())
+        {
+            throw std::runtime_error("cannot open spvmap for " + moduleName);
+        }
+
+        // spvmap files may have been generated on a system which uses different line ending
+        // conventions than the system on which the consumer runs. Safer to fetch lines
+        // using a function which recognizes multiple line endings.
+        crlf_savvy::crlf_filter_buffer filter(spvmapStream.rdbuf());
+        spvmapStream.rdbuf(&filter);
+
+        clspv_utils::module_spec_t moduleInterface = clspv_utils::createModuleSpec(spvmapStream);
+        spvmapStream.close();
+
+        android_utils::iassetstream spvStream(moduleName + ".spv");
+        if (!spvStream.good())
+        {
+            throw std::runtime_error("cannot open spv for " + moduleName);
+        }
+
+        return clspv_utils::module(spvStream, device, moduleInterface);
+    }
+
     KernelTest::result test_kernel(clspv_utils::module& module,
-                                   const KernelTest&    kernelTest) {
+                                   const KernelTest&    kernelTest,
+                                   clspv_utils::kernel* prebuiltKernel) {
         KernelTest::result result;
         result.first = &kernelTest;
         result.second.mSkipped = false;
 
+        setBufferPlacement(kernelTest.mBufferPlacement);
+
+        vk::Extent3D workgroupSize = kernelTest.mWorkgroupSize;
+        const bool isTuned = (kernelTest.mUseTunedWorkgroupSize
+                              && module.getTunedWorkgroupSize(kernelTest.mEntryName, workgroupSize));
+
         clspv_utils::kernel kernel;
 
-		try {
-	        kernel = clspv_utils::kernel(module.createKernelReq(kernelTest.mEntryName), kernelTest.mWorkgroupSize);
+        if (prebuiltKernel) {
+            kernel = std::move(*prebuiltKernel);
             result.second.mCompiledCorrectly = true;
-		}
-        catch (...) {
-            result.second.mExceptionString = current_exception_to_string();
+        }
+        else {
+            try {
+                kernel = clspv_utils::kernel(module.createKernelReq(kernelTest.mEntryName), workgroupSize);
+                result.second.mCompiledCorrectly = true;
+            }
+            catch (...) {
+                result.second.mExceptionString = current_exception_to_string();
+            }
         }
 
         if (!kernelTest.mInvocationTests.empty()) {
@@ -96,6 +233,10 @@ namespace test_utils {
                     }
 
                     for (auto& oneResult : invocationResults) {
+                        if (isTuned) {
+                            oneResult.mParameters += " tunedWorkgroupSize:" + workgroup_size_to_string(workgroupSize);
+                        }
+                        annotate_buffer_placement(oneResult, kernelTest.mBufferPlacement);
                         result.second.mInvocationResults.push_back(InvocationTest::result(&oneTest, oneResult));
                     }
                 }
@@ -108,45 +249,138 @@ namespace test_utils {
         return result;
     }
 
-    ModuleTest::result test_module(clspv_utils::device& inDevice,
-                                   const ModuleTest&    moduleTest) {
-        ModuleTest::result result;
-        result.first = &moduleTest;
+    KernelTest::result tune_kernel(clspv_utils::device& device,
+                                   clspv_utils::module& module,
+                                   const KernelTest&    kernelTest) {
+        KernelTest::result result;
+        result.first = &kernelTest;
+        result.second.mSkipped = false;
+
+        setBufferPlacement(kernelTest.mBufferPlacement);
 
         try {
-            android_utils::iassetstream spvmapStream(moduleTest.mName + ".spvmap");
-            if (!spvmapStream.good())
-            {
-                throw std::runtime_error("cannot open spvmap for " + moduleTest.mName);
+            const auto properties = device.getPhysicalDevice().getProperties();
+            const auto candidates = vulkan_utils::getWorkgroupSizeCandidates(properties.limits, kernelTest.mTuneDimensions);
+
+            double bestTime = std::numeric_limits<double>::infinity();
+            vk::Extent3D bestWorkgroupSize;
+            KernelResult::results bestResults;
+
+            for (auto& workgroupSize : candidates) {
+                KernelResult::results candidateResults;
+                double candidateTime = 0.0;
+
+                try {
+                    clspv_utils::kernel kernel(module.createKernelReq(kernelTest.mEntryName), workgroupSize);
+                    result.second.mCompiledCorrectly = true;
+
+                    for (auto &oneTest : kernelTest.mInvocationTests) {
+                        // a workgroup size is only a candidate if the kernel still works with it
+                        const auto check = oneTest.mTestFn(kernel, kernelTest.mArguments, false);
+                        if (check.mEvaluation.mSkipped || 0 == check.mEvaluation.mNumCorrect || 0 < check.mEvaluation.mNumErrors) {
+                            throw std::runtime_error("incorrect results");
+                        }
+
+                        const auto timings = oneTest.mTimeFn(kernel, kernelTest.mArguments, kernelTest.mTimingIterations, false);
+                        candidateTime += median_execution_ns(timings, properties.limits.timestampPeriod);
+
+                        for (auto& oneResult : timings) {
+                            candidateResults.push_back(InvocationTest::result(&oneTest, oneResult));
+                        }
+                    }
+                }
+                catch (...) {
+                    if (kernelTest.mIsVerbose) {
+                        LOGI("%s: workgroupSize:%s rejected (%s)",
+                             kernelTest.mEntryName.c_str(),
+                             workgroup_size_to_string(workgroupSize).c_str(),
+                             current_exception_to_string().c_str());
+                    }
+                    continue;
+                }
+
+                if (kernelTest.mIsVerbose) {
+                    LOGI("%s: workgroupSize:%s executionTime:%.0fns",
+                         kernelTest.mEntryName.c_str(),
+                         workgroup_size_to_string(workgroupSize).c_str(),
+                         candidateTime);
+                }
+
+                if (candidateTime < bestTime) {
+                    bestTime = candidateTime;
+                    bestWorkgroupSize = workgroupSize;
+                    bestResults.swap(candidateResults);
+                }
             }
 
-            // spvmap files may have been generated on a system which uses different line ending
-            // conventions than the system on which the consumer runs. Safer to fetch lines
-            // using a function which recognizes multiple line endings.
-            crlf_savvy::crlf_filter_buffer filter(spvmapStream.rdbuf());
-            spvmapStream.rdbuf(&filter);
+            if (bestResults.empty()) {
+                throw std::runtime_error("no workgroup size gave correct results");
+            }
 
-            clspv_utils::module_spec_t moduleInterface = clspv_utils::createModuleSpec(spvmapStream);
-            spvmapStream.close();
+            module.setTunedWorkgroupSize(kernelTest.mEntryName, bestWorkgroupSize);
 
-            android_utils::iassetstream spvStream(moduleTest.mName + ".spv");
-            if (!spvStream.good())
-            {
-                throw std::runtime_error("cannot open spv for " + moduleTest.mName);
+            for (auto& oneResult : bestResults) {
+                oneResult.second.mParameters += " tunedWorkgroupSize:" + workgroup_size_to_string(bestWorkgroupSize);
+                annotate_buffer_placement(oneResult.second, kernelTest.mBufferPlacement);
             }
+            result.second.mInvocationResults.swap(bestResults);
+        }
+        catch (...) {
+            result.second.mExceptionString = current_exception_to_string();
+        }
+
+        return result;
+    }
+
+    ModuleTest::result test_module(clspv_utils::device& inDevice,
+                                   const ModuleTest&    moduleTest) {
+        ModuleTest::result result;
+        result.first = &moduleTest;
 
-            clspv_utils::module module(spvStream, inDevice, moduleInterface);
+        try {
+            clspv_utils::module module = loadModule(inDevice, moduleTest.mName);
             result.second.mLoadedCorrectly = true;
-            spvStream.close();
 
             auto entryPoints = module.getEntryPoints();
+
+            std::vector<std::vector<const KernelTest*>> testsByEntryPoint;
+            std::vector<clspv_utils::kernel_variant_t> variants;
             for (const auto& ep : entryPoints) {
                 std::vector<const KernelTest*> entryTests;
                 for (auto& kt : moduleTest.mKernelTests) {
                     if (kt.mEntryName == ep) {
                         entryTests.push_back(&kt);
+
+                        // a tuned size may come from a tune op earlier in the module, so
+                        // kernels using it are built as they are tested
+                        if (vk::Extent3D(0, 0, 0) != kt.mWorkgroupSize && 0 == kt.mTuneDimensions && !kt.mUseTunedWorkgroupSize) {
+                            clspv_utils::kernel_variant_t v;
+                            v.mEntryPoint = kt.mEntryName;
+                            v.mWorkgroupSize = kt.mWorkgroupSize;
+                            variants.push_back(v);
+                        }
                     }
                 }
+                testsByEntryPoint.push_back(entryTests);
+            }
+
+            // Build every tested kernel's pipeline up front, concurrently. If any kernel fails to
+            // build, fall back to building each kernel as it is tested, so that the failure is
+            // reported against that kernel.
+            std::vector<clspv_utils::kernel> prebuiltKernels;
+            try {
+                prebuiltKernels = module.createKernels(variants);
+            }
+            catch (...) {
+                prebuiltKernels.clear();
+            }
+            auto nextPrebuiltKernel = prebuiltKernels.begin();
+
+            const auto allocator = inDevice.getMemoryAllocator();
+
+            for (std::size_t epIndex = 0; epIndex < entryPoints.size(); ++epIndex) {
+                const auto& ep = entryPoints[epIndex];
+                const auto& entryTests = testsByEntryPoint[epIndex];
 
                 if (entryTests.empty()) {
                     result.second.mUntestedEntryPoints.push_back(ep);
@@ -162,8 +396,20 @@ namespace test_utils {
                         kernelResult.second.mSkipped = true;
 
                         result.second.mKernelResults.push_back(kernelResult);
+                    } else if (0 < epTest->mTuneDimensions) {
+                        result.second.mKernelResults.push_back(measure_peak_memory(*allocator, [&]() {
+                            return tune_kernel(inDevice, module, *epTest);
+                        }));
                     } else {
-                        result.second.mKernelResults.push_back(test_kernel(module, *epTest));
+                        clspv_utils::kernel* prebuiltKernel = nullptr;
+                        if (!epTest->mUseTunedWorkgroupSize && nextPrebuiltKernel != prebuiltKernels.end()) {
+                            prebuiltKernel = &(*nextPrebuiltKernel);
+                            ++nextPrebuiltKernel;
+                        }
+
+                        result.second.mKernelResults.push_back(measure_peak_memory(*allocator, [&]() {
+                            return test_kernel(module, *epTest, prebuiltKernel);
+                        }));
                     }
                 }
             }
@@ -241,12 +487,70 @@ namespace test_utils {
         oneResult.mParameters = test.getParameterString();
         oneResult.mEvaluation.mNumCorrect = 1;  // timing tests always succeed trivially
 
-        for (unsigned int i = iterations; i > 0; --i)
+        clspv_utils::invocation first = test.recordInvocation(kernel);
+        if (!first.isRecorded())
         {
-            test.prepare();
-            oneResult.mExecutionTime = test.run(kernel);
+            for (unsigned int i = iterations; i > 0; --i)
+            {
+                test.prepare();
+                oneResult.mExecutionTime = test.run(kernel);
+
+                results.push_back(oneResult);
+            }
+
+            return results;
+        }
+
+        // Two recordings of the test are submitted alternately, so that one submission is in
+        // flight while the timestamps of the one before it are collected. Each submission waits
+        // on its predecessor through a semaphore, since they share the test's buffers. For the
+        // same reason, the test is only prepared once.
+        clspv_utils::invocation second = test.recordInvocation(kernel);
+        clspv_utils::invocation* const recorded[2] = { &first, &second };
+
+        const vk::Device device = kernel.getDevice().getDevice();
+        const vk::UniqueSemaphore semaphores[2] = {
+                device.createSemaphoreUnique(vk::SemaphoreCreateInfo()),
+                device.createSemaphoreUnique(vk::SemaphoreCreateInfo())
+        };
+        clspv_utils::completion submissions[2];
+
+        test.prepare();
+
+        StopWatch watch;
+        auto collect = [&](std::size_t slot) {
+            if (!recorded[slot]->tryGetExecutionTime(oneResult.mExecutionTime))
+            {
+                submissions[slot].wait();
+                oneResult.mExecutionTime = recorded[slot]->getExecutionTime();
+            }
+
+            // the time between collections, which is the throughput of the pipelined loop
+            oneResult.mExecutionTime.cpu_duration = watch.getSplitTime();
+            watch.restart();
 
             results.push_back(oneResult);
+        };
+
+        for (unsigned int i = 0; i < iterations; ++i)
+        {
+            const std::size_t slot = i % 2;
+            const std::size_t previous = 1 - slot;
+
+            if (0 == i)
+            {
+                submissions[slot] = recorded[slot]->submitAsync(nullptr, *semaphores[slot]);
+            }
+            else
+            {
+                submissions[slot] = recorded[slot]->submitAsync(*semaphores[previous], *semaphores[slot]);
+                collect(previous);
+            }
+        }
+
+        if (iterations > 0)
+        {
+            collect((iterations - 1) % 2);
         }
 
         return results;
@@ -277,4 +581,9 @@ namespace test_utils {
         return Evaluation();
     }
 
+    clspv_utils::invocation Test::recordInvocation(clspv_utils::kernel& kernel)
+    {
+        return clspv_utils::invocation();
+    }
+
 } // namespace test_utils
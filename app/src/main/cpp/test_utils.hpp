@@ -7,9 +7,12 @@
 
 #include "clspv_utils/invocation.hpp"
 #include "clspv_utils/kernel.hpp"
+#include "clspv_utils/module.hpp"
 #include "fp_utils.hpp"
 #include "gpu_types.hpp"
 #include "pixels.hpp"
+#include "vulkan_utils/chunked_buffer.hpp"
+#include "vulkan_utils/vulkan_utils.hpp"
 
 #include <vulkan/vulkan.hpp>
 
@@ -162,6 +165,11 @@ namespace test_utils {
         bool			mCompiledCorrectly	= false;
         std::string     mExceptionString;
         results         mInvocationResults;
+
+        // The most device memory held while the kernel was tested, beyond what was held before
+        vk::DeviceSize              mPeakMemoryBytes        = 0;
+        std::uint32_t               mPeakAllocationCount    = 0;
+        std::vector<vk::DeviceSize> mPeakMemoryBytesByType; // indexed by memory type
     };
 
     struct KernelTest {
@@ -173,6 +181,9 @@ namespace test_utils {
         vk::Extent3D        mWorkgroupSize;
         test_arguments      mArguments;
         unsigned int        mTimingIterations   = 0;
+        unsigned int        mTuneDimensions     = 0;    // if not zero, mWorkgroupSize is tuned
+        bool                mUseTunedWorkgroupSize  = false;    // if set, mWorkgroupSize is used only if the kernel has not been tuned
+        vulkan_utils::memory_placement  mBufferPlacement    = vulkan_utils::kPlacement_hostCached;
         bool                mIsVerbose          = false;
         invocation_tests    mInvocationTests;
     };
@@ -203,8 +214,34 @@ namespace test_utils {
         virtual void        prepare();
         virtual clspv_utils::execution_time_t   run(clspv_utils::kernel& kernel) = 0;
         virtual Evaluation  evaluate(bool verbose);
+
+        // Return an invocation that has already been recorded, so that timing loops can resubmit
+        // it without rebuilding it each iteration. Tests which return an unrecorded invocation
+        // (the default) are timed by calling run() for each iteration.
+        virtual clspv_utils::invocation         recordInvocation(clspv_utils::kernel& kernel);
     };
 
+    // The placement of the storage buffers which tests create with createStorageBuffer. It is set
+    // from each kernel test's mBufferPlacement while that test runs.
+    vulkan_utils::memory_placement  getBufferPlacement();
+    void                            setBufferPlacement(vulkan_utils::memory_placement placement);
+
+    // Create a storage buffer with the current buffer placement. If the buffer is device local,
+    // mapping it stages its contents through the device's compute queue.
+    vulkan_utils::buffer createStorageBuffer(const clspv_utils::device& device, vk::DeviceSize num_bytes);
+
+    // Load the module, and its descriptor map, from the application's assets
+    clspv_utils::module loadModule(const clspv_utils::device& device, const std::string& moduleName);
+
+    // Create a chunked storage buffer of numRows rows of rowBytes bytes, with the current buffer
+    // placement, for data too large to bind as one storage buffer. The byte limits are as for
+    // vulkan_utils::chunked_buffer.
+    vulkan_utils::chunked_buffer createChunkedStorageBuffer(const clspv_utils::device& device,
+                                                            std::uint32_t              numRows,
+                                                            vk::DeviceSize             rowBytes,
+                                                            vk::DeviceSize             maxBufferBytes = vulkan_utils::chunked_buffer::kDefaultMaxBufferBytes,
+                                                            vk::DeviceSize             maxChunkBytes = VK_WHOLE_SIZE);
+
     template<typename T>
     bool pixel_compare(const T &l, const T &r) {
         return details::pixel_comparator<T>::is_equal(l, r);
@@ -381,7 +418,16 @@ namespace test_utils {
         return InvocationTest{ variation, run_test<Test>, time_test<Test> };
     }
 
+    // If prebuiltKernel is not null, it is used instead of creating the kernel from the module
     KernelTest::result test_kernel(clspv_utils::module& module,
+                                   const KernelTest&    kernelTest,
+                                   clspv_utils::kernel* prebuiltKernel = nullptr);
+
+    // Time the kernel with every workgroup size the device permits in the test's number of
+    // dimensions, and record the fastest one which gives correct results in the module. The
+    // result holds the timings of the fastest workgroup size.
+    KernelTest::result tune_kernel(clspv_utils::device& device,
+                                   clspv_utils::module& module,
                                    const KernelTest&    kernelTest);
 
     ModuleTest::result test_module(clspv_utils::device& inDevice,
@@ -0,0 +1,224 @@
+//
+// Created on 10/18/26.
+//
+
+#include "transfer_overlap_test.hpp"
+
+#include "clspv_utils/completion.hpp"
+#include "clspv_utils/transfer_batch.hpp"
+#include "test_utils.hpp"
+#include "util.hpp"
+#include "vulkan_utils/vulkan_utils.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+    const vk::Format    kFrameFormat    = vk::Format::eR8G8B8A8Unorm;
+    const unsigned int  kNumFrames      = 30;
+
+    // frames in flight: one uploading, one computing, and one reading back
+    const unsigned int  kPipelineDepth  = 3;
+
+    enum stage {
+        kStage_upload,
+        kStage_compute,
+        kStage_readback,
+
+        kStage_count
+    };
+
+    // The resources of one frame in flight. The compute stage stands in for a kernel by copying
+    // the input image through a device local buffer into the output image on the compute queue,
+    // which keeps the benchmark independent of any shader module.
+    struct frame {
+        frame(const clspv_utils::device&    device,
+              const vk::Extent3D&           extent,
+              clspv_utils::device::queue_role transferRole);
+
+        frame(const frame& other) = delete;
+
+        frame&  operator=(const frame& other) = delete;
+
+        vulkan_utils::buffer        mUploadStaging;
+        vulkan_utils::image         mInput;
+        vulkan_utils::buffer        mIntermediate;
+        vulkan_utils::image         mOutput;
+        vulkan_utils::buffer        mReadbackStaging;
+
+        clspv_utils::transfer_batch mStages[kStage_count];
+        clspv_utils::completion     mDone;
+    };
+
+    frame::frame(const clspv_utils::device&         device,
+                 const vk::Extent3D&                extent,
+                 clspv_utils::device::queue_role    transferRole)
+    {
+        const vk::BufferUsageFlags stagingUsage = vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+
+        mInput = vulkan_utils::image(device.getDevice(),
+                                     device.getMemoryProperties(),
+                                     extent,
+                                     kFrameFormat,
+                                     vulkan_utils::image::kUsage_ReadOnly);
+        mOutput = vulkan_utils::image(device.getDevice(),
+                                      device.getMemoryProperties(),
+                                      extent,
+                                      kFrameFormat,
+                                      vulkan_utils::image::kUsage_ReadOnly);
+
+        const vk::DeviceSize frameBytes = vulkan_utils::computeImageByteSize(mInput);
+        mUploadStaging = vulkan_utils::buffer(device.getDevice(), device.getMemoryProperties(), frameBytes, stagingUsage);
+        mReadbackStaging = vulkan_utils::buffer(device.getDevice(), device.getMemoryProperties(), frameBytes, stagingUsage);
+        mIntermediate = vulkan_utils::buffer(device.getDevice(),
+                                             device.getMemoryProperties(),
+                                             frameBytes,
+                                             stagingUsage,
+                                             vulkan_utils::kPlacement_deviceLocal);
+
+        auto uploadMap = mUploadStaging.map<std::uint32_t>(vulkan_utils::buffer::kMap_write);
+        std::fill(uploadMap.get(), uploadMap.get() + frameBytes / sizeof(std::uint32_t), 0xff8040c0);
+        uploadMap.reset();
+
+        for (auto& s : mStages) {
+            s = clspv_utils::transfer_batch(device);
+        }
+
+        mStages[kStage_upload].addUpload(mUploadStaging, mInput, vk::ImageLayout::eTransferSrcOptimal);
+        mStages[kStage_upload].setQueue(transferRole);
+
+        mStages[kStage_compute].addReadback(mInput, mIntermediate);
+        mStages[kStage_compute].addUpload(mIntermediate, mOutput, vk::ImageLayout::eTransferSrcOptimal);
+
+        mStages[kStage_readback].addReadback(mOutput, mReadbackStaging);
+        mStages[kStage_readback].setQueue(transferRole);
+    }
+
+    typedef std::vector<std::unique_ptr<frame>> frame_list;
+
+    frame_list createFrames(const clspv_utils::device&      device,
+                            const vk::Extent3D&             extent,
+                            clspv_utils::device::queue_role transferRole)
+    {
+        frame_list result;
+        for (unsigned int i = 0; i < kPipelineDepth; ++i) {
+            result.emplace_back(new frame(device, extent, transferRole));
+        }
+        return result;
+    }
+
+    void submitCompute(frame& f)
+    {
+        // The output was last read back by the transfer queue, which has finished with it
+        f.mOutput.discardContents();
+        f.mStages[kStage_compute].submitAsync();
+    }
+
+    // Run each frame's stages one after another on the compute queue, accumulating the time
+    // spent in each stage
+    test_utils::StopWatch::duration runSerial(const clspv_utils::device&        device,
+                                              const vk::Extent3D&               extent,
+                                              test_utils::StopWatch::duration   (&stageTimes)[kStage_count])
+    {
+        auto frames = createFrames(device, extent, clspv_utils::device::kQueue_compute);
+
+        std::fill(std::begin(stageTimes), std::end(stageTimes), test_utils::StopWatch::duration(0));
+
+        test_utils::StopWatch total;
+        test_utils::StopWatch stageWatch;
+        for (unsigned int i = 0; i < kNumFrames; ++i) {
+            frame& f = *frames[i % kPipelineDepth];
+
+            stageWatch.restart();
+            f.mStages[kStage_upload].run();
+            stageTimes[kStage_upload] += stageWatch.getSplitTime();
+
+            stageWatch.restart();
+            f.mOutput.discardContents();
+            f.mStages[kStage_compute].run();
+            stageTimes[kStage_compute] += stageWatch.getSplitTime();
+
+            stageWatch.restart();
+            f.mStages[kStage_readback].run();
+            stageTimes[kStage_readback] += stageWatch.getSplitTime();
+        }
+        return total.getSplitTime();
+    }
+
+    // Upload frame i while frame i-1 computes and frame i-2 reads back
+    test_utils::StopWatch::duration runPipelined(const clspv_utils::device& device, const vk::Extent3D& extent)
+    {
+        auto frames = createFrames(device, extent, clspv_utils::device::kQueue_transfer);
+
+        test_utils::StopWatch total;
+        for (unsigned int i = 0; i < kNumFrames + 2; ++i) {
+            // The readback is released by the compute queue before the next frame's compute is
+            // submitted, so that it does not wait for that compute to finish
+            if (i >= 2) {
+                frame& f = *frames[(i - 2) % kPipelineDepth];
+                f.mDone = f.mStages[kStage_readback].submitAsync();
+            }
+
+            if (i >= 1 && i - 1 < kNumFrames) {
+                submitCompute(*frames[(i - 1) % kPipelineDepth]);
+            }
+
+            if (i < kNumFrames) {
+                frame& f = *frames[i % kPipelineDepth];
+                f.mDone.wait();
+                f.mStages[kStage_upload].submitAsync();
+            }
+        }
+
+        for (auto& f : frames) {
+            f->mDone.wait();
+        }
+        return total.getSplitTime();
+    }
+
+    void runOneTest(const clspv_utils::device& device, const vk::Extent3D& extent)
+    {
+        test_utils::StopWatch::duration stageTimes[kStage_count];
+        const auto serial = runSerial(device, extent, stageTimes);
+        const auto pipelined = runPipelined(device, extent);
+
+        // With perfect overlap, the frames would take as long as their slowest stage
+        const auto ideal = *std::max_element(std::begin(stageTimes), std::end(stageTimes));
+        const double achieved = (serial > ideal ? (serial - pipelined) / (serial - ideal) : 0.0);
+
+        std::ostringstream os;
+        os << "transfer-overlap"
+           << " extent:<" << extent.width << "x" << extent.height << ">"
+           << " frames:" << kNumFrames
+           << " dedicatedTransferQueue:" << (device.hasDedicatedQueue(clspv_utils::device::kQueue_transfer) ? "yes" : "no")
+           << " upload:" << stageTimes[kStage_upload].count() / kNumFrames << "s"
+           << " compute:" << stageTimes[kStage_compute].count() / kNumFrames << "s"
+           << " readback:" << stageTimes[kStage_readback].count() / kNumFrames << "s"
+           << " serial:" << serial.count() / kNumFrames << "s"
+           << " pipelined:" << pipelined.count() / kNumFrames << "s"
+           << " overlap:" << achieved * 100.0 << "%";
+
+        LOGI("%s", os.str().c_str());
+    }
+}
+
+namespace transfer_overlap_test {
+
+    void runAllTests(const clspv_utils::device& device)
+    {
+        const vk::Extent3D extents[] = {
+                vk::Extent3D(3840, 2160, 1),
+                vk::Extent3D(1920, 1080, 1),
+                vk::Extent3D(1280,  720, 1),
+        };
+
+        for (auto& extent : extents) {
+            runOneTest(device, extent);
+        }
+    }
+}
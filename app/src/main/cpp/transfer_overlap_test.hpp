@@ -0,0 +1,19 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVTEST_TRANSFER_OVERLAP_TEST_HPP
+#define CLSPVTEST_TRANSFER_OVERLAP_TEST_HPP
+
+#include "clspv_utils/device.hpp"
+
+namespace transfer_overlap_test {
+
+    // Time a stream of frames, each uploaded, processed on the compute queue, and read back,
+    // first one stage at a time on the compute queue, then pipelined so that uploads and
+    // readbacks on the transfer queue overlap with compute. Log how much of the possible
+    // overlap was achieved.
+    void runAllTests(const clspv_utils::device& device);
+}
+
+#endif //CLSPVTEST_TRANSFER_OVERLAP_TEST_HPP
@@ -0,0 +1,90 @@
+//
+// Created on 10/18/26.
+//
+
+#include "uniform_ring_test.hpp"
+
+#include "clspv_utils/uniform_ring.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+    // About the size of an invocation's pod arguments
+    const vk::DeviceSize    kBlockBytes     = 256;
+
+    // Blocks, besides the kept one, that are live at once
+    const std::size_t       kNumLive        = 16;
+
+    const unsigned int      kNumLaps        = 4;
+
+    std::uint8_t getPatternByte(std::size_t i)
+    {
+        return static_cast<std::uint8_t>((i * 2654435761u) >> 24);
+    }
+
+    bool isOverlapping(const clspv_utils::uniform_ring::allocation& a,
+                       const clspv_utils::uniform_ring::allocation& b)
+    {
+        return a.getOffset() < b.getOffset() + b.getSize()
+               && b.getOffset() < a.getOffset() + a.getSize();
+    }
+}
+
+namespace uniform_ring_test {
+
+    void runAllTests(const clspv_utils::device& device)
+    {
+        auto ring = device.getUniformRing();
+        const std::size_t numCycles = kNumLaps * (ring->getCapacity() / kBlockBytes);
+
+        bool success = true;
+        std::size_t cycle = 0;
+        try {
+            auto kept = ring->allocate(kBlockBytes);
+            std::uint8_t* const keptData = static_cast<std::uint8_t*>(kept.data());
+            for (std::size_t i = 0; i < kBlockBytes; ++i) {
+                keptData[i] = getPatternByte(i);
+            }
+
+            std::deque<clspv_utils::uniform_ring::allocation> live;
+            for (; cycle < numCycles; ++cycle) {
+                live.push_back(ring->allocate(kBlockBytes));
+                std::fill_n(static_cast<std::uint8_t*>(live.back().data()), kBlockBytes, 0);
+
+                success = !isOverlapping(kept, live.back()) && success;
+
+                if (live.size() > kNumLive) {
+                    live.pop_front();
+                }
+            }
+
+            for (std::size_t i = 0; i < kBlockBytes; ++i) {
+                success = (getPatternByte(i) == keptData[i]) && success;
+            }
+        }
+        catch (const std::runtime_error& e) {
+            LOGE("uniform-ring: %s", e.what());
+            success = false;
+        }
+
+        std::ostringstream os;
+        os << "uniform-ring"
+           << " capacity:" << ring->getCapacity()
+           << " blockBytes:" << kBlockBytes
+           << " cycles:" << cycle
+           << " result:" << (success ? "pass" : "fail");
+
+        if (success) {
+            LOGI("%s", os.str().c_str());
+        }
+        else {
+            LOGE("%s", os.str().c_str());
+        }
+    }
+}
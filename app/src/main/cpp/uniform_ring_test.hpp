@@ -0,0 +1,18 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef CLSPVTEST_UNIFORM_RING_TEST_HPP
+#define CLSPVTEST_UNIFORM_RING_TEST_HPP
+
+#include "clspv_utils/device.hpp"
+
+namespace uniform_ring_test {
+
+    // Keep one block of the device's uniform ring, as a recorded invocation does, while
+    // allocating and releasing several times the ring's capacity in other blocks. Check that the
+    // ring is never exhausted, that no block overlaps the kept one, and log the result.
+    void runAllTests(const clspv_utils::device& device);
+}
+
+#endif //CLSPVTEST_UNIFORM_RING_TEST_HPP
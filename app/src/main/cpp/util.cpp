@@ -127,6 +127,12 @@ namespace android_utils {
         return funopen(asset, android_read, android_write, android_seek, android_close);
     }
 
+    std::string getInternalDataPath() {
+        assert(Android_application != nullptr);
+        const char* path = Android_application->activity->internalDataPath;
+        return (path ? path : "");
+    }
+
     LogBuffer::LogBuffer(android_LogPriority priority) {
         priority_ = priority;
         this->setp(buffer_, buffer_ + kBufferSize - 1);
@@ -70,6 +70,12 @@ struct sample_info {
     uint32_t                            graphics_queue_family_index     = 0;
     vk::QueueFamilyProperties           graphics_queue_family_properties;
 
+    // Additional queues, created if their family index is not VK_QUEUE_FAMILY_IGNORED
+    vk::Queue                           async_compute_queue;
+    uint32_t                            async_compute_queue_family_index    = VK_QUEUE_FAMILY_IGNORED;
+    vk::Queue                           transfer_queue;
+    uint32_t                            transfer_queue_family_index         = VK_QUEUE_FAMILY_IGNORED;
+
     vk::PhysicalDeviceProperties        physical_device_properties;
     vk::UniqueCommandPool               cmd_pool;
     vk::UniqueDescriptorPool            desc_pool;
@@ -95,6 +101,9 @@ ANativeWindow* AndroidGetApplicationWindow();
 namespace android_utils {
     FILE* asset_fopen(const char* fname, const char* mode);
 
+    // Return the app's private, writable data directory, or an empty string if there is none
+    std::string getInternalDataPath();
+
     // Helpder class to forward the cout/cerr output to logcat derived from:
     // http://stackoverflow.com/questions/8870174/is-stdcout-usable-in-android-ndk
     class LogBuffer : public std::streambuf {
@@ -72,6 +72,14 @@ bool demo_check_layers(const std::vector<layer_properties> &layer_props, const s
 void init_instance(struct sample_info &info, char const *const app_short_name) {
     info.instance_extension_names.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 
+    // Device level external memory extensions, such as host memory import, require this
+    const auto extensions = vk::enumerateInstanceExtensionProperties();
+    if (extensions.end() != std::find_if(extensions.begin(), extensions.end(), [](const vk::ExtensionProperties& e) {
+                                             return 0 == strcmp(e.extensionName, VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME);
+                                         })) {
+        info.instance_extension_names.push_back(VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME);
+    }
+
     vk::ApplicationInfo app_info;
     int version_number = VK_API_VERSION_1_0;
     version_number = (((1) << 22) | ((1) << 12) | (0));
@@ -93,20 +101,56 @@ void init_instance(struct sample_info &info, char const *const app_short_name) {
     info.getPhysicalDeviceFeatures2KHR = (PFN_vkGetPhysicalDeviceFeatures2KHR) info.inst->getProcAddr("vkGetPhysicalDeviceFeatures2KHR");
 }
 
-void init_device(struct sample_info &info) {
-    const float queue_priorities[1] = { 0.0f };
+/*
+ * Return the index within its family of each queue used by the sample. Queues from the same
+ * family are numbered in the order graphics, async compute, transfer.
+ */
+static std::vector<std::pair<uint32_t, uint32_t>> get_queue_indices(const struct sample_info &info) {
+    std::vector<std::pair<uint32_t, uint32_t>> result;  // (family, index)
+
+    for (auto family : { info.graphics_queue_family_index,
+                         info.async_compute_queue_family_index,
+                         info.transfer_queue_family_index }) {
+        uint32_t index = 0;
+        if (family != VK_QUEUE_FAMILY_IGNORED) {
+            index = std::count_if(result.begin(), result.end(), [family](const std::pair<uint32_t, uint32_t>& q) {
+                return q.first == family;
+            });
+        }
+        result.push_back(std::make_pair(family, index));
+    }
+
+    return result;
+}
 
-    vk::DeviceQueueCreateInfo queue_info;
-    queue_info.setQueueCount(1)
-            .setPQueuePriorities(queue_priorities)
-            .setQueueFamilyIndex(info.graphics_queue_family_index);
+void init_device(struct sample_info &info) {
+    const float queue_priorities[3] = { 0.0f, 0.0f, 0.0f };
+
+    std::vector<vk::DeviceQueueCreateInfo> queue_infos;
+    for (auto& q : get_queue_indices(info)) {
+        if (q.first == VK_QUEUE_FAMILY_IGNORED) continue;
+
+        auto found = std::find_if(queue_infos.begin(), queue_infos.end(), [&q](const vk::DeviceQueueCreateInfo& qi) {
+            return qi.queueFamilyIndex == q.first;
+        });
+        if (found == queue_infos.end()) {
+            vk::DeviceQueueCreateInfo queue_info;
+            queue_info.setQueueCount(1)
+                    .setPQueuePriorities(queue_priorities)
+                    .setQueueFamilyIndex(q.first);
+            queue_infos.push_back(queue_info);
+        }
+        else {
+            found->queueCount = std::max(found->queueCount, q.second + 1);
+        }
+    }
 
     vk::PhysicalDeviceFeatures device_features;
     device_features.setShaderStorageImageWriteWithoutFormat(true);
 
     vk::DeviceCreateInfo device_info;
-    device_info.setQueueCreateInfoCount(1)
-            .setPQueueCreateInfos(&queue_info)
+    device_info.setQueueCreateInfoCount(queue_infos.size())
+            .setPQueueCreateInfos(queue_infos.data())
             .setEnabledExtensionCount(info.device_extension_names.size())
             .setPpEnabledExtensionNames(info.device_extension_names.size() ? info.device_extension_names.data() : NULL)
             .setPEnabledFeatures(&device_features);
@@ -151,5 +195,13 @@ void init_command_pool(struct sample_info &info) {
 }
 
 void init_device_queue(struct sample_info &info) {
+    const auto queue_indices = get_queue_indices(info);
+
     info.graphics_queue = info.device->getQueue(info.graphics_queue_family_index, 0);
+    if (info.async_compute_queue_family_index != VK_QUEUE_FAMILY_IGNORED) {
+        info.async_compute_queue = info.device->getQueue(info.async_compute_queue_family_index, queue_indices[1].second);
+    }
+    if (info.transfer_queue_family_index != VK_QUEUE_FAMILY_IGNORED) {
+        info.transfer_queue = info.device->getQueue(info.transfer_queue_family_index, queue_indices[2].second);
+    }
 }
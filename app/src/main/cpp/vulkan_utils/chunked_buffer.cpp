@@ -0,0 +1,145 @@
+//
+// Created on 10/18/26.
+//
+
+#include "chunked_buffer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+    void fail_runtime_error(const char* what)
+    {
+        throw std::runtime_error(what);
+    }
+
+    vk::DeviceSize gcd(vk::DeviceSize a, vk::DeviceSize b)
+    {
+        while (b) {
+            const vk::DeviceSize r = a % b;
+            a = b;
+            b = r;
+        }
+        return a;
+    }
+
+}
+
+namespace vulkan_utils {
+
+    const vk::DeviceSize chunked_buffer::kDefaultMaxBufferBytes;
+
+    std::vector<row_chunk> computeRowChunks(std::uint32_t                     numRows,
+                                            vk::DeviceSize                    rowBytes,
+                                            const vk::PhysicalDeviceLimits&   limits,
+                                            vk::DeviceSize                    maxChunkBytes)
+    {
+        if (0 == rowBytes) {
+            fail_runtime_error("rows must not be empty");
+        }
+
+        const vk::DeviceSize maxRange = std::min<vk::DeviceSize>(limits.maxStorageBufferRange, maxChunkBytes);
+
+        // Chunks begin at multiples of rowStep rows, so that their offsets are suitably aligned
+        const vk::DeviceSize alignment = std::max<vk::DeviceSize>(limits.minStorageBufferOffsetAlignment, 1);
+        const vk::DeviceSize rowStep = alignment / gcd(rowBytes, alignment);
+        const vk::DeviceSize rowsPerChunk = maxRange / rowBytes / rowStep * rowStep;
+
+        std::vector<row_chunk> result;
+        if (numRows * rowBytes <= maxRange) {
+            row_chunk whole;
+            whole.mNumRows = numRows;
+            whole.mSize = numRows * rowBytes;
+            result.push_back(whole);
+            return result;
+        }
+
+        if (0 == rowsPerChunk) {
+            fail_runtime_error("rows are too large to bind as aligned storage buffer ranges");
+        }
+
+        for (vk::DeviceSize row = 0; row < numRows; row += rowsPerChunk) {
+            row_chunk c;
+            c.mFirstRow = static_cast<std::uint32_t>(row);
+            c.mNumRows = static_cast<std::uint32_t>(std::min<vk::DeviceSize>(rowsPerChunk, numRows - row));
+            c.mOffset = row * rowBytes;
+            c.mSize = c.mNumRows * rowBytes;
+            result.push_back(c);
+        }
+        return result;
+    }
+
+    chunked_buffer::chunked_buffer(vk::Device                               device,
+                                   const vk::PhysicalDeviceMemoryProperties memoryProperties,
+                                   const vk::PhysicalDeviceLimits&          limits,
+                                   std::uint32_t                            numRows,
+                                   vk::DeviceSize                           rowBytes,
+                                   vk::BufferUsageFlags                     usage,
+                                   memory_placement                         placement,
+                                   transfer_fn                              transfer,
+                                   vk::DeviceSize                           maxBufferBytes,
+                                   vk::DeviceSize                           maxChunkBytes)
+            : mNumRows(numRows),
+              mRowBytes(rowBytes)
+    {
+        if (0 == numRows || 0 == rowBytes) {
+            fail_runtime_error("chunked buffer must not be empty");
+        }
+
+        const vk::DeviceSize rowsPerBuffer = maxBufferBytes / rowBytes;
+        if (0 == rowsPerBuffer) {
+            fail_runtime_error("a row of the chunked buffer is larger than a buffer may be");
+        }
+
+        for (vk::DeviceSize firstRow = 0; firstRow < numRows; firstRow += rowsPerBuffer) {
+            const auto bufferRows = static_cast<std::uint32_t>(std::min<vk::DeviceSize>(rowsPerBuffer, numRows - firstRow));
+
+            mBuffers.push_back(buffer(device, memoryProperties, bufferRows * rowBytes, usage, placement, transfer));
+            mBufferFirstRows.push_back(static_cast<std::uint32_t>(firstRow));
+
+            for (auto& rc : computeRowChunks(bufferRows, rowBytes, limits, maxChunkBytes)) {
+                chunk c;
+                static_cast<row_chunk&>(c) = rc;
+                c.mFirstRow += mBufferFirstRows.back();
+                c.mBufferIndex = mBuffers.size() - 1;
+                mChunks.push_back(c);
+            }
+        }
+    }
+
+    chunked_buffer::chunked_buffer(chunked_buffer&& other)
+            : chunked_buffer()
+    {
+        swap(other);
+    }
+
+    chunked_buffer::~chunked_buffer()
+    {
+    }
+
+    chunked_buffer& chunked_buffer::operator=(chunked_buffer&& other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    void chunked_buffer::swap(chunked_buffer& other)
+    {
+        using std::swap;
+
+        swap(mNumRows, other.mNumRows);
+        swap(mRowBytes, other.mRowBytes);
+        swap(mBuffers, other.mBuffers);
+        swap(mBufferFirstRows, other.mBufferFirstRows);
+        swap(mChunks, other.mChunks);
+    }
+
+    std::uint32_t chunked_buffer::getBufferRowCount(std::size_t index) const
+    {
+        const std::uint32_t end = (index + 1 < mBufferFirstRows.size() ? mBufferFirstRows[index + 1] : mNumRows);
+        return end - mBufferFirstRows[index];
+    }
+
+} // namespace vulkan_utils
@@ -0,0 +1,104 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef VULKAN_UTILS_CHUNKED_BUFFER_HPP
+#define VULKAN_UTILS_CHUNKED_BUFFER_HPP
+
+#include "vulkan_utils.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vulkan_utils {
+
+    // A run of whole rows of a buffer, small enough to be bound as a single storage buffer
+    // descriptor. mOffset and mSize are in bytes, relative to the start of the buffer.
+    struct row_chunk {
+        std::uint32_t   mFirstRow   = 0;
+        std::uint32_t   mNumRows    = 0;
+        vk::DeviceSize  mOffset     = 0;
+        vk::DeviceSize  mSize       = 0;
+    };
+
+    // Split numRows rows into chunks no larger than maxStorageBufferRange, or maxChunkBytes if
+    // that is smaller, each of which begins at a multiple of minStorageBufferOffsetAlignment. Rows
+    // which fit in a single chunk are returned as a single chunk.
+    std::vector<row_chunk> computeRowChunks(std::uint32_t                     numRows,
+                                            vk::DeviceSize                    rowBytes,
+                                            const vk::PhysicalDeviceLimits&   limits,
+                                            vk::DeviceSize                    maxChunkBytes = VK_WHOLE_SIZE);
+
+    // A chunked_buffer holds a 2D or 3D grid of rows too large to bind, or even to allocate, as
+    // a single storage buffer. The rows are spread across as few buffers as maxBufferBytes
+    // allows, and each buffer is divided into row_chunks which can each be bound by a
+    // descriptor. A kernel invoked once per chunk is told the chunk's first row as its base
+    // coordinate. Slices of a 3D grid are simply more rows.
+    //
+    // maxChunkBytes further limits the size of a chunk, so that tests can exercise several chunks
+    // and buffers at small extents.
+    class chunked_buffer {
+    public:
+        // The smallest maxMemoryAllocationSize which Vulkan permits
+        static const vk::DeviceSize kDefaultMaxBufferBytes = 1024 * 1024 * 1024;
+
+        struct chunk : public row_chunk {
+            std::size_t     mBufferIndex    = 0;    // mFirstRow is relative to the whole grid
+        };
+
+    public:
+                        chunked_buffer() {}
+
+                        chunked_buffer(vk::Device                               device,
+                                       const vk::PhysicalDeviceMemoryProperties memoryProperties,
+                                       const vk::PhysicalDeviceLimits&          limits,
+                                       std::uint32_t                            numRows,
+                                       vk::DeviceSize                           rowBytes,
+                                       vk::BufferUsageFlags                     usage,
+                                       memory_placement                         placement = kPlacement_hostCached,
+                                       transfer_fn                              transfer = transfer_fn(),
+                                       vk::DeviceSize                           maxBufferBytes = kDefaultMaxBufferBytes,
+                                       vk::DeviceSize                           maxChunkBytes = VK_WHOLE_SIZE);
+
+                        chunked_buffer(const chunked_buffer& other) = delete;
+
+                        chunked_buffer(chunked_buffer&& other);
+
+                        ~chunked_buffer();
+
+        chunked_buffer& operator=(const chunked_buffer& other) = delete;
+
+        chunked_buffer& operator=(chunked_buffer&& other);
+
+        void            swap(chunked_buffer& other);
+
+        const std::vector<chunk>&   getChunks() const { return mChunks; }
+
+        std::size_t     getBufferCount() const { return mBuffers.size(); }
+        buffer&         getBuffer(std::size_t index) { return mBuffers[index]; }
+
+        // The rows held by one of the buffers
+        std::uint32_t   getBufferFirstRow(std::size_t index) const { return mBufferFirstRows[index]; }
+        std::uint32_t   getBufferRowCount(std::size_t index) const;
+
+        std::uint32_t   getRowCount() const { return mNumRows; }
+        vk::DeviceSize  getRowBytes() const { return mRowBytes; }
+
+    private:
+        std::uint32_t           mNumRows    = 0;
+        vk::DeviceSize          mRowBytes   = 0;
+        std::vector<buffer>     mBuffers;
+        std::vector<std::uint32_t>  mBufferFirstRows;
+        std::vector<chunk>      mChunks;
+    };
+
+    inline void swap(chunked_buffer& lhs, chunked_buffer& rhs)
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#endif //VULKAN_UTILS_CHUNKED_BUFFER_HPP
@@ -0,0 +1,486 @@
+//
+// Created on 10/18/26.
+//
+
+#include "memory_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+    const vk::DeviceSize kDefaultBlockSize = 16 * 1024 * 1024;
+
+    // No block takes more than this fraction of its heap
+    const vk::DeviceSize kHeapFractionPerBlock = 8;
+
+    void fail_runtime_error(const char* what)
+    {
+        throw std::runtime_error(what);
+    }
+
+    vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool isNonCoherent(vk::MemoryPropertyFlags flags)
+    {
+        return (flags & vk::MemoryPropertyFlagBits::eHostVisible)
+               && !(flags & vk::MemoryPropertyFlagBits::eHostCoherent);
+    }
+
+    std::mutex& getDefaultsMutex()
+    {
+        static std::mutex result;
+        return result;
+    }
+
+    std::map<VkDevice, std::weak_ptr<vulkan_utils::memory_allocator> >& getDefaults()
+    {
+        static std::map<VkDevice, std::weak_ptr<vulkan_utils::memory_allocator> > result;
+        return result;
+    }
+
+}
+
+namespace vulkan_utils {
+
+    const vk::DeviceSize memory_allocator::kMaxNonCoherentAtomSize;
+
+    memory_allocator::allocation::allocation()
+    {
+        // this space intentionally left blank
+    }
+
+    memory_allocator::allocation::allocation(allocation&& other)
+            : allocation()
+    {
+        swap(other);
+    }
+
+    memory_allocator::allocation::~allocation()
+    {
+        reset();
+    }
+
+    memory_allocator::allocation& memory_allocator::allocation::operator=(allocation&& other)
+    {
+        swap(other);
+        return *this;
+    }
+
+    void memory_allocator::allocation::swap(allocation& other)
+    {
+        using std::swap;
+
+        swap(mAllocator, other.mAllocator);
+        swap(mPool, other.mPool);
+        swap(mBlockId, other.mBlockId);
+        swap(mMemory, other.mMemory);
+        swap(mOffset, other.mOffset);
+        swap(mSize, other.mSize);
+        swap(mPropertyFlags, other.mPropertyFlags);
+        swap(mMapped, other.mMapped);
+    }
+
+    vk::MappedMemoryRange memory_allocator::allocation::getMappedRange(vk::DeviceSize offset, vk::DeviceSize size) const
+    {
+        if (offset > mSize) {
+            fail_runtime_error("mapped range lies outside the allocation");
+        }
+
+        // The allocation is aligned to kMaxNonCoherentAtomSize, so widening the range to that
+        // alignment keeps it within the allocation.
+        const vk::DeviceSize end = std::min(mSize, align_up(offset + std::min(size, mSize - offset), kMaxNonCoherentAtomSize));
+        const vk::DeviceSize begin = offset / kMaxNonCoherentAtomSize * kMaxNonCoherentAtomSize;
+
+        return vk::MappedMemoryRange(mMemory, mOffset + begin, end - begin);
+    }
+
+    void memory_allocator::allocation::flush() const
+    {
+        flush(0, mSize);
+    }
+
+    void memory_allocator::allocation::flush(vk::DeviceSize offset, vk::DeviceSize size) const
+    {
+        if (mMapped && isNonCoherent(mPropertyFlags) && size > 0) {
+            mAllocator->getDevice().flushMappedMemoryRanges(getMappedRange(offset, size));
+        }
+    }
+
+    void memory_allocator::allocation::invalidate() const
+    {
+        invalidate(0, mSize);
+    }
+
+    void memory_allocator::allocation::invalidate(vk::DeviceSize offset, vk::DeviceSize size) const
+    {
+        if (mMapped && isNonCoherent(mPropertyFlags) && size > 0) {
+            mAllocator->getDevice().invalidateMappedMemoryRanges(getMappedRange(offset, size));
+        }
+    }
+
+    void memory_allocator::allocation::reset()
+    {
+        if (mAllocator) {
+            mAllocator->free(*this);
+        }
+
+        mAllocator.reset();
+        mPool = 0;
+        mBlockId = 0;
+        mMemory = vk::DeviceMemory();
+        mOffset = 0;
+        mSize = 0;
+        mPropertyFlags = vk::MemoryPropertyFlags();
+        mMapped = nullptr;
+    }
+
+    memory_allocator::memory_allocator(vk::Device                                   device,
+                                       const vk::PhysicalDeviceMemoryProperties&    memoryProperties,
+                                       vk::DeviceSize                               blockSize)
+            : mDevice(device),
+              mMemoryProperties(memoryProperties),
+              mBlockSize(blockSize ? blockSize : kDefaultBlockSize),
+              mPools(2 * memoryProperties.memoryTypeCount)
+    {
+        for (std::size_t i = 0; i < mPools.size(); ++i) {
+            mPools[i].mMemoryTypeIndex = i / 2;
+            mPools[i].mKind = static_cast<resource_kind>(i % 2);
+        }
+        mUsage.mMemoryTypes.resize(memoryProperties.memoryTypeCount);
+    }
+
+    memory_allocator::~memory_allocator()
+    {
+        // Any allocation would hold a reference to the allocator, so every block is empty
+    }
+
+    std::shared_ptr<memory_allocator> memory_allocator::getDefault(vk::Device                                   device,
+                                                                   const vk::PhysicalDeviceMemoryProperties&    memoryProperties)
+    {
+        std::lock_guard<std::mutex> lock(getDefaultsMutex());
+
+        auto& defaults = getDefaults();
+        for (auto i = defaults.begin(); i != defaults.end(); ) {
+            i = (i->second.expired() ? defaults.erase(i) : std::next(i));
+        }
+
+        auto result = defaults[(VkDevice)device].lock();
+        if (!result) {
+            result = std::make_shared<memory_allocator>(device, memoryProperties);
+            defaults[(VkDevice)device] = result;
+        }
+
+        return result;
+    }
+
+    vk::DeviceSize memory_allocator::getBlockSize(std::uint32_t memoryTypeIndex) const
+    {
+        const auto& heap = mMemoryProperties.memoryHeaps[mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex];
+        const vk::DeviceSize heapLimit = heap.size / kHeapFractionPerBlock / kMaxNonCoherentAtomSize * kMaxNonCoherentAtomSize;
+
+        return std::max(std::min(mBlockSize, heapLimit), kMaxNonCoherentAtomSize);
+    }
+
+    memory_allocator::statistics memory_allocator::getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        statistics result;
+        for (auto& p : mPools) {
+            for (auto& b : p.mBlocks) {
+                ++result.mBlockCount;
+                result.mBlockBytes += b->mSize;
+                result.mAllocationCount += b->mAllocationCount;
+                if (b->mIsDedicated) {
+                    ++result.mDedicatedCount;
+                    result.mAllocatedBytes += b->mSize;
+                }
+                else {
+                    vk::DeviceSize freeBytes = 0;
+                    for (auto& f : b->mFree) {
+                        freeBytes += f.second;
+                    }
+                    result.mAllocatedBytes += b->mSize - freeBytes;
+                }
+            }
+        }
+        return result;
+    }
+
+    memory_allocator::usage_report memory_allocator::getUsage() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mUsage;
+    }
+
+    void memory_allocator::resetPeakUsage()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto reset = [](usage& u) {
+            u.mPeakAllocationCount = u.mAllocationCount;
+            u.mPeakAllocatedBytes = u.mAllocatedBytes;
+            u.mPeakBlockBytes = u.mBlockBytes;
+        };
+
+        reset(mUsage.mTotal);
+        std::for_each(std::begin(mUsage.mKinds), std::end(mUsage.mKinds), reset);
+        std::for_each(mUsage.mMemoryTypes.begin(), mUsage.mMemoryTypes.end(), reset);
+    }
+
+    void memory_allocator::updateUsage(const pool& p, vk::DeviceSize allocatedBytes, vk::DeviceSize blockBytes, bool isFreed)
+    {
+        const std::uint32_t allocationCount = (allocatedBytes > 0 ? 1 : 0);
+
+        for (usage* u : { &mUsage.mTotal, &mUsage.mKinds[p.mKind], &mUsage.mMemoryTypes[p.mMemoryTypeIndex] }) {
+            if (isFreed) {
+                u->mAllocationCount -= allocationCount;
+                u->mAllocatedBytes -= allocatedBytes;
+                u->mBlockBytes -= blockBytes;
+            }
+            else {
+                u->mAllocationCount += allocationCount;
+                u->mAllocatedBytes += allocatedBytes;
+                u->mBlockBytes += blockBytes;
+
+                u->mPeakAllocationCount = std::max(u->mPeakAllocationCount, u->mAllocationCount);
+                u->mPeakAllocatedBytes = std::max(u->mPeakAllocatedBytes, u->mAllocatedBytes);
+                u->mPeakBlockBytes = std::max(u->mPeakBlockBytes, u->mBlockBytes);
+            }
+        }
+    }
+
+    memory_allocator::allocation memory_allocator::allocate(const vk::MemoryRequirements&   requirements,
+                                                            vk::MemoryPropertyFlags         propertyFlags,
+                                                            resource_kind                   kind)
+    {
+        std::uint32_t typeIndex = 0;
+        for (; typeIndex < mMemoryProperties.memoryTypeCount; ++typeIndex) {
+            if ((requirements.memoryTypeBits & (1u << typeIndex))
+                && (mMemoryProperties.memoryTypes[typeIndex].propertyFlags & propertyFlags) == propertyFlags) {
+                break;
+            }
+        }
+        if (typeIndex == mMemoryProperties.memoryTypeCount) {
+            return allocation();
+        }
+
+        const auto typeFlags = mMemoryProperties.memoryTypes[typeIndex].propertyFlags;
+
+        vk::DeviceSize alignment = std::max<vk::DeviceSize>(requirements.alignment, 1);
+        vk::DeviceSize size = requirements.size;
+        if (isNonCoherent(typeFlags)) {
+            alignment = align_up(alignment, kMaxNonCoherentAtomSize);
+            size = align_up(size, kMaxNonCoherentAtomSize);
+        }
+
+        const std::uint32_t poolIndex = 2 * typeIndex + kind;
+        const vk::DeviceSize blockSize = getBlockSize(typeIndex);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        pool& p = mPools[poolIndex];
+
+        if (size > blockSize / 2) {
+            block& dedicated = createBlock(p, size, true);
+            return makeAllocation(poolIndex, dedicated, 0, size);
+        }
+
+        vk::DeviceSize offset = 0;
+        for (auto& b : p.mBlocks) {
+            if (!b->mIsDedicated && allocateFromBlock(*b, size, alignment, offset)) {
+                return makeAllocation(poolIndex, *b, offset, size);
+            }
+        }
+
+        block& newBlock = createBlock(p, blockSize, false);
+        const bool isAllocated = allocateFromBlock(newBlock, size, alignment, offset);
+        assert(isAllocated);
+        (void)isAllocated;
+
+        return makeAllocation(poolIndex, newBlock, offset, size);
+    }
+
+    memory_allocator::allocation memory_allocator::importHostMemory(void*             hostPointer,
+                                                                    vk::DeviceSize    size,
+                                                                    std::uint32_t     memoryTypeBits)
+    {
+        std::uint32_t typeIndex = 0;
+        for (; typeIndex < mMemoryProperties.memoryTypeCount; ++typeIndex) {
+            if ((memoryTypeBits & (1u << typeIndex))
+                && (mMemoryProperties.memoryTypes[typeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible)) {
+                break;
+            }
+        }
+        if (typeIndex == mMemoryProperties.memoryTypeCount) {
+            return allocation();
+        }
+
+        const std::uint32_t poolIndex = 2 * typeIndex + kResource_linear;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        block& imported = createBlock(mPools[poolIndex], size, true, hostPointer);
+        return makeAllocation(poolIndex, imported, 0, size);
+    }
+
+    memory_allocator::allocation memory_allocator::makeAllocation(std::uint32_t     poolIndex,
+                                                                  block&            b,
+                                                                  vk::DeviceSize    offset,
+                                                                  vk::DeviceSize    size)
+    {
+        ++b.mAllocationCount;
+        updateUsage(mPools[poolIndex], size, 0, false);
+
+        allocation result;
+        result.mAllocator = shared_from_this();
+        result.mPool = poolIndex;
+        result.mBlockId = b.mId;
+        result.mMemory = *b.mMemory;
+        result.mOffset = offset;
+        result.mSize = size;
+        result.mPropertyFlags = mMemoryProperties.memoryTypes[mPools[poolIndex].mMemoryTypeIndex].propertyFlags;
+        result.mMapped = (b.mMapped ? static_cast<std::uint8_t*>(b.mMapped) + offset : nullptr);
+        return result;
+    }
+
+    bool memory_allocator::allocateFromBlock(block&          b,
+                                             vk::DeviceSize  size,
+                                             vk::DeviceSize  alignment,
+                                             vk::DeviceSize& offset)
+    {
+        // first fit
+        for (auto i = b.mFree.begin(); i != b.mFree.end(); ++i) {
+            const vk::DeviceSize rangeBegin = i->first;
+            const vk::DeviceSize rangeEnd = i->first + i->second;
+            const vk::DeviceSize aligned = align_up(rangeBegin, alignment);
+
+            if (aligned + size > rangeEnd) {
+                continue;
+            }
+
+            b.mFree.erase(i);
+            if (aligned > rangeBegin) {
+                b.mFree[rangeBegin] = aligned - rangeBegin;
+            }
+            if (aligned + size < rangeEnd) {
+                b.mFree[aligned + size] = rangeEnd - (aligned + size);
+            }
+
+            offset = aligned;
+            return true;
+        }
+
+        return false;
+    }
+
+    memory_allocator::block& memory_allocator::createBlock(pool& p, vk::DeviceSize size, bool isDedicated, void* importedHostPointer)
+    {
+        std::unique_ptr<block> newBlock(new block);
+        newBlock->mId = mNextBlockId++;
+        newBlock->mSize = size;
+        newBlock->mIsDedicated = isDedicated;
+        newBlock->mIsImported = (nullptr != importedHostPointer);
+
+        vk::ImportMemoryHostPointerInfoEXT importInfo(vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT, importedHostPointer);
+
+        vk::MemoryAllocateInfo allocInfo;
+        allocInfo.setAllocationSize(size)
+                .setMemoryTypeIndex(p.mMemoryTypeIndex)
+                .setPNext(newBlock->mIsImported ? &importInfo : nullptr);
+        newBlock->mMemory = mDevice.allocateMemoryUnique(allocInfo);
+
+        if (newBlock->mIsImported) {
+            newBlock->mMapped = importedHostPointer;
+        }
+        else if (mMemoryProperties.memoryTypes[p.mMemoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+            newBlock->mMapped = mDevice.mapMemory(*newBlock->mMemory, 0, VK_WHOLE_SIZE, vk::MemoryMapFlags());
+        }
+
+        if (!isDedicated) {
+            newBlock->mFree[0] = size;
+        }
+
+        updateUsage(p, 0, size, false);
+
+        p.mBlocks.push_back(std::move(newBlock));
+        return *p.mBlocks.back();
+    }
+
+    void memory_allocator::destroyBlock(pool& p, std::size_t blockId)
+    {
+        auto found = std::find_if(p.mBlocks.begin(), p.mBlocks.end(), [blockId](const std::unique_ptr<block>& b) {
+            return b->mId == blockId;
+        });
+        assert(found != p.mBlocks.end());
+
+        if ((*found)->mMapped && !(*found)->mIsImported) {
+            mDevice.unmapMemory(*(*found)->mMemory);
+        }
+        updateUsage(p, 0, (*found)->mSize, true);
+        p.mBlocks.erase(found);
+    }
+
+    void memory_allocator::free(const allocation& a)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        pool& p = mPools[a.mPool];
+        auto found = std::find_if(p.mBlocks.begin(), p.mBlocks.end(), [&a](const std::unique_ptr<block>& b) {
+            return b->mId == a.mBlockId;
+        });
+        // free is reached from allocation destructors, so it must not throw. An unknown block is a
+        // bug; in release builds its memory is simply leaked.
+        assert(found != p.mBlocks.end());
+        if (found == p.mBlocks.end()) {
+            return;
+        }
+
+        block& b = **found;
+        --b.mAllocationCount;
+        updateUsage(p, a.mSize, 0, true);
+
+        if (b.mIsDedicated) {
+            destroyBlock(p, b.mId);
+            return;
+        }
+
+        // return the range to the free list, coalescing it with its neighbours
+        vk::DeviceSize offset = a.mOffset;
+        vk::DeviceSize size = a.mSize;
+
+        auto next = b.mFree.lower_bound(offset);
+        if (next != b.mFree.end() && offset + size == next->first) {
+            size += next->second;
+            next = b.mFree.erase(next);
+        }
+        if (next != b.mFree.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                offset = prev->first;
+                size += prev->second;
+                b.mFree.erase(prev);
+            }
+        }
+        b.mFree[offset] = size;
+
+        // keep one empty block per pool, so that a resource repeatedly created and destroyed does
+        // not allocate memory each time
+        if (0 == b.mAllocationCount) {
+            const bool hasOtherEmptyBlock = std::any_of(p.mBlocks.begin(), p.mBlocks.end(), [&b](const std::unique_ptr<block>& other) {
+                return other.get() != &b && !other->mIsDedicated && 0 == other->mAllocationCount;
+            });
+            if (hasOtherEmptyBlock) {
+                destroyBlock(p, b.mId);
+            }
+        }
+    }
+
+} // namespace vulkan_utils
@@ -0,0 +1,210 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef VULKAN_UTILS_MEMORY_ALLOCATOR_HPP
+#define VULKAN_UTILS_MEMORY_ALLOCATOR_HPP
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vulkan_utils {
+
+    // A memory_allocator sub-allocates resources from large blocks of device memory, so that
+    // creating a resource rarely calls vkAllocateMemory. Each memory type has its own pools of
+    // blocks, and free space within a block is tracked as a list of ranges which are coalesced
+    // as they are freed.
+    //
+    // Linear resources (buffers) and optimal tiling resources (images) are kept in separate
+    // blocks, so that bufferImageGranularity never needs to be applied between neighbours.
+    // Resources too large to share a block get a dedicated allocation of their own.
+    //
+    // Host visible blocks are mapped once, for their lifetime, since memory shared by several
+    // resources cannot be mapped by each of them. Sub-allocations from host visible memory which
+    // is not coherent are aligned to kMaxNonCoherentAtomSize, so that each can be flushed and
+    // invalidated without touching its neighbours.
+    //
+    // An allocator may be used from several threads.
+    class memory_allocator : public std::enable_shared_from_this<memory_allocator> {
+    public:
+        // The largest nonCoherentAtomSize permitted by the Vulkan specification
+        static const vk::DeviceSize kMaxNonCoherentAtomSize = 256;
+
+        enum resource_kind {
+            kResource_linear,   // buffers, and images with linear tiling
+            kResource_optimal   // images with optimal tiling
+        };
+
+        class allocation {
+        public:
+                                allocation();
+
+                                allocation(allocation&& other);
+
+                                ~allocation();
+
+            allocation&         operator=(allocation&& other);
+
+            void                swap(allocation& other);
+
+            explicit operator   bool() const { return (bool)mAllocator; }
+
+            vk::DeviceMemory    getMemory() const { return mMemory; }
+            vk::DeviceSize      getOffset() const { return mOffset; }
+            vk::DeviceSize      getSize() const { return mSize; }
+
+            vk::MemoryPropertyFlags getPropertyFlags() const { return mPropertyFlags; }
+
+            // The host address of the allocation, or nullptr if its memory is not host visible
+            void*               data() const { return mMapped; }
+
+            // Make host writes to the allocation available to the device, and device writes
+            // available to the host. Both do nothing if the memory is host coherent. The ranged
+            // forms are relative to the allocation, and are widened to kMaxNonCoherentAtomSize
+            // boundaries, which are multiples of any device's nonCoherentAtomSize.
+            void                flush() const;
+            void                flush(vk::DeviceSize offset, vk::DeviceSize size) const;
+            void                invalidate() const;
+            void                invalidate(vk::DeviceSize offset, vk::DeviceSize size) const;
+
+            bool                isCoherent() const { return (bool)(mPropertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent); }
+
+            // Return the allocation to its allocator
+            void                reset();
+
+        private:
+            friend class memory_allocator;
+
+            vk::MappedMemoryRange   getMappedRange(vk::DeviceSize offset, vk::DeviceSize size) const;
+
+        private:
+            std::shared_ptr<memory_allocator>   mAllocator;
+            std::uint32_t           mPool       = 0;
+            std::size_t             mBlockId    = 0;
+            vk::DeviceMemory        mMemory;
+            vk::DeviceSize          mOffset     = 0;
+            vk::DeviceSize          mSize       = 0;
+            vk::MemoryPropertyFlags mPropertyFlags;
+            void*                   mMapped     = nullptr;
+        };
+
+        struct statistics {
+            std::uint32_t   mBlockCount         = 0;    // calls to vkAllocateMemory outstanding
+            std::uint32_t   mDedicatedCount     = 0;    // of which are dedicated allocations
+            std::uint32_t   mAllocationCount    = 0;
+            vk::DeviceSize  mBlockBytes         = 0;
+            vk::DeviceSize  mAllocatedBytes     = 0;
+        };
+
+        // Live and peak use of memory, maintained as resources come and go. Peaks are the
+        // highest values since the allocator was created or resetPeakUsage was last called.
+        struct usage {
+            std::uint32_t   mAllocationCount        = 0;
+            std::uint32_t   mPeakAllocationCount    = 0;
+            vk::DeviceSize  mAllocatedBytes         = 0;    // held by resources
+            vk::DeviceSize  mPeakAllocatedBytes     = 0;
+            vk::DeviceSize  mBlockBytes             = 0;    // allocated from the device, including free space in blocks
+            vk::DeviceSize  mPeakBlockBytes         = 0;
+        };
+
+        struct usage_report {
+            usage               mTotal;
+            usage               mKinds[2];      // indexed by resource_kind
+            std::vector<usage>  mMemoryTypes;   // indexed by memory type
+        };
+
+    public:
+                        memory_allocator(vk::Device                                 device,
+                                         const vk::PhysicalDeviceMemoryProperties&  memoryProperties,
+                                         vk::DeviceSize                             blockSize = 0);
+
+                        memory_allocator(const memory_allocator& other) = delete;
+
+                        ~memory_allocator();
+
+        memory_allocator&   operator=(const memory_allocator& other) = delete;
+
+        // Allocate memory meeting the requirements, from the first memory type with all of the
+        // property flags. Return an empty allocation if there is no such memory type.
+        allocation      allocate(const vk::MemoryRequirements&  requirements,
+                                 vk::MemoryPropertyFlags        propertyFlags,
+                                 resource_kind                  kind);
+
+        // Import host memory, which must stay valid for the lifetime of the allocation, as a
+        // dedicated block of the first host visible memory type in memoryTypeBits. The memory
+        // must have been allocated for import with VK_EXT_external_memory_host. Return an empty
+        // allocation if there is no such memory type. The allocation's data() is hostPointer.
+        allocation      importHostMemory(void*                  hostPointer,
+                                         vk::DeviceSize         size,
+                                         std::uint32_t          memoryTypeBits);
+
+        // Return the allocator shared by all resources created on the device, creating it if
+        // necessary. It lives for as long as any of its allocations.
+        static std::shared_ptr<memory_allocator>    getDefault(vk::Device                                   device,
+                                                               const vk::PhysicalDeviceMemoryProperties&    memoryProperties);
+
+        vk::Device      getDevice() const { return mDevice; }
+        vk::DeviceSize  getBlockSize(std::uint32_t memoryTypeIndex) const;
+
+        statistics      getStatistics() const;
+
+        usage_report    getUsage() const;
+
+        // Lower each peak to the current value, to begin measuring the peaks of some work
+        void            resetPeakUsage();
+
+    private:
+        struct block {
+            std::size_t                         mId         = 0;
+            vk::UniqueDeviceMemory              mMemory;
+            vk::DeviceSize                      mSize       = 0;
+            void*                               mMapped     = nullptr;
+            bool                                mIsDedicated = false;
+            bool                                mIsImported = false;   // mMapped is the imported host memory
+            std::map<vk::DeviceSize, vk::DeviceSize>    mFree;  // offset -> size
+            std::uint32_t                       mAllocationCount = 0;
+        };
+
+        // the blocks of one memory type holding one kind of resource
+        struct pool {
+            std::uint32_t                       mMemoryTypeIndex = 0;
+            resource_kind                       mKind = kResource_linear;
+            std::vector<std::unique_ptr<block>> mBlocks;
+        };
+
+    private:
+        void            free(const allocation& a);
+
+        block&          createBlock(pool& p, vk::DeviceSize size, bool isDedicated, void* importedHostPointer = nullptr);
+        void            destroyBlock(pool& p, std::size_t blockId);
+
+        allocation      makeAllocation(std::uint32_t poolIndex, block& b, vk::DeviceSize offset, vk::DeviceSize size);
+
+        // Add to (or, if isFreed, subtract from) the usage of the pool's kind and memory type
+        void            updateUsage(const pool& p, vk::DeviceSize allocatedBytes, vk::DeviceSize blockBytes, bool isFreed);
+
+        static bool     allocateFromBlock(block& b, vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset);
+
+    private:
+        vk::Device                          mDevice;
+        vk::PhysicalDeviceMemoryProperties  mMemoryProperties;
+        vk::DeviceSize                      mBlockSize  = 0;
+
+        mutable std::mutex                  mMutex;
+        std::vector<pool>                   mPools;     // indexed by memory type, then resource kind
+        std::size_t                         mNextBlockId = 1;
+        usage_report                        mUsage;
+    };
+
+    inline void swap(memory_allocator::allocation& lhs, memory_allocator::allocation& rhs)
+    {
+        lhs.swap(rhs);
+    }
+}
+
+#endif //VULKAN_UTILS_MEMORY_ALLOCATOR_HPP
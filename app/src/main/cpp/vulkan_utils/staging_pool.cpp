@@ -0,0 +1,124 @@
+//
+// Created on 10/18/26.
+//
+
+#include "staging_pool.hpp"
+
+#include <utility>
+
+namespace {
+
+    const vk::BufferUsageFlags kStagingUsage = vk::BufferUsageFlagBits::eStorageBuffer
+                                             | vk::BufferUsageFlagBits::eTransferSrc
+                                             | vk::BufferUsageFlagBits::eTransferDst;
+
+}
+
+namespace vulkan_utils {
+
+    const vk::DeviceSize staging_pool::kMinBucketSize;
+    const vk::DeviceSize staging_pool::kFineBucketSize;
+    const std::size_t staging_pool::kDefaultMaxIdlePerBucket;
+
+    staging_pool::staging_pool(vk::Device                                   device,
+                               const vk::PhysicalDeviceMemoryProperties&    memoryProperties,
+                               std::size_t                                  maxIdlePerBucket)
+            : mDevice(device),
+              mMemoryProperties(memoryProperties),
+              mMaxIdlePerBucket(maxIdlePerBucket)
+    {
+    }
+
+    vk::DeviceSize staging_pool::getBucketSize(vk::DeviceSize num_bytes)
+    {
+        vk::DeviceSize result = kMinBucketSize;
+        while (result < num_bytes && result < kFineBucketSize) {
+            result *= 2;
+        }
+        if (result >= num_bytes) {
+            return result;
+        }
+
+        // Find the power of two just below num_bytes, and round up to a quarter of it
+        vk::DeviceSize octave = kFineBucketSize;
+        while (octave * 2 < num_bytes) {
+            octave *= 2;
+        }
+
+        const vk::DeviceSize step = octave / 4;
+        return (num_bytes + step - 1) / step * step;
+    }
+
+    staging_pool::pooled_buffer staging_pool::acquire(vk::DeviceSize num_bytes)
+    {
+        const vk::DeviceSize bucketSize = getBucketSize(num_bytes);
+
+        std::unique_ptr<buffer> result;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            auto found = mIdle.find(bucketSize);
+            if (found != mIdle.end() && !found->second.empty()) {
+                result = std::move(found->second.back());
+                found->second.pop_back();
+            }
+        }
+
+        if (!result) {
+            result.reset(new buffer(mDevice, mMemoryProperties, bucketSize, kStagingUsage));
+        }
+
+        auto self = shared_from_this();
+        return pooled_buffer(result.release(), [self](buffer* b) { self->release(b); });
+    }
+
+    staging_pool::pooled_buffer staging_pool::acquire(const image& forImage)
+    {
+        return acquire(computeImageByteSize(forImage));
+    }
+
+    void staging_pool::release(buffer* b)
+    {
+        // a buffer which is not kept is destroyed after the lock is dropped
+        std::unique_ptr<buffer> released(b);
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto& bucket = mIdle[released->getSize()];
+        if (bucket.size() < mMaxIdlePerBucket) {
+            bucket.push_back(std::move(released));
+        }
+    }
+
+    void staging_pool::trim()
+    {
+        decltype(mIdle) idle;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            idle.swap(mIdle);
+        }
+    }
+
+    std::size_t staging_pool::getIdleCount() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        std::size_t result = 0;
+        for (auto& bucket : mIdle) {
+            result += bucket.second.size();
+        }
+        return result;
+    }
+
+    vk::DeviceSize staging_pool::getIdleBytes() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        vk::DeviceSize result = 0;
+        for (auto& bucket : mIdle) {
+            result += bucket.first * bucket.second.size();
+        }
+        return result;
+    }
+
+} // namespace vulkan_utils
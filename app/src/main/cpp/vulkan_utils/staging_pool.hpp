@@ -0,0 +1,75 @@
+//
+// Created on 10/18/26.
+//
+
+#ifndef VULKAN_UTILS_STAGING_POOL_HPP
+#define VULKAN_UTILS_STAGING_POOL_HPP
+
+#include "vulkan_utils.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace vulkan_utils {
+
+    // A staging_pool recycles the host visible buffers through which images are uploaded and
+    // read back, so that a new image need not create and destroy a buffer of its own. Buffers
+    // are bucketed by size, in powers of two up to kFineBucketSize and in quarter steps between
+    // powers of two above it, so that a large frame wastes at most a quarter of its size. A
+    // released buffer is kept for reuse unless its bucket already holds maxIdlePerBucket buffers.
+    //
+    // A buffer is returned to the pool when its pooled_buffer is destroyed, which must not happen
+    // until the device has finished with it. Its contents are not cleared. A pool may be used
+    // from several threads.
+    class staging_pool : public std::enable_shared_from_this<staging_pool> {
+    public:
+        typedef std::unique_ptr<buffer, std::function<void (buffer*)> > pooled_buffer;
+
+        static const vk::DeviceSize kMinBucketSize = 4096;
+        static const vk::DeviceSize kFineBucketSize = 1024 * 1024;
+        static const std::size_t    kDefaultMaxIdlePerBucket = 4;
+
+    public:
+                        staging_pool(vk::Device                                 device,
+                                     const vk::PhysicalDeviceMemoryProperties&  memoryProperties,
+                                     std::size_t                                maxIdlePerBucket = kDefaultMaxIdlePerBucket);
+
+                        staging_pool(const staging_pool& other) = delete;
+
+        staging_pool&   operator=(const staging_pool& other) = delete;
+
+        // Return a host cached buffer of at least num_bytes, which may be used as a transfer
+        // source or destination, or as a storage buffer. Its size is that of its bucket.
+        pooled_buffer   acquire(vk::DeviceSize num_bytes);
+
+        // Return a buffer large enough to hold every texel of the image, tightly packed
+        pooled_buffer   acquire(const image& forImage);
+
+        // Destroy every idle buffer
+        void            trim();
+
+        std::size_t     getIdleCount() const;
+        vk::DeviceSize  getIdleBytes() const;
+
+    private:
+        void            release(buffer* b);
+
+        static vk::DeviceSize   getBucketSize(vk::DeviceSize num_bytes);
+
+    private:
+        vk::Device                          mDevice;
+        vk::PhysicalDeviceMemoryProperties  mMemoryProperties;
+        std::size_t                         mMaxIdlePerBucket = kDefaultMaxIdlePerBucket;
+
+        mutable std::mutex                  mMutex;
+        std::map<vk::DeviceSize, std::vector<std::unique_ptr<buffer> > >   mIdle;  // bucket size -> buffers
+    };
+}
+
+#endif //VULKAN_UTILS_STAGING_POOL_HPP
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <ios>
 #include <iostream>
 #include <iterator>
@@ -17,6 +18,11 @@
 #include <utility>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 VkResult vkCreateDebugReportCallbackEXT(
         VkInstance                                  instance,
         const VkDebugReportCallbackCreateInfoEXT*   pCreateInfo,
@@ -260,6 +266,52 @@ namespace {
     {
         throw std::runtime_error(what);
     }
+
+    // The memory property flags to try, in order, for a buffer with the placement
+    std::vector<vk::MemoryPropertyFlags> getPlacementPreferences(vulkan_utils::memory_placement placement)
+    {
+        switch (placement) {
+            case vulkan_utils::kPlacement_hostVisible:
+                return { vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
+                         vk::MemoryPropertyFlagBits::eHostVisible };
+
+            case vulkan_utils::kPlacement_deviceLocal:
+                return { vk::MemoryPropertyFlagBits::eDeviceLocal,
+                         vk::MemoryPropertyFlags() };
+
+            case vulkan_utils::kPlacement_hostCached:
+            default:
+                return { vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached,
+                         vk::MemoryPropertyFlagBits::eHostVisible };
+        }
+    }
+
+    vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Record whichever of the barriers preceding a transfer are required
+    void recordTransferBarrier(vk::CommandBuffer                commandBuffer,
+                               const vk::BufferMemoryBarrier&   bufferBarrier,
+                               const vk::ImageMemoryBarrier&    imageBarrier)
+    {
+        const bool isBufferBarrierRequired = vulkan_utils::isBarrierRequired(bufferBarrier);
+        const bool isImageBarrierRequired = vulkan_utils::isBarrierRequired(imageBarrier);
+        if (!isBufferBarrierRequired && !isImageBarrierRequired) {
+            return;
+        }
+
+        const vk::AccessFlags srcAccess = (isBufferBarrierRequired ? bufferBarrier.srcAccessMask : vk::AccessFlags())
+                                          | (isImageBarrierRequired ? imageBarrier.srcAccessMask : vk::AccessFlags());
+
+        commandBuffer.pipelineBarrier(vulkan_utils::getAccessStages(srcAccess),
+                                      vk::PipelineStageFlagBits::eTransfer,
+                                      vk::DependencyFlags(),
+                                      nullptr,                                                  // memory barriers
+                                      { isBufferBarrierRequired ? 1u : 0u, &bufferBarrier },    // buffer memory barriers
+                                      { isImageBarrierRequired ? 1u : 0u, &imageBarrier });     // image memory barriers
+    }
 }
 
 namespace vulkan_utils {
@@ -298,29 +350,87 @@ namespace vulkan_utils {
 
     buffer createUniformBuffer(vk::Device device,
                                const vk::PhysicalDeviceMemoryProperties memoryProperties,
-                               vk::DeviceSize                           num_bytes)
+                               vk::DeviceSize                           num_bytes,
+                               memory_placement                         placement,
+                               transfer_fn                              transfer)
     {
         return buffer(device,
                       memoryProperties,
                       num_bytes,
-                      vk::BufferUsageFlagBits::eUniformBuffer);
+                      vk::BufferUsageFlagBits::eUniformBuffer,
+                      placement,
+                      transfer);
     }
 
     buffer createStorageBuffer(vk::Device device,
                                const vk::PhysicalDeviceMemoryProperties memoryProperties,
-                               vk::DeviceSize                           num_bytes)
+                               vk::DeviceSize                           num_bytes,
+                               memory_placement                         placement,
+                               transfer_fn                              transfer)
     {
         return buffer(device,
                       memoryProperties,
                       num_bytes,
-                      vk::BufferUsageFlagBits::eStorageBuffer);
+                      vk::BufferUsageFlagBits::eStorageBuffer,
+                      placement,
+                      transfer);
     }
 
-    buffer createStagingBuffer(vk::Device                               device,
-                               const vk::PhysicalDeviceMemoryProperties memoryProperties,
-                               const image&                             image,
-                               bool                                     isForInitialzation,
-                               bool                                     isForReadback)
+    bool host_memory_importer::canImport(const void* hostPointer, vk::DeviceSize num_bytes) const
+    {
+        return vkGetMemoryHostPointerPropertiesEXT
+               && mMinImportedHostPointerAlignment > 0
+               && 0 == reinterpret_cast<std::uintptr_t>(hostPointer) % mMinImportedHostPointerAlignment
+               && 0 == num_bytes % mMinImportedHostPointerAlignment;
+    }
+
+    buffer createBufferFromFile(vk::Device                                 device,
+                                const vk::PhysicalDeviceMemoryProperties   memoryProperties,
+                                const std::string&                         path,
+                                vk::BufferUsageFlags                       usage,
+                                const host_memory_importer&                importer)
+    {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            fail_runtime_error("cannot open file for buffer");
+        }
+        std::shared_ptr<void> closer(nullptr, [fd](void*) { close(fd); });
+
+        struct stat fileStat;
+        if (0 != fstat(fd, &fileStat) || 0 == fileStat.st_size) {
+            fail_runtime_error("cannot read size of file for buffer");
+        }
+
+        // Reserve the whole of the aligned region, so that no part of it lies beyond the end of
+        // the file, then map the file over the start of it
+        const vk::DeviceSize fileSize = fileStat.st_size;
+        const vk::DeviceSize alignment = std::max<vk::DeviceSize>(importer.mMinImportedHostPointerAlignment,
+                                                                  sysconf(_SC_PAGESIZE));
+        const std::size_t mappedSize = alignUp(fileSize, alignment);
+
+        void* region = mmap(nullptr, mappedSize + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED == region) {
+            fail_runtime_error("cannot reserve host memory for file");
+        }
+
+        // mmap only aligns to the page size, so trim the reservation to the import alignment
+        char* const reserved = static_cast<char*>(region);
+        char* const aligned = reinterpret_cast<char*>(alignUp(reinterpret_cast<std::uintptr_t>(reserved), alignment));
+        if (aligned > reserved) {
+            munmap(reserved, aligned - reserved);
+        }
+        munmap(aligned + mappedSize, reserved + alignment - aligned);
+
+        std::shared_ptr<void> owner(aligned, [mappedSize](void* p) { munmap(p, mappedSize); });
+
+        if (MAP_FAILED == mmap(aligned, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0)) {
+            fail_runtime_error("cannot map file for buffer");
+        }
+
+        return buffer(device, memoryProperties, aligned, mappedSize, usage, importer, std::move(owner));
+    }
+
+    vk::DeviceSize computeImageByteSize(const image& image)
     {
         const auto found = kFormatSizeTable.find((VkFormat)image.getFormat());
         if (found == kFormatSizeTable.end()) {
@@ -331,7 +441,16 @@ namespace vulkan_utils {
         }
 
         const auto extent = image.getExtent();
-        const std::size_t num_bytes = found->second * extent.width * extent.height * extent.depth;
+        return found->second * extent.width * extent.height * extent.depth;
+    }
+
+    buffer createStagingBuffer(vk::Device                               device,
+                               const vk::PhysicalDeviceMemoryProperties memoryProperties,
+                               const image&                             image,
+                               bool                                     isForInitialzation,
+                               bool                                     isForReadback)
+    {
+        const vk::DeviceSize num_bytes = computeImageByteSize(image);
 
         const vk::BufferUsageFlags usageFlags = vk::BufferUsageFlagBits::eStorageBuffer
                                               | (isForInitialzation ? vk::BufferUsageFlagBits::eTransferSrc : vk::BufferUsageFlagBits())
@@ -346,42 +465,103 @@ namespace vulkan_utils {
     buffer::buffer(vk::Device                               device,
                    const vk::PhysicalDeviceMemoryProperties memoryProperties,
                    vk::DeviceSize                           num_bytes,
-                   vk::BufferUsageFlags                     usage) :
+                   vk::BufferUsageFlags                     usage,
+                   memory_placement                         placement,
+                   transfer_fn                              transfer,
+                   vk::ArrayProxy<const std::uint32_t>      sharingQueueFamilies) :
             buffer()
     {
         mUsage = usage;
         mDevice = device;
+        mMemoryProperties = memoryProperties;
         mSize = num_bytes;
+        mPlacement = placement;
+        mTransfer = std::move(transfer);
+
+        if (kPlacement_deviceLocal == mPlacement) {
+            mUsage |= vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst;
+        }
 
         // Allocate the buffer
         vk::BufferCreateInfo buf_info;
         buf_info.setUsage(mUsage)
                 .setSize(mSize)
                 .setSharingMode(vk::SharingMode::eExclusive);
+        if (sharingQueueFamilies.size() > 1) {
+            buf_info.setSharingMode(vk::SharingMode::eConcurrent)
+                    .setQueueFamilyIndexCount(sharingQueueFamilies.size())
+                    .setPQueueFamilyIndices(sharingQueueFamilies.data());
+        }
 
         mBuffer = mDevice.createBufferUnique(buf_info);
 
         const auto memReqs = mDevice.getBufferMemoryRequirements(*mBuffer);
-        mDeviceMemory = allocate_device_memory(mDevice,
-                                               memReqs,
-                                               memoryProperties,
-                                               vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached);
-
-        if (!mDeviceMemory)
-        {
-            mDeviceMemory = allocate_device_memory(mDevice,
-                                                   memReqs,
-                                                   memoryProperties,
-                                                   vk::MemoryPropertyFlagBits::eHostVisible);
+        const auto allocator = memory_allocator::getDefault(mDevice, memoryProperties);
+        for (auto flags : getPlacementPreferences(mPlacement)) {
+            mMemory = allocator->allocate(memReqs, flags, memory_allocator::kResource_linear);
+            if (mMemory) break;
         }
 
-        if (!mDeviceMemory)
+        if (!mMemory)
         {
             fail_runtime_error("Cannot allocate device memory");
         }
 
         // Bind the memory to the buffer object
-        mDevice.bindBufferMemory(*mBuffer, *mDeviceMemory, 0);
+        mDevice.bindBufferMemory(*mBuffer, mMemory.getMemory(), mMemory.getOffset());
+    }
+
+    buffer::buffer(vk::Device                               device,
+                   const vk::PhysicalDeviceMemoryProperties memoryProperties,
+                   void*                                    hostPointer,
+                   vk::DeviceSize                           num_bytes,
+                   vk::BufferUsageFlags                     usage,
+                   const host_memory_importer&              importer,
+                   std::shared_ptr<void>                    hostMemoryOwner) :
+            buffer()
+    {
+        if (importer.canImport(hostPointer, num_bytes)) {
+            const auto handleType = vk::ExternalMemoryHandleTypeFlagBits::eHostAllocationEXT;
+
+            vk::MemoryHostPointerPropertiesEXT hostProps;
+            if (vk::Result::eSuccess == device.getMemoryHostPointerPropertiesEXT(handleType, hostPointer, &hostProps, importer)) {
+                mUsage = usage;
+                mDevice = device;
+                mMemoryProperties = memoryProperties;
+                mSize = num_bytes;
+                mPlacement = kPlacement_hostVisible;
+                mHostMemoryOwner = std::move(hostMemoryOwner);
+
+                vk::ExternalMemoryBufferCreateInfo externalInfo(handleType);
+
+                vk::BufferCreateInfo buf_info;
+                buf_info.setPNext(&externalInfo)
+                        .setUsage(mUsage)
+                        .setSize(mSize)
+                        .setSharingMode(vk::SharingMode::eExclusive);
+                mBuffer = mDevice.createBufferUnique(buf_info);
+
+                const auto memReqs = mDevice.getBufferMemoryRequirements(*mBuffer);
+                const auto allocator = memory_allocator::getDefault(mDevice, memoryProperties);
+                try {
+                    mMemory = allocator->importHostMemory(hostPointer, mSize, memReqs.memoryTypeBits & hostProps.memoryTypeBits);
+                }
+                catch (const vk::SystemError&) {
+                    // some drivers refuse memory they did not expect, such as file mappings
+                }
+
+                if (mMemory) {
+                    mDevice.bindBufferMemory(*mBuffer, mMemory.getMemory(), mMemory.getOffset());
+                    mIsImported = true;
+                    return;
+                }
+            }
+        }
+
+        // Fall back to copying the memory
+        buffer copy(device, memoryProperties, num_bytes, usage, kPlacement_hostVisible);
+        std::memcpy(copy.map(kMap_write).get(), hostPointer, num_bytes);
+        swap(copy);
     }
 
     buffer::buffer(buffer&& other) :
@@ -405,54 +585,66 @@ namespace vulkan_utils {
 
         swap(mUsage, other.mUsage);
         swap(mIsMapped, other.mIsMapped);
+        swap(mMapMode, other.mMapMode);
+
+        swap(mSize, other.mSize);
+        swap(mPlacement, other.mPlacement);
+        swap(mTransfer, other.mTransfer);
+        swap(mStaging, other.mStaging);
 
         swap(mDevice, other.mDevice);
-        swap(mDeviceMemory, other.mDeviceMemory);
+        swap(mMemoryProperties, other.mMemoryProperties);
+        swap(mIsImported, other.mIsImported);
+        swap(mHostMemoryOwner, other.mHostMemoryOwner);
+        swap(mMemory, other.mMemory);
         swap(mBuffer, other.mBuffer);
+        swap(mAccess, other.mAccess);
     }
 
-    vk::BufferMemoryBarrier buffer::prepareForShaderRead()
+    vk::BufferMemoryBarrier buffer::prepare(vk::AccessFlags access)
     {
         vk::BufferMemoryBarrier result;
+        result.setSrcAccessMask(mAccess.access(access))
+              .setDstAccessMask(access)
+              .setSize(VK_WHOLE_SIZE)
+              .setBuffer(*mBuffer);
+        return result;
+    }
 
+    vk::BufferMemoryBarrier buffer::prepareForShaderRead()
+    {
         if (!(mUsage & (vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer)))
         {
             fail_runtime_error("buffer was not constructed as either a storage or uniform buffer");
         }
 
-        result.setSrcAccessMask(vk::AccessFlagBits::eHostWrite | vk::AccessFlagBits::eShaderWrite)
-              .setSize(VK_WHOLE_SIZE)
-              .setBuffer(*mBuffer);
-
-        if (mUsage & vk::BufferUsageFlagBits::eTransferDst)
-            result.srcAccessMask |= vk::AccessFlagBits::eTransferWrite;
-
+        vk::AccessFlags access;
         if (mUsage & vk::BufferUsageFlagBits::eUniformBuffer)
-            result.dstAccessMask |= vk::AccessFlagBits::eUniformRead;
+            access |= vk::AccessFlagBits::eUniformRead;
         if (mUsage & vk::BufferUsageFlagBits::eStorageBuffer)
-            result.dstAccessMask |= vk::AccessFlagBits::eShaderRead;
+            access |= vk::AccessFlagBits::eShaderRead;
 
-        return result;
+        return prepare(access);
     }
 
     vk::BufferMemoryBarrier buffer::prepareForShaderWrite()
     {
-        vk::BufferMemoryBarrier result;
-
         if (!(mUsage & vk::BufferUsageFlagBits::eStorageBuffer))
         {
             fail_runtime_error("buffer was not constructed as a storage buffer");
         }
 
-        result.setSrcAccessMask(vk::AccessFlagBits::eShaderRead)
-                .setDstAccessMask(vk::AccessFlagBits::eShaderWrite)
-                .setSize(VK_WHOLE_SIZE)
-                .setBuffer(*mBuffer);
+        return prepare(vk::AccessFlagBits::eShaderWrite);
+    }
 
-        if (mUsage & vk::BufferUsageFlagBits::eTransferSrc)
-            result.srcAccessMask |= (vk::AccessFlagBits::eTransferRead);
+    vk::BufferMemoryBarrier buffer::prepareForShaderReadWrite()
+    {
+        if (!(mUsage & vk::BufferUsageFlagBits::eStorageBuffer))
+        {
+            fail_runtime_error("buffer was not constructed as a storage buffer");
+        }
 
-        return result;
+        return prepare(vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
     }
 
     vk::BufferMemoryBarrier buffer::prepareForTransferSrc()
@@ -462,18 +654,7 @@ namespace vulkan_utils {
             fail_runtime_error("buffer was not constructed as a potential transfer source");
         }
 
-        vk::BufferMemoryBarrier result;
-        result.setSrcAccessMask(vk::AccessFlagBits::eHostWrite)
-              .setDstAccessMask(vk::AccessFlagBits::eTransferRead)
-              .setSize(VK_WHOLE_SIZE)
-              .setBuffer(*mBuffer);
-
-        if (mUsage & (vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer))
-            result.srcAccessMask |= vk::AccessFlagBits::eShaderWrite;
-        if (mUsage & vk::BufferUsageFlagBits::eTransferDst)
-            result.srcAccessMask |= vk::AccessFlagBits::eTransferWrite;
-
-        return result;
+        return prepare(vk::AccessFlagBits::eTransferRead);
     }
 
     vk::BufferMemoryBarrier buffer::prepareForTransferDst()
@@ -483,18 +664,7 @@ namespace vulkan_utils {
             fail_runtime_error("buffer was not constructed as a potential transfer destination");
         }
 
-        vk::BufferMemoryBarrier result;
-        result.setSrcAccessMask(vk::AccessFlagBits::eHostRead)
-              .setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
-              .setSize(VK_WHOLE_SIZE)
-              .setBuffer(*mBuffer);
-
-        if (mUsage & (vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer))
-            result.srcAccessMask |= vk::AccessFlagBits::eShaderRead;
-        if (mUsage & vk::BufferUsageFlagBits::eTransferSrc)
-            result.srcAccessMask |= vk::AccessFlagBits::eTransferRead;
-
-        return result;
+        return prepare(vk::AccessFlagBits::eTransferWrite);
     }
 
     vk::DescriptorBufferInfo buffer::use()
@@ -505,22 +675,50 @@ namespace vulkan_utils {
         return result;
     }
 
-    mapped_ptr<void> buffer::map()
+    vk::DescriptorBufferInfo buffer::use(vk::DeviceSize offset, vk::DeviceSize range)
     {
-        // TODO check that the memory is host visible
+        if (offset >= mSize || (VK_WHOLE_SIZE != range && offset + range > mSize)) {
+            fail_runtime_error("buffer range is out of bounds");
+        }
+
+        vk::DescriptorBufferInfo result;
+        result.setOffset(offset)
+                .setRange(range)
+                .setBuffer(*mBuffer);
+        return result;
+    }
 
+    mapped_ptr<void> buffer::map(map_mode mode)
+    {
         if (mIsMapped) {
             fail_runtime_error("buffer is already mapped");
         }
 
-        void* memMap = mDevice.mapMemory(*mDeviceMemory, 0, VK_WHOLE_SIZE, vk::MemoryMapFlags());
-        mapped_ptr<void> result(memMap, std::bind(&buffer::unmap, this));
-        mIsMapped = true;
+        if (!isHostVisible()) {
+            if (!mTransfer) {
+                fail_runtime_error("buffer memory is not host visible, and the buffer has no transfer function for staging");
+            }
 
-        // TODO only do cache management on incoherent memory
+            mStaging.reset(new buffer(mDevice,
+                                      mMemoryProperties,
+                                      mSize,
+                                      vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst));
+            if (kMap_write != mode) {
+                mTransfer(std::bind(&buffer::recordStagingCopy, this, std::placeholders::_1, true));
+            }
+        }
 
-        const vk::MappedMemoryRange mappedRange(*mDeviceMemory, 0, VK_WHOLE_SIZE);
-        mDevice.invalidateMappedMemoryRanges(mappedRange);
+        // Host writes made before a submission are visible to it without a barrier, and the host
+        // must have waited for any prior device access to complete.
+        mAccess.reset();
+
+        mapped_ptr<void> result(getHostMemory().data(), std::bind(&buffer::unmap, this));
+        mIsMapped = true;
+        mMapMode = mode;
+
+        if (kMap_write != mode) {
+            getHostMemory().invalidate(0, mSize);
+        }
 
         return result;
     }
@@ -531,20 +729,81 @@ namespace vulkan_utils {
             fail_runtime_error("buffer is not mapped");
         }
 
-        // TODO only do cache management on incoherent memory
+        if (kMap_read != mMapMode) {
+            getHostMemory().flush(0, mSize);
+        }
 
-        const vk::MappedMemoryRange mappedRange(*mDeviceMemory, 0, VK_WHOLE_SIZE);
-        mDevice.flushMappedMemoryRanges(mappedRange);
+        if (mStaging) {
+            if (kMap_read != mMapMode) {
+                mTransfer(std::bind(&buffer::recordStagingCopy, this, std::placeholders::_1, false));
+
+                // the copy ends with a barrier against all later device work
+                mAccess.reset();
+            }
+            mStaging.reset();
+        }
 
-        mDevice.unmapMemory(*mDeviceMemory);
         mIsMapped = false;
     }
 
+    const memory_allocator::allocation& buffer::getHostMemory() const
+    {
+        return (mStaging ? mStaging->mMemory : mMemory);
+    }
+
+    void buffer::flush(vk::DeviceSize offset, vk::DeviceSize size)
+    {
+        if (!getHostMemory().data()) {
+            fail_runtime_error("buffer must be mapped to be flushed");
+        }
+        getHostMemory().flush(offset, size);
+    }
+
+    void buffer::invalidate(vk::DeviceSize offset, vk::DeviceSize size)
+    {
+        if (!getHostMemory().data()) {
+            fail_runtime_error("buffer must be mapped to be invalidated");
+        }
+        getHostMemory().invalidate(offset, size);
+    }
+
+    void buffer::recordStagingCopy(vk::CommandBuffer commandBuffer, bool isReadback)
+    {
+        const vk::Buffer src = (isReadback ? *mBuffer : *mStaging->mBuffer);
+        const vk::Buffer dst = (isReadback ? *mStaging->mBuffer : *mBuffer);
+
+        // The copy is submitted apart from the work which uses the buffer, so it is ordered with
+        // global barriers rather than the access tracker.
+        const vk::MemoryBarrier before(vk::AccessFlagBits::eMemoryWrite,
+                                       vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                                      vk::PipelineStageFlagBits::eTransfer,
+                                      vk::DependencyFlags(),
+                                      before,
+                                      nullptr,
+                                      nullptr);
+
+        commandBuffer.copyBuffer(src, dst, vk::BufferCopy(0, 0, mSize));
+
+        const vk::MemoryBarrier after(vk::AccessFlagBits::eTransferWrite,
+                                      isReadback ? vk::AccessFlags(vk::AccessFlagBits::eHostRead)
+                                                 : vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite);
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                      isReadback ? vk::PipelineStageFlagBits::eHost : vk::PipelineStageFlagBits::eAllCommands,
+                                      vk::DependencyFlags(),
+                                      after,
+                                      nullptr,
+                                      nullptr);
+    }
+
     image::image()
             : mDevice(),
               mMemoryProperties(),
               mImageLayout(vk::ImageLayout::eUndefined),
-              mDeviceMemory(),
+              mTiling(vk::ImageTiling::eOptimal),
+              mIsShared(false),
+              mLayout(),
+              mMemory(),
               mExtent(),
               mImage(),
               mImageView(),
@@ -560,14 +819,21 @@ namespace vulkan_utils {
         swap(mDevice, other.mDevice);
         swap(mMemoryProperties, other.mMemoryProperties);
         swap(mImageLayout, other.mImageLayout);
-        swap(mDeviceMemory, other.mDeviceMemory);
+        swap(mTiling, other.mTiling);
+        swap(mIsShared, other.mIsShared);
+        swap(mLayout, other.mLayout);
+        swap(mAccess, other.mAccess);
+        swap(mMemory, other.mMemory);
         swap(mExtent, other.mExtent);
         swap(mImage, other.mImage);
         swap(mImageView, other.mImageView);
         swap(mFormat, other.mFormat);
     }
 
-    bool image::supportsFormatUse(vk::PhysicalDevice device, vk::Format format, Usage usage)
+    bool image::supportsFormatUse(vk::PhysicalDevice    device,
+                                  vk::Format            format,
+                                  Usage                 usage,
+                                  vk::ImageTiling       tiling)
     {
         vk::FormatProperties properties = device.getFormatProperties(format);
 
@@ -577,14 +843,20 @@ namespace vulkan_utils {
             requiredFeatures |= vk::FormatFeatureFlagBits::eStorageImage;
         }
 
-        return (requiredFeatures == (properties.optimalTilingFeatures & requiredFeatures));
+        const vk::FormatFeatureFlags features = (vk::ImageTiling::eLinear == tiling
+                                                 ? properties.linearTilingFeatures
+                                                 : properties.optimalTilingFeatures);
+        return (requiredFeatures == (features & requiredFeatures));
     }
 
     image::image(vk::Device                                 dev,
                  const vk::PhysicalDeviceMemoryProperties   memoryProperties,
                  vk::Extent3D                               extent,
                  vk::Format                                 format,
-                 Usage                                      usage)
+                 Usage                                      usage,
+                 vk::ArrayProxy<const std::uint32_t>        sharingQueueFamilies,
+                 vk::ImageTiling                            tiling,
+                 vk::PhysicalDevice                         physicalDevice)
             : image()
     {
         if (extent.width < 1 || extent.height < 1 || extent.depth < 1)
@@ -593,11 +865,21 @@ namespace vulkan_utils {
         }
 
         const bool is3D = (extent.depth > 1);
+        if (is3D && vk::ImageTiling::eLinear == tiling)
+        {
+            fail_runtime_error("linear images must be 2D");
+        }
+
+        if (vk::ImageTiling::eLinear == tiling && !physicalDevice)
+        {
+            fail_runtime_error("linear images require the physical device");
+        }
 
         mDevice = dev;
         mMemoryProperties = memoryProperties;
         mExtent = extent;
         mFormat = format;
+        mTiling = tiling;
 
         vk::ImageUsageFlags imageUsage = vk::ImageUsageFlagBits::eSampled |
                                          vk::ImageUsageFlagBits::eTransferDst |
@@ -607,6 +889,31 @@ namespace vulkan_utils {
             imageUsage |= vk::ImageUsageFlagBits::eStorage;
         }
 
+        // linear images are often limited to smaller extents, or fewer usages, than optimal ones
+        if (vk::ImageTiling::eLinear == mTiling)
+        {
+            vk::ImageFormatProperties linearProperties;
+            const vk::Result result = physicalDevice.getImageFormatProperties(mFormat,
+                                                                              vk::ImageType::e2D,
+                                                                              vk::ImageTiling::eLinear,
+                                                                              imageUsage,
+                                                                              vk::ImageCreateFlags(),
+                                                                              &linearProperties);
+            if (vk::Result::eSuccess != result
+                || mExtent.width > linearProperties.maxExtent.width
+                || mExtent.height > linearProperties.maxExtent.height)
+            {
+                mTiling = vk::ImageTiling::eOptimal;
+            }
+        }
+
+        // The contents of a linear image written by the host before its first use are kept by
+        // transitioning it out of the preinitialized layout
+        if (vk::ImageTiling::eLinear == mTiling)
+        {
+            mImageLayout = vk::ImageLayout::ePreinitialized;
+        }
+
         vk::ImageCreateInfo imageInfo;
         imageInfo.setImageType(is3D ? vk::ImageType::e3D : vk::ImageType::e2D)
                 .setFormat(mFormat)
@@ -614,24 +921,65 @@ namespace vulkan_utils {
                 .setMipLevels(1)
                 .setArrayLayers(1)
                 .setSamples(vk::SampleCountFlagBits::e1)
-                .setTiling(vk::ImageTiling::eOptimal)
+                .setTiling(mTiling)
                 .setUsage(imageUsage)
                 .setSharingMode(vk::SharingMode::eExclusive)
                 .setInitialLayout(mImageLayout);
-
-        mImage = mDevice.createImageUnique(imageInfo);
+        if (sharingQueueFamilies.size() > 1) {
+            mIsShared = true;
+            imageInfo.setSharingMode(vk::SharingMode::eConcurrent)
+                    .setQueueFamilyIndexCount(sharingQueueFamilies.size())
+                    .setPQueueFamilyIndices(sharingQueueFamilies.data());
+        }
 
         // allocate device memory for the image
-        mDeviceMemory = allocate_device_memory(mDevice,
-                                               mDevice.getImageMemoryRequirements(*mImage),
-                                               mMemoryProperties);
-        if (!mDeviceMemory)
+        auto allocator = memory_allocator::getDefault(mDevice, mMemoryProperties);
+        if (vk::ImageTiling::eLinear == mTiling)
+        {
+            mImage = mDevice.createImageUnique(imageInfo);
+
+            const auto memReqs = mDevice.getImageMemoryRequirements(*mImage);
+            for (auto flags : getPlacementPreferences(kPlacement_hostVisible))
+            {
+                mMemory = allocator->allocate(memReqs, flags, memory_allocator::kResource_linear);
+                if (mMemory) break;
+            }
+
+            if (!mMemory)
+            {
+                // fall back to an optimal image, which the caller must initialize by copying
+                mTiling = vk::ImageTiling::eOptimal;
+                mImageLayout = vk::ImageLayout::eUndefined;
+                imageInfo.setTiling(mTiling)
+                         .setInitialLayout(mImageLayout);
+                mImage = mDevice.createImageUnique(imageInfo);
+            }
+        }
+        else
+        {
+            mImage = mDevice.createImageUnique(imageInfo);
+        }
+
+        if (!mMemory)
+        {
+            mMemory = allocator->allocate(mDevice.getImageMemoryRequirements(*mImage),
+                                          vk::MemoryPropertyFlags(),
+                                          memory_allocator::kResource_optimal);
+        }
+        if (!mMemory)
         {
             fail_runtime_error("Cannot allocate device memory for image");
         }
 
         // Bind the memory to the image object
-        mDevice.bindImageMemory(*mImage, *mDeviceMemory, 0);
+        mDevice.bindImageMemory(*mImage, mMemory.getMemory(), mMemory.getOffset());
+
+        if (vk::ImageTiling::eLinear == mTiling)
+        {
+            vk::ImageSubresource subresource;
+            subresource.setAspectMask(vk::ImageAspectFlagBits::eColor);
+            mLayout = mDevice.getImageSubresourceLayout(*mImage, subresource);
+        }
 
         // Allocate the image view
         vk::ImageViewCreateInfo viewInfo;
@@ -669,6 +1017,32 @@ namespace vulkan_utils {
         return result;
     }
 
+    mapped_ptr<void> image::map()
+    {
+        if (!isHostVisible())
+        {
+            fail_runtime_error("only host visible images can be mapped");
+        }
+        if (mImageLayout != vk::ImageLayout::ePreinitialized && mImageLayout != vk::ImageLayout::eGeneral)
+        {
+            fail_runtime_error("the host can only access images in the preinitialized or general layouts");
+        }
+
+        mMemory.invalidate(mLayout.offset, mLayout.size);
+
+        const memory_allocator::allocation* memory = &mMemory;
+        const vk::DeviceSize offset = mLayout.offset;
+        const vk::DeviceSize size = mLayout.size;
+        return mapped_ptr<void>(static_cast<char*>(mMemory.data()) + offset,
+                                [memory, offset, size](void*) { memory->flush(offset, size); });
+    }
+
+    void image::discardContents()
+    {
+        mImageLayout = vk::ImageLayout::eUndefined;
+        mAccess.reset();
+    }
+
     vk::ImageMemoryBarrier image::prepare(vk::ImageLayout newLayout)
     {
         if (newLayout == vk::ImageLayout::eUndefined)
@@ -676,23 +1050,17 @@ namespace vulkan_utils {
             fail_runtime_error("images cannot be transitioned to undefined layout");
         }
 
-        // TODO: if the layout isn't changing, no barrier is needed
-
         const auto accessMap = {
                 std::make_pair(vk::ImageLayout::eShaderReadOnlyOptimal, vk::AccessFlagBits::eShaderRead),
                 std::make_pair(vk::ImageLayout::eTransferDstOptimal, vk::AccessFlagBits::eTransferWrite),
                 std::make_pair(vk::ImageLayout::eTransferSrcOptimal, vk::AccessFlagBits::eTransferRead),
-                std::make_pair(vk::ImageLayout::eGeneral, vk::AccessFlagBits::eShaderWrite),
-                std::make_pair(vk::ImageLayout::eUndefined, vk::AccessFlagBits(0))
+                std::make_pair(vk::ImageLayout::eGeneral, vk::AccessFlagBits::eShaderWrite)
         };
 
         auto layoutFinder = [](decltype(accessMap)::const_reference item, vk::ImageLayout layout) {
             return item.first == layout;
         };
 
-        auto oldAccess = std::find_if(accessMap.begin(), accessMap.end(), std::bind(layoutFinder, std::placeholders::_1, mImageLayout));
-        assert(oldAccess != accessMap.end());
-
         auto newAccess = std::find_if(accessMap.begin(), accessMap.end(), std::bind(layoutFinder, std::placeholders::_1, newLayout));
         if (newAccess == accessMap.end())
         {
@@ -700,7 +1068,7 @@ namespace vulkan_utils {
         }
 
         vk::ImageMemoryBarrier result;
-        result.setSrcAccessMask(oldAccess->second)
+        result.setSrcAccessMask(mAccess.access(newAccess->second, newLayout != mImageLayout))
                 .setDstAccessMask(newAccess->second)
                 .setOldLayout(mImageLayout)
                 .setNewLayout(newLayout)
@@ -714,6 +1082,74 @@ namespace vulkan_utils {
         return result;
     }
 
+    vk::AccessFlags access_tracker::access(vk::AccessFlags newAccess, bool isLayoutTransition)
+    {
+        const vk::AccessFlags kWriteAccess = vk::AccessFlagBits::eShaderWrite
+                                             | vk::AccessFlagBits::eTransferWrite
+                                             | vk::AccessFlagBits::eHostWrite;
+
+        vk::AccessFlags result;
+
+        if (isLayoutTransition || (newAccess & kWriteAccess)) {
+            // write-after-write and write-after-read
+            result = mWriteAccess | mReadAccess;
+
+            mWriteAccess = newAccess & kWriteAccess;
+            mReadAccess = newAccess & ~kWriteAccess;
+        }
+        else {
+            // read-after-write, unless the write has already been made visible to this access
+            if (newAccess & ~mReadAccess) {
+                result = mWriteAccess;
+            }
+
+            mReadAccess |= newAccess;
+        }
+
+        return result;
+    }
+
+    void access_tracker::reset()
+    {
+        mWriteAccess = vk::AccessFlags();
+        mReadAccess = vk::AccessFlags();
+    }
+
+    void access_tracker::swap(access_tracker& other)
+    {
+        using std::swap;
+
+        swap(mWriteAccess, other.mWriteAccess);
+        swap(mReadAccess, other.mReadAccess);
+    }
+
+    vk::PipelineStageFlags getAccessStages(vk::AccessFlags access)
+    {
+        vk::PipelineStageFlags result;
+
+        if (access & (vk::AccessFlagBits::eHostRead | vk::AccessFlagBits::eHostWrite))
+            result |= vk::PipelineStageFlagBits::eHost;
+        if (access & (vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eUniformRead))
+            result |= vk::PipelineStageFlagBits::eComputeShader;
+        if (access & (vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite))
+            result |= vk::PipelineStageFlagBits::eTransfer;
+
+        if (!result)
+            result = vk::PipelineStageFlagBits::eTopOfPipe;
+
+        return result;
+    }
+
+    bool isBarrierRequired(const vk::BufferMemoryBarrier& barrier)
+    {
+        return (bool)barrier.srcAccessMask;
+    }
+
+    bool isBarrierRequired(const vk::ImageMemoryBarrier& barrier)
+    {
+        return (barrier.srcAccessMask || barrier.oldLayout != barrier.newLayout);
+    }
+
     double timestamp_delta_ns(std::uint64_t                         startTimestamp,
                               std::uint64_t                         endTimestamp,
                               const vk::PhysicalDeviceProperties&   deviceProperties,
@@ -751,6 +1187,59 @@ namespace vulkan_utils {
         return result;
     }
 
+    std::vector<dispatch_tile> splitDispatch(const vk::Extent3D&                numWorkgroups,
+                                             const vk::PhysicalDeviceLimits&    limits)
+    {
+        const std::uint32_t* maxCount = limits.maxComputeWorkGroupCount;
+        if (0 == maxCount[0] || 0 == maxCount[1] || 0 == maxCount[2]) {
+            fail_runtime_error("device has no compute workgroup count limit");
+        }
+
+        std::vector<dispatch_tile> result;
+        for (std::uint32_t z = 0; z < numWorkgroups.depth; z += maxCount[2]) {
+            for (std::uint32_t y = 0; y < numWorkgroups.height; y += maxCount[1]) {
+                for (std::uint32_t x = 0; x < numWorkgroups.width; x += maxCount[0]) {
+                    dispatch_tile tile;
+                    tile.mBaseWorkgroup = vk::Extent3D(x, y, z);
+                    tile.mNumWorkgroups = vk::Extent3D(std::min(maxCount[0], numWorkgroups.width - x),
+                                                       std::min(maxCount[1], numWorkgroups.height - y),
+                                                       std::min(maxCount[2], numWorkgroups.depth - z));
+                    result.push_back(tile);
+                }
+            }
+        }
+        return result;
+    }
+
+    std::vector<vk::Extent3D> getWorkgroupSizeCandidates(const vk::PhysicalDeviceLimits& limits,
+                                                         unsigned int                    numDimensions)
+    {
+        if (numDimensions < 1 || numDimensions > 3) {
+            fail_runtime_error("workgroups have one to three dimensions");
+        }
+
+        auto maxSize = [&limits, numDimensions](unsigned int dimension) {
+            return (dimension < numDimensions ? limits.maxComputeWorkGroupSize[dimension] : 1);
+        };
+
+        // Each dimension is bounded by the invocations left to it, so that neither the sizes nor
+        // their product can overflow, even if a maximum size is 2^31 or more
+        const std::uint64_t maxInvocations = limits.maxComputeWorkGroupInvocations;
+
+        std::vector<vk::Extent3D> result;
+        for (std::uint64_t x = 1; x <= std::min<std::uint64_t>(maxSize(0), maxInvocations); x *= 2) {
+            for (std::uint64_t y = 1; y <= std::min<std::uint64_t>(maxSize(1), maxInvocations / x); y *= 2) {
+                for (std::uint64_t z = 1; z <= std::min<std::uint64_t>(maxSize(2), maxInvocations / (x * y)); z *= 2) {
+                    result.push_back(vk::Extent3D(static_cast<std::uint32_t>(x),
+                                                  static_cast<std::uint32_t>(y),
+                                                  static_cast<std::uint32_t>(z)));
+                }
+            }
+        }
+
+        return result;
+    }
+
     void copyBufferToImage(vk::CommandBuffer    commandBuffer,
                            buffer&              buffer,
                            image&               image)
@@ -767,12 +1256,7 @@ namespace vulkan_utils {
         copyRegion.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
                                    .setLayerCount(1);
 
-        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
-                                      vk::PipelineStageFlagBits::eTransfer,
-                                      vk::DependencyFlags(),
-                                      nullptr,         // memory barriers
-                                      bufferBarrier,   // buffer memory barriers
-                                      imageBarrier);   // image memory barriers
+        recordTransferBarrier(commandBuffer, bufferBarrier, imageBarrier);
 
         commandBuffer.copyBufferToImage(bufferBarrier.buffer, imageBarrier.image, imageBarrier.newLayout, copyRegion);
     }
@@ -793,12 +1277,7 @@ namespace vulkan_utils {
         copyRegion.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor)
                                    .setLayerCount(1);
 
-        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
-                                      vk::PipelineStageFlagBits::eTransfer,
-                                      vk::DependencyFlags(),
-                                      nullptr,         // memory barriers
-                                      bufferBarrier,   // buffer memory barriers
-                                      imageBarrier);   // image memory barriers
+        recordTransferBarrier(commandBuffer, bufferBarrier, imageBarrier);
 
         commandBuffer.copyImageToBuffer(imageBarrier.image, imageBarrier.newLayout, bufferBarrier.buffer, copyRegion);
     }
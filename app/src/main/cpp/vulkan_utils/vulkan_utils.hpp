@@ -7,12 +7,16 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "memory_allocator.hpp"
+
 #include <boost/units/quantity.hpp>
 #include <boost/units/systems/si/time.hpp>
 
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <ostream>
+#include <string>
 #include <vector>
 
 namespace vulkan_utils {
@@ -39,6 +43,29 @@ namespace vulkan_utils {
         return result;
     };
 
+    // Where a buffer's memory is placed
+    enum memory_placement {
+        kPlacement_hostCached,  // host visible, and host cached if possible, for fast readback (the default)
+        kPlacement_hostVisible, // host visible, and host coherent if possible, for fast uploads
+        kPlacement_deviceLocal  // device local, for fast device access; mapped through a staging buffer
+    };
+
+    // A transfer_fn records commands with the function it is given into a command buffer, then
+    // submits the command buffer and waits for it to complete. Buffers which the host cannot map
+    // directly use it to stage their contents.
+    typedef std::function<void (const std::function<void (vk::CommandBuffer)>&)> transfer_fn;
+
+    // What a device needs to import host memory with VK_EXT_external_memory_host. It also serves
+    // as the dispatcher for the extension's entry point, which is null if the extension is not
+    // enabled.
+    struct host_memory_importer {
+        PFN_vkGetMemoryHostPointerPropertiesEXT vkGetMemoryHostPointerPropertiesEXT = nullptr;
+        vk::DeviceSize                          mMinImportedHostPointerAlignment = 0;
+
+        // True if the extension is enabled, and the pointer and size are suitably aligned
+        bool    canImport(const void* hostPointer, vk::DeviceSize num_bytes) const;
+    };
+
     vk::UniqueDeviceMemory allocate_device_memory(vk::Device device,
                                                   const vk::MemoryRequirements&             mem_reqs,
                                                   const vk::PhysicalDeviceMemoryProperties& mem_props,
@@ -55,11 +82,27 @@ namespace vulkan_utils {
 
     buffer createUniformBuffer(vk::Device device,
                                const vk::PhysicalDeviceMemoryProperties memoryProperties,
-                               vk::DeviceSize                           num_bytes);
+                               vk::DeviceSize                           num_bytes,
+                               memory_placement                         placement = kPlacement_hostCached,
+                               transfer_fn                              transfer = transfer_fn());
 
     buffer createStorageBuffer(vk::Device device,
                                const vk::PhysicalDeviceMemoryProperties memoryProperties,
-                               vk::DeviceSize                           num_bytes);
+                               vk::DeviceSize                           num_bytes,
+                               memory_placement                         placement = kPlacement_hostCached,
+                               transfer_fn                              transfer = transfer_fn());
+
+    // Create a buffer over the contents of a file, mapped privately into host memory and imported
+    // with the importer if possible. The buffer's size is rounded up to the importer's alignment,
+    // and the excess is zero. Host writes to the buffer are not written back to the file.
+    buffer createBufferFromFile(vk::Device                                 device,
+                                const vk::PhysicalDeviceMemoryProperties   memoryProperties,
+                                const std::string&                         path,
+                                vk::BufferUsageFlags                       usage,
+                                const host_memory_importer&                importer);
+
+    // The size of the image's texels, tightly packed
+    vk::DeviceSize computeImageByteSize(const image& image);
 
     buffer createStagingBuffer(vk::Device                               device,
                                const vk::PhysicalDeviceMemoryProperties memoryProperties,
@@ -80,6 +123,33 @@ namespace vulkan_utils {
 
     vk::Extent3D computeNumberWorkgroups(const vk::Extent3D& workgroupSize, const vk::Extent3D& dataSize);
 
+    // A part of a dispatch, whose workgroup counts are within the device's limits. The kernel
+    // must be told mBaseWorkgroup, since Vulkan 1.0 has no dispatch with a base.
+    struct dispatch_tile {
+        vk::Extent3D    mBaseWorkgroup  = vk::Extent3D(0, 0, 0);
+        vk::Extent3D    mNumWorkgroups;
+    };
+
+    // Split a dispatch into tiles no larger than maxComputeWorkGroupCount in any dimension. A
+    // dispatch within the limits is returned as a single tile.
+    std::vector<dispatch_tile> splitDispatch(const vk::Extent3D&                numWorkgroups,
+                                             const vk::PhysicalDeviceLimits&    limits);
+
+    // Return every workgroup size permitted by the device limits whose first numDimensions
+    // dimensions are powers of two, and whose remaining dimensions are one.
+    std::vector<vk::Extent3D> getWorkgroupSizeCandidates(const vk::PhysicalDeviceLimits& limits,
+                                                         unsigned int                    numDimensions);
+
+    // Return the pipeline stages which perform the given memory accesses. An empty access mask
+    // maps to eTopOfPipe.
+    vk::PipelineStageFlags getAccessStages(vk::AccessFlags access);
+
+    // A barrier is required if it orders a prior access to the resource, or changes the layout
+    // of an image. Barriers returned by buffer and image prepare functions which are not required
+    // need not be recorded.
+    bool isBarrierRequired(const vk::BufferMemoryBarrier& barrier);
+    bool isBarrierRequired(const vk::ImageMemoryBarrier& barrier);
+
     void copyBufferToImage(vk::CommandBuffer    commandBuffer,
                            buffer&              buffer,
                            image&               image);
@@ -88,17 +158,63 @@ namespace vulkan_utils {
                            image&               image,
                            buffer&              buffer);
 
+    // Tracks the accesses recorded against a resource since its last write, so that only the
+    // barriers needed to order a new access against them are issued. Commands must be submitted
+    // in the order in which they are recorded.
+    class access_tracker {
+    public:
+        // Note a new access to the resource. Return the prior accesses that it must wait on, which
+        // are empty if no barrier is needed. A layout transition is treated as a write.
+        vk::AccessFlags access(vk::AccessFlags newAccess, bool isLayoutTransition = false);
+
+        // Forget all prior accesses. The device must have finished with the resource.
+        void            reset();
+
+        void            swap(access_tracker& other);
+
+    private:
+        vk::AccessFlags mWriteAccess;
+        vk::AccessFlags mReadAccess;
+    };
+
+    inline void swap(access_tracker& lhs, access_tracker& rhs)
+    {
+        lhs.swap(rhs);
+    }
+
     template <typename T>
     using mapped_ptr = std::unique_ptr<T, std::function<void (void*)> >;
 
+    // Buffers and images sub-allocate their memory from the device's default memory_allocator.
     class buffer {
     public:
         buffer () {}
 
+        // Memory is chosen by placement, falling back to any memory the buffer can use. A device
+        // local buffer is also a transfer source and destination, so that if its memory is not
+        // host visible, map() can stage its contents through transfer.
+        //
+        // If sharingQueueFamilies names more than one queue family, the buffer is shared
+        // concurrently between them. Otherwise it is owned exclusively by one queue family.
+        buffer (vk::Device device,
+                const vk::PhysicalDeviceMemoryProperties memoryProperties,
+                vk::DeviceSize                           num_bytes,
+                vk::BufferUsageFlags                     usage,
+                memory_placement                         placement = kPlacement_hostCached,
+                transfer_fn                              transfer = transfer_fn(),
+                vk::ArrayProxy<const std::uint32_t>      sharingQueueFamilies = nullptr);
+
+        // Wrap num_bytes of existing host memory, without copying it, if the importer can import
+        // it. The memory must then stay valid for the buffer's lifetime; hostMemoryOwner, if
+        // given, is held for that long. If the memory cannot be imported, a host visible buffer
+        // is created and the memory is copied into it instead.
         buffer (vk::Device device,
                 const vk::PhysicalDeviceMemoryProperties memoryProperties,
+                void*                                    hostPointer,
                 vk::DeviceSize                           num_bytes,
-                vk::BufferUsageFlags                     usage);
+                vk::BufferUsageFlags                     usage,
+                const host_memory_importer&              importer,
+                std::shared_ptr<void>                    hostMemoryOwner = nullptr);
 
         buffer (const buffer & other) = delete;
 
@@ -114,36 +230,84 @@ namespace vulkan_utils {
 
         vk::BufferMemoryBarrier  prepareForShaderRead();
         vk::BufferMemoryBarrier  prepareForShaderWrite();
+        vk::BufferMemoryBarrier  prepareForShaderReadWrite();
 
         vk::BufferMemoryBarrier  prepareForTransferSrc();
         vk::BufferMemoryBarrier  prepareForTransferDst();
 
         vk::DescriptorBufferInfo use();
 
+        // Bind only part of the buffer, for buffers larger than maxStorageBufferRange. The
+        // offset must be a multiple of minStorageBufferOffsetAlignment.
+        vk::DescriptorBufferInfo use(vk::DeviceSize offset, vk::DeviceSize range);
+
         vk::BufferUsageFlags     getUsage() const { return mUsage; }
         vk::DeviceSize           getSize() const { return mSize; }
+        memory_placement         getPlacement() const { return mPlacement; }
+
+        // True if the buffer can be mapped without staging
+        bool                     isHostVisible() const { return nullptr != mMemory.data(); }
+
+        // True if the buffer wraps imported host memory rather than a copy of it
+        bool                     isImported() const { return mIsImported; }
 
     public:
+        // How the host uses a mapping, so that cache maintenance and staging copies in the
+        // direction it does not use can be skipped
+        enum map_mode {
+            kMap_readWrite,
+            kMap_read,      // the host only reads; nothing is flushed or uploaded on unmap
+            kMap_write      // the host overwrites; nothing is invalidated or read back on map
+        };
+
         template <typename T>
-        inline mapped_ptr<T> map()
+        inline mapped_ptr<T> map(map_mode mode = kMap_readWrite)
         {
-            auto basicMap = map();
+            auto basicMap = map(mode);
             return mapped_ptr<T>(static_cast<T*>(basicMap.release()), basicMap.get_deleter());
         }
 
-        mapped_ptr<void> map();
+        // Mapping the buffer implies that the device has finished with it. Host visible memory
+        // stays mapped for the buffer's lifetime, so this only manages the host caches, and does
+        // nothing at all for host coherent memory. If the buffer is not host visible, its
+        // contents are read back into a staging buffer, which is mapped instead and uploaded
+        // again when it is unmapped.
+        mapped_ptr<void> map(map_mode mode = kMap_readWrite);
+
+        // Make host writes to part of the buffer available to the device, or device writes to it
+        // available to the host, without a full map and unmap. The range is widened to the
+        // device's nonCoherentAtomSize. Nothing is done if the memory is host coherent. A buffer
+        // which is not host visible must be mapped, and the range applies to its staging buffer.
+        void    flush(vk::DeviceSize offset, vk::DeviceSize size);
+        void    invalidate(vk::DeviceSize offset, vk::DeviceSize size);
 
     private:
+        vk::BufferMemoryBarrier  prepare(vk::AccessFlags access);
+
         void    unmap();
 
+        // Record a copy between the buffer and mStaging, ordered against all other device work
+        void    recordStagingCopy(vk::CommandBuffer commandBuffer, bool isReadback);
+
+        // The allocation which the host reads and writes: mStaging's while it exists
+        const memory_allocator::allocation& getHostMemory() const;
+
     private:
         vk::BufferUsageFlags    mUsage;
         bool                    mIsMapped   = false;
+        map_mode                mMapMode    = kMap_readWrite;
         vk::DeviceSize          mSize       = 0;
+        memory_placement        mPlacement  = kPlacement_hostCached;
+        transfer_fn             mTransfer;
+        std::unique_ptr<buffer> mStaging;
 
         vk::Device              mDevice;
-        vk::UniqueDeviceMemory  mDeviceMemory;
+        vk::PhysicalDeviceMemoryProperties  mMemoryProperties;
+        bool                    mIsImported = false;
+        std::shared_ptr<void>   mHostMemoryOwner;   // outlives mMemory and mBuffer
+        memory_allocator::allocation    mMemory;
         vk::UniqueBuffer        mBuffer;
+        access_tracker          mAccess;
     };
 
     inline void swap(buffer & lhs, buffer & rhs)
@@ -159,15 +323,29 @@ namespace vulkan_utils {
         };
 
     public:
-        static bool supportsFormatUse(vk::PhysicalDevice device, vk::Format format, Usage usage);
+        static bool supportsFormatUse(vk::PhysicalDevice    device,
+                                      vk::Format            format,
+                                      Usage                 usage,
+                                      vk::ImageTiling       tiling = vk::ImageTiling::eOptimal);
 
         image();
 
+        // A linear image is placed in host visible memory, so that the host can write its texels
+        // directly through map() rather than copying them in from a buffer. Linear images must be
+        // 2D, and the format must support the usage with linear tiling (see supportsFormatUse).
+        // The physical device is required for a linear image. If it does not support a linear
+        // image of the extent and usage, or no host visible memory can hold the image, an optimal
+        // image is created instead.
+        //
+        // sharingQueueFamilies is as for buffer
         image(vk::Device                                dev,
               const vk::PhysicalDeviceMemoryProperties  memoryProperties,
               vk::Extent3D                              extent,
               vk::Format                                format,
-              Usage                                     usage);
+              Usage                                     usage,
+              vk::ArrayProxy<const std::uint32_t>       sharingQueueFamilies = nullptr,
+              vk::ImageTiling                           tiling = vk::ImageTiling::eOptimal,
+              vk::PhysicalDevice                        physicalDevice = vk::PhysicalDevice());
 
         image(const image& other) = delete;
 
@@ -186,16 +364,51 @@ namespace vulkan_utils {
 
         vk::Extent3D getExtent() const { return mExtent; }
         vk::Format getFormat() const { return mFormat; }
+        vk::ImageTiling getTiling() const { return mTiling; }
+
+        // True if the image is shared concurrently between queue families, and so never needs
+        // its ownership transferred
+        bool    isShared() const { return mIsShared; }
+
+        // Discard the image's contents, so that its next layout transition is from the undefined
+        // layout. A queue family may then take ownership of it without an ownership transfer.
+        // The device must have finished with the image.
+        void    discardContents();
+
+        // True if the image can be mapped. Only linear images in host visible memory can be;
+        // an optimal image may also be in host visible memory, but its texels are opaque.
+        bool    isHostVisible() const { return vk::ImageTiling::eLinear == mTiling && nullptr != mMemory.data(); }
+
+        // The layout of the texels seen through map(), in bytes
+        vk::DeviceSize  getRowPitch() const { return mLayout.rowPitch; }
+        vk::DeviceSize  getDepthPitch() const { return mLayout.depthPitch; }
+
+        // Map the texels of a host visible image, which must not have been used yet, or be in
+        // the general layout. Mapping the image implies that the device has finished with it.
+        // Host writes are flushed when it is unmapped, and are visible to commands submitted
+        // afterwards, so the image needs no upload.
+        mapped_ptr<void> map();
+
+        template <typename T>
+        inline mapped_ptr<T> map()
+        {
+            auto basicMap = map();
+            return mapped_ptr<T>(static_cast<T*>(basicMap.release()), basicMap.get_deleter());
+        }
 
     private:
         vk::Device                          mDevice;
         vk::PhysicalDeviceMemoryProperties  mMemoryProperties;
         vk::ImageLayout                     mImageLayout;
-        vk::UniqueDeviceMemory              mDeviceMemory;
+        vk::ImageTiling                     mTiling;
+        bool                                mIsShared;
+        vk::SubresourceLayout               mLayout;
+        memory_allocator::allocation        mMemory;
         vk::Extent3D                        mExtent;
         vk::UniqueImage                     mImage;
         vk::UniqueImageView                 mImageView;
         vk::Format                          mFormat;
+        access_tracker                      mAccess;
     };
 
     inline void swap(image& lhs, image& rhs)